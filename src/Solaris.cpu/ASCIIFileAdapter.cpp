@@ -3,7 +3,9 @@
 #include <algorithm>
 #include <string>
 
+#include "BlockHermite.h"
 #include "BodyGroupList.h"
+#include "BulirschStoer.h"
 #include "Component.h"
 #include "Constants.h"
 #include "DormandPrince.h"
@@ -11,6 +13,8 @@
 #include "Error.h"
 #include "EventCondition.h"
 #include "FargoParameters.h"
+#include "GaussRadau15.h"
+#include "HybridSymplectic.h"
 #include "Nebula.h"
 #include "RungeKutta4.h"
 #include "RungeKutta56.h"
@@ -23,6 +27,7 @@
 #include "Tools.h"
 #include "Validator.h"
 #include "Units.h"
+#include "WisdomHolman.h"
 
 
 static int ReadFile(char* path, std::string& str)
@@ -117,7 +122,7 @@ static int SetSettings(std::string& key, std::string& value, Settings& settings,
 		}
 		else if (value == "rungekutta56" || value == "rk56") {
 			settings.intgr_type = INTEGRATOR_TYPE_RUNGE_KUTTA56;
-//			settings.integrator = new RungeKutta56();
+			settings.integrator = new RungeKutta56();
 		}
 		else if (value == "rungekuttafehlberg78" || value == "rk78" || value == "rungekutta78") {
 			settings.intgr_type = INTEGRATOR_TYPE_RUNGE_KUTTA_FEHLBERG78;
@@ -127,12 +132,118 @@ static int SetSettings(std::string& key, std::string& value, Settings& settings,
 			settings.intgr_type = INTEGRATOR_TYPE_DORMAND_PRINCE;
 			settings.integrator = new DormandPrince();
 		}
+		else if (value == "bulirschstoer" || value == "bs") {
+			settings.intgr_type = INTEGRATOR_TYPE_BULIRSCH_STOER;
+			settings.integrator = new BulirschStoer();
+		}
+		else if (value == "wisdomholman" || value == "wh") {
+			settings.intgr_type = INTEGRATOR_TYPE_WISDOM_HOLMAN;
+			settings.integrator = new WisdomHolman();
+		}
+		else if (value == "gaussradau15" || value == "radau15" || value == "ias15") {
+			settings.intgr_type = INTEGRATOR_TYPE_GAUSS_RADAU15;
+			settings.integrator = new GaussRadau15();
+		}
+		else if (value == "hybridsymplectic" || value == "hybrid") {
+			settings.intgr_type = INTEGRATOR_TYPE_HYBRID_SYMPLECTIC;
+			settings.integrator = new HybridSymplectic();
+		}
+		else if (value == "blockhermite" || value == "hermite") {
+			settings.intgr_type = INTEGRATOR_TYPE_BLOCK_HERMITE;
+			settings.integrator = new BlockHermite();
+		}
 		else {
 			Error::_errMsg = "Unknown integrator type!";
 			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 			return 1;
 		}
     }
+    else if (key == "thread_count") {
+		if (!Tools::IsNumber(value)) {
+			Error::_errMsg = "Invalid number: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (!Validator::GreaterThanOrEqualTo(0.0, atof(value.c_str()))) {
+			Error::_errMsg = "Value out of range!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		settings.threadCount = atoi(value.c_str());
+    }
+    else if (key == "gravity_kernel") {
+		if (     value == "auto") {
+			settings.gravityKernel = GRAVITY_KERNEL_AUTO;
+		}
+		else if (value == "scalar") {
+			settings.gravityKernel = GRAVITY_KERNEL_SCALAR;
+		}
+		else if (value == "avx2") {
+			settings.gravityKernel = GRAVITY_KERNEL_AVX2;
+		}
+		else if (value == "avx512") {
+			settings.gravityKernel = GRAVITY_KERNEL_AVX512;
+		}
+		else {
+			Error::_errMsg = "Unknown gravity kernel!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+    }
+    else if (key == "gravity_symmetric") {
+		if (Tools::StringToBool(value, &settings.symmetricGravity)) {
+			Error::_errMsg = "Invalid value: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+    }
+    else if (key == "gravity_tree") {
+		if (Tools::StringToBool(value, &settings.treeGravity)) {
+			Error::_errMsg = "Invalid value: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+    }
+    else if (key == "restricted_problem") {
+		if (Tools::StringToBool(value, &settings.restrictedProblem)) {
+			Error::_errMsg = "Invalid value: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+    }
+    else if (key == "checkpoint_interval") {
+		if (!Tools::IsNumber(value)) {
+			Error::_errMsg = "Invalid number: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (!Validator::GreaterThanOrEqualTo(0.0, atof(value.c_str()))) {
+			Error::_errMsg = "Value out of range!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		settings.checkpointInterval = atof(value.c_str());
+    }
+    else if (key == "mixed_precision") {
+		if (Tools::StringToBool(value, &settings.mixedPrecision)) {
+			Error::_errMsg = "Invalid value: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+    }
+    else if (key == "opening_angle") {
+		if (!Tools::IsNumber(value)) {
+			Error::_errMsg = "Invalid number: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (!Validator::GreaterThan(0.0, atof(value.c_str()))) {
+			Error::_errMsg = "Value out of range!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		settings.openingAngle = atof(value.c_str());
+    }
     else if (key == "integrator_accuracy_value") {
 		if (!Tools::IsNumber(value)) {
 			Error::_errMsg = "Invalid number: '" + value + "'!";
@@ -146,6 +257,60 @@ static int SetSettings(std::string& key, std::string& value, Settings& settings,
 		}
 		settings.integrator->accuracy = atof(value.c_str());
 		settings.integrator->epsilon  = pow(10, atof(value.c_str()));
+    }
+    else if (key == "integrator_steps_per_orbit") {
+		if (!Tools::IsNumber(value)) {
+			Error::_errMsg = "Invalid number: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (!Validator::GreaterThan(0.0, atof(value.c_str()))) {
+			Error::_errMsg = "Value out of range!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (settings.intgr_type != INTEGRATOR_TYPE_WISDOM_HOLMAN && settings.intgr_type != INTEGRATOR_TYPE_HYBRID_SYMPLECTIC) {
+			Error::_errMsg = "The integrator_steps_per_orbit key is valid only for the Wisdom-Holman and the hybrid symplectic integrators!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		((WisdomHolman *)settings.integrator)->stepsPerOrbit = atoi(value.c_str());
+    }
+    else if (key == "integrator_eta") {
+		if (!Tools::IsNumber(value)) {
+			Error::_errMsg = "Invalid number: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (!Validator::GreaterThan(0.0, atof(value.c_str()))) {
+			Error::_errMsg = "Value out of range!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (settings.intgr_type != INTEGRATOR_TYPE_BLOCK_HERMITE) {
+			Error::_errMsg = "The integrator_eta key is valid only for the block Hermite integrator!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		((BlockHermite *)settings.integrator)->eta = atof(value.c_str());
+    }
+    else if (key == "integrator_stepcontrol") {
+		if (settings.intgr_type != INTEGRATOR_TYPE_RUNGE_KUTTA56 && settings.intgr_type != INTEGRATOR_TYPE_RUNGE_KUTTA_FEHLBERG78 && settings.intgr_type != INTEGRATOR_TYPE_DORMAND_PRINCE) {
+			Error::_errMsg = "The integrator_stepcontrol key is valid only for the Runge-Kutta 6(5), 7(8) and the Dormand-Prince integrators!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (value == "classic") {
+			settings.integrator->stepControl = STEP_CONTROL_CLASSIC;
+		}
+		else if (value == "pi") {
+			settings.integrator->stepControl = STEP_CONTROL_PI;
+		}
+		else {
+			Error::_errMsg = "Invalid value: '" + value + "'!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
     }
 	else if (key == "timeline_start") {
 		if (!Tools::IsNumber(value)) {
@@ -489,7 +654,7 @@ static int SetBody(std::string& bodystring, Body& body)
 			return 1;
 		}
 	}
-	body.phase = new Phase(body.GetId());
+	body.phase = Body::phasePool.New(body.GetId());
 	body.phase->position.x =  atof(value.substr(pos).c_str());
 
 	value = bodyTokenizer.next();
@@ -556,7 +721,7 @@ static int SetBody(std::string& bodystring, Body& body)
 			return 1;
 		}
 		else if (!body.characteristics) {
-			body.characteristics = new Characteristics();
+			body.characteristics = Body::characteristicsPool.New();
 		}
 		body.characteristics->absVisMag = atof(value.substr(pos).c_str());
 	}
@@ -575,7 +740,7 @@ static int SetBody(std::string& bodystring, Body& body)
 			return 1;
 		}
 		else if (!body.characteristics) {
-			body.characteristics = new Characteristics();
+			body.characteristics = Body::characteristicsPool.New();
 		}
 		body.characteristics->stokes = atof(value.substr(pos).c_str());
 	}
@@ -594,7 +759,7 @@ static int SetBody(std::string& bodystring, Body& body)
 			return 1;
 		}
 		else if (!body.characteristics) {
-			body.characteristics = new Characteristics();
+			body.characteristics = Body::characteristicsPool.New();
 		}
 		body.characteristics->mass = atof(value.substr(pos).c_str());
 	}
@@ -613,7 +778,7 @@ static int SetBody(std::string& bodystring, Body& body)
 			return 1;
 		}
 		else if (!body.characteristics) {
-			body.characteristics = new Characteristics();
+			body.characteristics = Body::characteristicsPool.New();
 		}
 		body.characteristics->radius = atof(value.substr(pos).c_str());
 	}
@@ -637,7 +802,7 @@ static int SetBody(std::string& bodystring, Body& body)
 		//	return 1;
 		//}
 		else if (!body.characteristics) {
-			body.characteristics = new Characteristics();
+			body.characteristics = Body::characteristicsPool.New();
 		}
 		body.characteristics->density = atof(value.substr(pos).c_str());
 	}
@@ -1459,7 +1624,7 @@ static int	ParseBodyGroupList(BodyGroupList &bodyGroupList, std::string& str, co
 		return 1;
 	}
 	else if (bodyGroupList.items.back().items.back().type == BODY_TYPE_STAR && bodyGroupList.items.back().items.back().phase == 0 && bodyGroupList.items.back().items.back().orbitalElement == 0) {
-		bodyGroupList.items.back().items.back().phase= new Phase(bodyGroupList.items.back().items.back().GetId());
+		bodyGroupList.items.back().items.back().phase= Body::phasePool.New(bodyGroupList.items.back().items.back().GetId());
 	}
 	else if (bodyGroupList.items.back().items.back().type == BODY_TYPE_TESTPARTICLE && bodyGroupList.items.back().items.back().characteristics != 0 && bodyGroupList.items.back().items.back().migrationType != MIGRATION_TYPE_NO) {
 		Error::_errMsg = "You cannot define Characteristics and MigrationType tags for TestParticle type body!";
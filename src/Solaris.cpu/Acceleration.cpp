@@ -1,6 +1,10 @@
 #include <cstdio>
+#include <ctime>
 #include <iostream>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "Acceleration.h"
 #include "BodyData.h"
@@ -13,8 +17,19 @@
 #include "SolarisMacro.h"
 #include "SolarisType.h"
 #include "Tools.h"
+#include "Trajectory.h"
 #include "TwoBodyAffair.h"
 
+// Returns the wall clock time in seconds, it is used only for measuring elapsed times
+static double WallTime()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
 // TODO: Mirt kell tudnia neki, hogy ki fogja integrlni? Elvileg neki tk mindegy!!
 Acceleration::Acceleration(integrator_type_t iType, frame_center_t fCenter, BodyData *bD, Nebula *n)
 {
@@ -31,6 +46,40 @@ Acceleration::Acceleration(integrator_type_t iType, frame_center_t fCenter, Body
 	accelGasDrag		= 0;
 	accelMigrationTypeI	= 0;
 	accelMigrationTypeII= 0;
+	_nRm3				= 0;
+	_nAccelGasDrag		= 0;
+	_nAccelMigrationTypeI = 0;
+	_nAccelMigrationTypeII= 0;
+
+	gravityKernel		= GRAVITY_KERNEL_SCALAR;
+	_kernel				= GravityKernel::Scalar;
+	_kernelFloat		= GravityKernel::ScalarFloat;
+	_nMirror			= 0;
+	_xMirror			= 0;
+	_yMirror			= 0;
+	_zMirror			= 0;
+	_mMirror			= 0;
+	_mMirrorF			= 0;
+
+	symmetricGravity	= false;
+	_nPairBuffer		= 0;
+	_nPairThreads		= 0;
+	_pairBuffer			= 0;
+
+	treeGravity			= false;
+	openingAngle		= 0.5;
+
+	nTestParticleInteraction = 0.0;
+	testParticleTime	= 0.0;
+
+	mixedPrecision		= false;
+	nMixedPrecisionCheck= 0;
+	mixedPrecisionError	= 0.0;
+	maxMixedPrecisionError = 0.0;
+	_nNonSelfInteracting= 0;
+
+	trajectory			= 0;
+	_trajectorySegment	= 0;
 }
 
 Acceleration::~Acceleration()
@@ -39,6 +88,111 @@ Acceleration::~Acceleration()
 	delete[] accelGasDrag;
 	delete[] accelMigrationTypeI;
 	delete[] accelMigrationTypeII;
+	FreeMirror();
+	FreePairBuffer();
+}
+
+/// Selects the kernel of the pairwise gravitational interaction. GRAVITY_KERNEL_AUTO
+/// selects the widest one the processor is able to execute.
+int Acceleration::SetGravityKernel(gravity_kernel_t type)
+{
+	if (type == GRAVITY_KERNEL_AUTO) {
+		type = GravityKernel::Best();
+	}
+	if (!GravityKernel::IsSupported(type)) {
+		Error::_errMsg = "The " + std::string(GravityKernel::Name(type)) + " gravity kernel is not supported by the processor!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	gravityKernel = type;
+	_kernel = GravityKernel::Get(type);
+	_kernelFloat = GravityKernel::GetFloat(type);
+
+	return 0;
+}
+
+int Acceleration::UpdateMirror(double *y)
+{
+	int nMassive = bodyData->nBodies.NOfMassive();
+	if (_nMirror < nMassive) {
+		FreeMirror();
+		_xMirror = (double *)Tools::AllocateAligned(nMassive*sizeof(double), 64);
+		HANDLE_NULL(_xMirror);
+		_yMirror = (double *)Tools::AllocateAligned(nMassive*sizeof(double), 64);
+		HANDLE_NULL(_yMirror);
+		_zMirror = (double *)Tools::AllocateAligned(nMassive*sizeof(double), 64);
+		HANDLE_NULL(_zMirror);
+		_mMirror = (double *)Tools::AllocateAligned(nMassive*sizeof(double), 64);
+		HANDLE_NULL(_mMirror);
+		if (mixedPrecision) {
+			_mMirrorF = (float *)Tools::AllocateAligned(nMassive*sizeof(float), 64);
+			HANDLE_NULL(_mMirrorF);
+		}
+		_nMirror = nMassive;
+	}
+	for (int i = 0; i < nMassive; i++) {
+		int i0 = 6*i;
+		_xMirror[i] = y[i0 + 0];
+		_yMirror[i] = y[i0 + 1];
+		_zMirror[i] = y[i0 + 2];
+		_mMirror[i] = bodyData->mass[i];
+	}
+	if (mixedPrecision) {
+		for (int i = 0; i < nMassive; i++) {
+			_mMirrorF[i] = (float)_mMirror[i];
+		}
+	}
+
+	return 0;
+}
+
+void Acceleration::FreeMirror()
+{
+	Tools::FreeAligned(_xMirror);
+	Tools::FreeAligned(_yMirror);
+	Tools::FreeAligned(_zMirror);
+	Tools::FreeAligned(_mMirror);
+	Tools::FreeAligned(_mMirrorF);
+	_xMirror = _yMirror = _zMirror = _mMirror = 0;
+	_mMirrorF = 0;
+	_nMirror = 0;
+}
+
+int Acceleration::AllocatePairBuffer(int n, int nThreads)
+{
+	if (_nPairBuffer >= n && _nPairThreads >= nThreads) {
+		return 0;
+	}
+	FreePairBuffer();
+	_pairBuffer = (double *)Tools::AllocateAligned(3*n*nThreads*sizeof(double), 64);
+	HANDLE_NULL(_pairBuffer);
+	_nPairBuffer = n;
+	_nPairThreads = nThreads;
+
+	return 0;
+}
+
+void Acceleration::FreePairBuffer()
+{
+	Tools::FreeAligned(_pairBuffer);
+	_pairBuffer = 0;
+	_nPairBuffer = 0;
+	_nPairThreads = 0;
+}
+
+/// Makes room for n doubles in the array a of capacity elements, the grown array is zeroed
+int Acceleration::Reserve(double *&a, int &capacity, int n)
+{
+	if (n <= capacity) {
+		return 0;
+	}
+	delete[] a;
+	a = new double[n];
+	HANDLE_NULL(a);
+	memset(a, 0, n*sizeof(double));
+	capacity = n;
+
+	return 0;
 }
 
 int	Acceleration::Compute(double t, double *y, double *totalAccel)
@@ -46,10 +200,15 @@ int	Acceleration::Compute(double t, double *y, double *totalAccel)
 	int	result = 0;
 	// The inverse of the cube of the distance from the central body
 	// nBodies contains the number of the different bodies
-	if (rm3 == 0 /*or reallocation must performed*/ ) {
-		rm3	= new double[bodyData->nBodies.total];
-		HANDLE_NULL(rm3);
-		memset(rm3, 0, bodyData->nBodies.total*sizeof(double));
+	// The arrays grow with the number of bodies, which increases when body groups are included
+	result = Reserve(rm3, _nRm3, bodyData->nBodies.total);
+	HANDLE_RESULT(result);
+
+	// In the restricted problem mode the phases of the first trajectory->nBody bodies are taken from
+	// their trajectory, and they are not integrated
+	if (trajectory != 0) {
+		result = trajectory->Phase(t, y, _trajectorySegment);
+		HANDLE_RESULT(result);
 	}
 
 	if (_frameCenter == FRAME_CENTER_BARY) {
@@ -61,6 +220,10 @@ int	Acceleration::Compute(double t, double *y, double *totalAccel)
 		HANDLE_RESULT(result);
 	}
 
+	if (trajectory != 0) {
+		memset(totalAccel, 0, 6*trajectory->nBody*sizeof(double));
+	}
+
 	return 0;
 }
 
@@ -70,10 +233,9 @@ int Acceleration::ComputeBaryCentric(double t, double *y, double *totalAccel)
 	HANDLE_RESULT(result);
 
 	if (nebula != 0) {
-		if (accelGasDrag == 0 && bodyData->nBodies.NOfPlAndSpl() > 0) {
-			accelGasDrag = new double[3*bodyData->nBodies.NOfPlAndSpl()];
-			HANDLE_NULL(accelGasDrag);
-			memset(accelGasDrag, 0, 3*bodyData->nBodies.NOfPlAndSpl()*sizeof(double));
+		if (bodyData->nBodies.NOfPlAndSpl() > 0) {
+			result = Reserve(accelGasDrag, _nAccelGasDrag, 3*bodyData->nBodies.NOfPlAndSpl());
+			HANDLE_RESULT(result);
 		}
 		if (evaluateGasDrag && accelGasDrag != 0) {
 			result = GasDragBC(t, y, accelGasDrag);
@@ -89,10 +251,9 @@ int Acceleration::ComputeBaryCentric(double t, double *y, double *totalAccel)
 			totalAccel[i0 + 5] += accelGasDrag[j0 + 2];
 		}
 
-		if (accelMigrationTypeI == 0 && bodyData->nBodies.protoPlanet) {
-			accelMigrationTypeI = new double[3*bodyData->nBodies.protoPlanet];
-			HANDLE_NULL(accelMigrationTypeI);
-			memset(accelMigrationTypeI, 0, 3*bodyData->nBodies.protoPlanet*sizeof(double));
+		if (bodyData->nBodies.protoPlanet) {
+			result = Reserve(accelMigrationTypeI, _nAccelMigrationTypeI, 3*bodyData->nBodies.protoPlanet);
+			HANDLE_RESULT(result);
 		}
 		if (evaluateTypeIMigration && accelMigrationTypeI != 0) {
 			result = MigrationTypeIBC(t, y, accelMigrationTypeI);
@@ -111,10 +272,9 @@ int Acceleration::ComputeBaryCentric(double t, double *y, double *totalAccel)
 			totalAccel[i0 + 5] += accelMigrationTypeI[j0 + 2];
 		}
 
-		if (accelMigrationTypeII == 0 && bodyData->nBodies.giantPlanet > 0) {
-			accelMigrationTypeII = new double[3*bodyData->nBodies.giantPlanet];
-			HANDLE_NULL(accelMigrationTypeII);
-			memset(accelMigrationTypeII, 0, 3*bodyData->nBodies.giantPlanet*sizeof(double));
+		if (bodyData->nBodies.giantPlanet > 0) {
+			result = Reserve(accelMigrationTypeII, _nAccelMigrationTypeII, 3*bodyData->nBodies.giantPlanet);
+			HANDLE_RESULT(result);
 		}
 		if (evaluateTypeIIMigration && accelMigrationTypeII != 0) {
 			result = MigrationTypeIIBC(t, y, accelMigrationTypeII);
@@ -158,10 +318,9 @@ int Acceleration::ComputeAstroCentric(double t, double *y, double *totalAccel)
 #endif
 
 	if (nebula != 0) {
-		if (accelGasDrag == 0 && bodyData->nBodies.NOfPlAndSpl() > 0) {
-			accelGasDrag = new double[3*bodyData->nBodies.NOfPlAndSpl()];
-			HANDLE_NULL(accelGasDrag);
-			memset(accelGasDrag, 0, 3*bodyData->nBodies.NOfPlAndSpl()*sizeof(double));
+		if (bodyData->nBodies.NOfPlAndSpl() > 0) {
+			result = Reserve(accelGasDrag, _nAccelGasDrag, 3*bodyData->nBodies.NOfPlAndSpl());
+			HANDLE_RESULT(result);
 		}
 		if (evaluateGasDrag && accelGasDrag != 0) {
 			result = GasDragAC(t, y, accelGasDrag);
@@ -181,10 +340,9 @@ int Acceleration::ComputeAstroCentric(double t, double *y, double *totalAccel)
 			totalAccel[i0 + 5] += accelGasDrag[j0 + 2];
 		}
 
-		if (accelMigrationTypeI == 0 && bodyData->nBodies.protoPlanet) {
-			accelMigrationTypeI = new double[3*bodyData->nBodies.protoPlanet];
-			HANDLE_NULL(accelMigrationTypeI);
-			memset(accelMigrationTypeI, 0, 3*bodyData->nBodies.protoPlanet*sizeof(double));
+		if (bodyData->nBodies.protoPlanet) {
+			result = Reserve(accelMigrationTypeI, _nAccelMigrationTypeI, 3*bodyData->nBodies.protoPlanet);
+			HANDLE_RESULT(result);
 		}
 		if (evaluateTypeIMigration && accelMigrationTypeI != 0) {
 			result = MigrationTypeIAC(t, y, accelMigrationTypeI);
@@ -203,10 +361,9 @@ int Acceleration::ComputeAstroCentric(double t, double *y, double *totalAccel)
 			totalAccel[i0 + 5] += accelMigrationTypeI[j0 + 2];
 		}
 
-		if (accelMigrationTypeII == 0 && bodyData->nBodies.giantPlanet > 0) {
-			accelMigrationTypeII = new double[3*bodyData->nBodies.giantPlanet];
-			HANDLE_NULL(accelMigrationTypeII);
-			memset(accelMigrationTypeII, 0, 3*bodyData->nBodies.giantPlanet*sizeof(double));
+		if (bodyData->nBodies.giantPlanet > 0) {
+			result = Reserve(accelMigrationTypeII, _nAccelMigrationTypeII, 3*bodyData->nBodies.giantPlanet);
+			HANDLE_RESULT(result);
 		}
 		if (evaluateTypeIIMigration && accelMigrationTypeII != 0) {
 			result = MigrationTypeIIAC(t, y, accelMigrationTypeII);
@@ -231,27 +388,36 @@ int Acceleration::ComputeAstroCentric(double t, double *y, double *totalAccel)
 
 int	Acceleration::GravityAC(double t, double *y, double *accel)
 {
-	double	rij = 0, rij2 = 0, rijm3 = 0; 
-	double	xij = 0, yij = 0, zij = 0; 
+	if (treeGravity) {
+		return GravityAC_Tree(t, y, accel);
+	}
+
+	int nTotal = bodyData->nBodies.total;
+	bool parallel = nTotal >= Constants::ParallelThreshold;
 
-	bodyData->indexOfNN[0] = -1;
-	bodyData->distanceOfNN[0] = 0.0;
 	// Note: i=1, since y(0,1,2,3,4,5) = 0, central body
-	for (int i=1; i<bodyData->nBodies.total; i++) {
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
 		// y: (x, y, z), (vx, vy, vz), etc.
 		int i0 = 6*i; 
 		double r2 = SQR(y[i0 + 0]) + SQR(y[i0 + 1]) + SQR(y[i0 + 2]); 
 		double r = sqrt(r2); 
 		rm3[i]= 1.0 / (r2 * r);
-		bodyData->indexOfNN[i] = -1;
-		bodyData->distanceOfNN[i] = 0.0;
 	}
 
 	accel[0] = accel[1] = accel[2] = accel[3] = accel[4] = accel[5] = 0.0;
-	int NOfMassive = bodyData->nBodies.NOfMassive();
-	for (register int i=1; i<bodyData->nBodies.total; i++) {
-		double rMin = 1.0e10;
+	// Each i is computed by exactly one thread with the same summation order as the
+	// serial loop, therefore the result does not depend on the number of threads.
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
 		double ax = 0.0, ay = 0.0, az = 0.0; 
+		double rij = 0, rij2 = 0, rijm3 = 0; 
+		double xij = 0, yij = 0, zij = 0; 
+		int NOfMassive = 0;
 
 		double mu = Constants::Gauss2*(bodyData->mass[0] + bodyData->mass[i]); 
 		register int i0 = 6*i; 
@@ -289,11 +455,6 @@ int	Acceleration::GravityAC(double t, double *y, double *accel)
 			rij = sqrt(rij2); 
 			rijm3 = 1.0/(rij2*rij); 
 
-			if (rij < rMin) {
-				rMin = rij;
-				bodyData->indexOfNN[i] = j;
-				bodyData->distanceOfNN[i] = rij;
-			}
 			double Gmj = Constants::Gauss2*bodyData->mass[j];
 			ax += Gmj*( xij*rijm3 - y[j0 + 0]*rm3[j] ); 
 			ay += Gmj*( yij*rijm3 - y[j0 + 1]*rm3[j] ); 
@@ -312,6 +473,105 @@ int	Acceleration::GravityAC(double t, double *y, double *accel)
 	return 0;
 }
 
+/**
+ * The tree version of GravityAC(): the central body and the giant planets act by direct
+ * summation, the rest of the massive bodies and the super-planetesimals through the trees.
+ * The indirect terms do not depend on the position of the body, they are summed only once.
+ */
+int	Acceleration::GravityAC_Tree(double t, double *y, double *accel)
+{
+	int nTotal = bodyData->nBodies.total;
+	int nCG = bodyData->nBodies.centralBody + bodyData->nBodies.giantPlanet;
+	int nMassive = bodyData->nBodies.NOfMassive();
+	int nSwarm = nMassive + bodyData->nBodies.superPlanetsimal;
+	bool parallel = nTotal >= Constants::ParallelThreshold;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
+		int i0 = 6*i; 
+		double r2 = SQR(y[i0 + 0]) + SQR(y[i0 + 1]) + SQR(y[i0 + 2]); 
+		double r = sqrt(r2); 
+		rm3[i]= 1.0 / (r2 * r);
+	}
+
+	int result = _treeMassive.Build(nCG, nMassive, y, bodyData->mass);
+	HANDLE_RESULT(result);
+	result = _treeSwarm.Build(nMassive, nSwarm, y, bodyData->mass);
+	HANDLE_RESULT(result);
+
+	// sum m_j*r_j/r_j^3 of the bodies of the trees
+	double indirectMassive[3] = {0.0, 0.0, 0.0};
+	double indirectSwarm[3]   = {0.0, 0.0, 0.0};
+	for (int j=nCG; j<nSwarm; j++) {
+		double *sum = j < nMassive ? indirectMassive : indirectSwarm;
+		int j0 = 6*j;
+		sum[0] += bodyData->mass[j]*y[j0 + 0]*rm3[j];
+		sum[1] += bodyData->mass[j]*y[j0 + 1]*rm3[j];
+		sum[2] += bodyData->mass[j]*y[j0 + 2]*rm3[j];
+	}
+
+	accel[0] = accel[1] = accel[2] = accel[3] = accel[4] = accel[5] = 0.0;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
+		double ax = 0.0, ay = 0.0, az = 0.0; 
+
+		double mu = Constants::Gauss2*(bodyData->mass[0] + bodyData->mass[i]); 
+		int i0 = 6*i; 
+		accel[i0 + 0] = y[i0 + 3]; 
+		accel[i0 + 1] = y[i0 + 4]; 
+		accel[i0 + 2] = y[i0 + 5]; 
+		accel[i0 + 3] = -mu*rm3[i]*y[i0 + 0]; 
+		accel[i0 + 4] = -mu*rm3[i]*y[i0 + 1]; 
+		accel[i0 + 5] = -mu*rm3[i]*y[i0 + 2]; 
+
+		for (int j=1; j<nCG; j++) {
+			if (j == i)
+				continue;
+			int j0 = 6*j; 
+			double xij = y[j0 + 0] - y[i0 + 0]; 
+			double yij = y[j0 + 1] - y[i0 + 1]; 
+			double zij = y[j0 + 2] - y[i0 + 2]; 
+			double rij2 = SQR(xij) + SQR(yij) + SQR(zij); 
+			double rij = sqrt(rij2); 
+			double rijm3 = 1.0/(rij2*rij); 
+
+			double Gmj = Constants::Gauss2*bodyData->mass[j];
+			ax += Gmj*( xij*rijm3 - y[j0 + 0]*rm3[j] ); 
+			ay += Gmj*( yij*rijm3 - y[j0 + 1]*rm3[j] ); 
+			az += Gmj*( zij*rijm3 - y[j0 + 2]*rm3[j] ); 
+		}
+
+		double a[3] = {0.0, 0.0, 0.0};
+		double indirect[3] = {indirectMassive[0], indirectMassive[1], indirectMassive[2]};
+		_treeMassive.Evaluate(y[i0 + 0], y[i0 + 1], y[i0 + 2], i, openingAngle, a);
+		if (i >= nCG && i < nMassive) {
+			indirect[0] -= bodyData->mass[i]*y[i0 + 0]*rm3[i];
+			indirect[1] -= bodyData->mass[i]*y[i0 + 1]*rm3[i];
+			indirect[2] -= bodyData->mass[i]*y[i0 + 2]*rm3[i];
+		}
+		// See the choice of NOfMassive in GravityAC()
+		if (bodyData->type[i] <= BODY_TYPE_PROTOPLANET) {
+			_treeSwarm.Evaluate(y[i0 + 0], y[i0 + 1], y[i0 + 2], i, openingAngle, a);
+			indirect[0] += indirectSwarm[0];
+			indirect[1] += indirectSwarm[1];
+			indirect[2] += indirectSwarm[2];
+		}
+		ax += Constants::Gauss2*(a[0] - indirect[0]);
+		ay += Constants::Gauss2*(a[1] - indirect[1]);
+		az += Constants::Gauss2*(a[2] - indirect[2]);
+
+		accel[i0 + 3] += ax;
+		accel[i0 + 4] += ay; 
+		accel[i0 + 5] += az; 
+	}
+
+	return 0;
+}
+
 int	Acceleration::GasDragAC(double t, double *y, double *accel)
 {
 	static bool _epstein = false;
@@ -512,7 +772,15 @@ int Acceleration::MigrationTypeIIAC(double t, double *y, double *accel)
 
 int Acceleration::GravityBC(double t, double *y, double *accel)
 {
-	for (int i=0; i<bodyData->nBodies.total; i++) {
+	if (treeGravity) {
+		return GravityBC_Tree(t, y, accel);
+	}
+
+	int nTotal = bodyData->nBodies.total;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (nTotal >= Constants::ParallelThreshold)
+#endif
+	for (int i=0; i<nTotal; i++) {
 		// y: (x, y, z), (vx, vy, vz), etc.
 		int i0 = 6*i; 
 		double r2 = SQR(y[i0 + 0]) + SQR(y[i0 + 1]) + SQR(y[i0 + 2]); 
@@ -520,7 +788,15 @@ int Acceleration::GravityBC(double t, double *y, double *accel)
 		rm3[i]= 1.0 / (r2 * r);
 	}
 
-	int result = GravityBC_SelfInteracting(t, y, accel);
+	int result = UpdateMirror(y);
+	HANDLE_RESULT(result);
+
+	if (symmetricGravity) {
+		result = GravityBC_SelfInteractingSymmetric(t, y, accel);
+	}
+	else {
+		result = GravityBC_SelfInteracting(t, y, accel);
+	}
 	HANDLE_RESULT(result);
 
 	result = GravityBC_NonSelfInteracting(t, y, accel);
@@ -533,94 +809,268 @@ int Acceleration::GravityBC_SelfInteracting(double t, double *y, double *accel)
 {
 	int	nMassive = bodyData->nBodies.NOfMassive();
 
-	for (register int i = 0; i < nMassive; i++) {
-		double rMin = 1.0e10;
+	// Parallel over i, see the note in GravityAC()
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (nMassive >= Constants::ParallelThreshold)
+#endif
+	for (int i = 0; i < nMassive; i++) {
+		double a[3] = {0.0, 0.0, 0.0};
 		register int i0 = 6*i;
 
-		bodyData->indexOfNN[i] = -1;
-		bodyData->distanceOfNN[i] = 0.0;
 		accel[i0 + 0] = y[i0 + 3]; 
 		accel[i0 + 1] = y[i0 + 4]; 
 		accel[i0 + 2] = y[i0 + 5];
-		memset(&accel[i0 + 3], 0, 3*sizeof(double));
 
-		// The bodies are sorted with increasing mass, therefore to
-		// increase the accuracy the lightest ones are added first
-		for (register int j = nMassive - 1; j >= 0; j--) {
-		//for (register int j = 0; j < nMassive; j++) {
-			if (j == i)
-				continue;
-			register int j0 = 6*j; 
-			double dxij = y[j0 + 0] - y[i0 + 0];
-			double dyij = y[j0 + 1] - y[i0 + 1];
-			double dzij = y[j0 + 2] - y[i0 + 2];
-			double rij2 = SQR(dxij) + SQR(dyij) + SQR(dzij);
-			double rij  = sqrt(rij2);
-
-			// Select the nearest neighbour
-			if (rij < rMin) {
-				rMin = rij;
-				bodyData->indexOfNN[i] = j;
-				bodyData->distanceOfNN[i] = rij;
-			}
-			// c = m_j/rij^3
-			double c = bodyData->mass[j] * 1.0/(rij2*rij);
-			accel[i0 + 3] += c*dxij;
-			accel[i0 + 4] += c*dyij;
-			accel[i0 + 5] += c*dzij;
-		}
-		accel[i0 + 3] *= Constants::Gauss2;
-		accel[i0 + 4] *= Constants::Gauss2;
-		accel[i0 + 5] *= Constants::Gauss2;
+		// The bodies do not interact gravitationally with themselves, j = i is skipped.
+		// With the scalar kernel this is the same j = nMassive-1, ..., 0 order as before.
+		_kernel(i + 1, nMassive, _xMirror, _yMirror, _zMirror, _mMirror, y[i0 + 0], y[i0 + 1], y[i0 + 2], a);
+		_kernel(0,     i,        _xMirror, _yMirror, _zMirror, _mMirror, y[i0 + 0], y[i0 + 1], y[i0 + 2], a);
+
+		accel[i0 + 3] = a[0] * Constants::Gauss2;
+		accel[i0 + 4] = a[1] * Constants::Gauss2;
+		accel[i0 + 5] = a[2] * Constants::Gauss2;
 	}
 
 	return 0;
 }
 
-int Acceleration::GravityBC_NonSelfInteracting(double t, double *y, double *accel)
+/**
+ * Computes the mutual interactions of the massive bodies with the symmetric kernel, i.e. every
+ * pair is visited only once. The threads accumulate into private buffers which are summed
+ * in the order of the thread number, therefore the result depends only on the number of threads.
+ */
+int Acceleration::GravityBC_SelfInteractingSymmetric(double t, double *y, double *accel)
 {
 	int	nMassive = bodyData->nBodies.NOfMassive();
+	bool parallel = nMassive >= Constants::ParallelThreshold;
 
-	for (register int i = nMassive; i < bodyData->nBodies.total; i++) {
-		double rMin = 1.0e10;
-		register int i0 = 6*i;
+	int nThreads = 1;
+#ifdef _OPENMP
+	if (parallel) {
+		nThreads = omp_get_max_threads();
+	}
+#endif
+	int result = AllocatePairBuffer(nMassive, nThreads);
+	HANDLE_RESULT(result);
+
+	int nUsed = 1;
+	int stride = _nPairBuffer;
+#ifdef _OPENMP
+	#pragma omp parallel num_threads(nThreads) if (parallel)
+#endif
+	{
+		int tid = 0;
+#ifdef _OPENMP
+		tid = omp_get_thread_num();
+		#pragma omp single
+		nUsed = omp_get_num_threads();
+#endif
+		double *ax = _pairBuffer + 3*tid*stride;
+		double *ay = ax + stride;
+		double *az = ay + stride;
+		for (int k = 0; k < nMassive; k++) {
+			ax[k] = ay[k] = az[k] = 0.0;
+		}
 
-		bodyData->indexOfNN[i] = -1;
-		bodyData->distanceOfNN[i] = 0.0;
+		// The row i contains nMassive-1-i pairs, the rows are dealt out cyclically to balance the load
+#ifdef _OPENMP
+		#pragma omp for schedule(static, 1)
+#endif
+		for (int i = 0; i < nMassive; i++) {
+			GravityKernel::SymmetricRow(i, nMassive, _xMirror, _yMirror, _zMirror, _mMirror, ax, ay, az);
+		}
+	}
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i = 0; i < nMassive; i++) {
+		double a[3] = {0.0, 0.0, 0.0};
+		for (int tid = 0; tid < nUsed; tid++) {
+			const double *buffer = _pairBuffer + 3*tid*stride;
+			a[0] += buffer[           i];
+			a[1] += buffer[  stride + i];
+			a[2] += buffer[2*stride + i];
+		}
+
+		int i0 = 6*i;
 		accel[i0 + 0] = y[i0 + 3]; 
 		accel[i0 + 1] = y[i0 + 4]; 
 		accel[i0 + 2] = y[i0 + 5];
-		memset(&accel[i0 + 3], 0, 3*sizeof(double));
+		accel[i0 + 3] = a[0] * Constants::Gauss2;
+		accel[i0 + 4] = a[1] * Constants::Gauss2;
+		accel[i0 + 5] = a[2] * Constants::Gauss2;
+	}
 
-		// The bodies are sorted with increasing mass, therefore to
-		// increase the accuracy the lightest ones are added first
-		for (register int j = nMassive - 1; j >= 0; j--) {
-		//for (register int j = 0; j < nMassive; j++) {
-			if (j == i)
-				continue;
-			register int j0 = 6*j; 
-			double dxij = y[j0 + 0] - y[i0 + 0];
-			double dyij = y[j0 + 1] - y[i0 + 1];
-			double dzij = y[j0 + 2] - y[i0 + 2];
-			double rij2 = SQR(dxij) + SQR(dyij) + SQR(dzij);
-			double rij  = sqrt(rij2);
-
-			// Select the nearest neighbour
-			if (rij < rMin) {
-				rMin = rij;
-				bodyData->indexOfNN[i] = j;
-				bodyData->distanceOfNN[i] = rij;
+	return 0;
+}
+
+/**
+ * Computes the accelerations of the bodies [first, last) due to the massive bodies.
+ * The block is applied to the perturbers tile by tile, so a tile is loaded into the cache
+ * once per block instead of once per body. If single is true, the perturbations are
+ * computed by the single precision kernel and only the central body is summed in double.
+ */
+void Acceleration::TestParticleBlock(int first, int last, double *y, bool single, double (*a)[3])
+{
+	int	nMassive = bodyData->nBodies.NOfMassive();
+	int lower = single ? bodyData->nBodies.centralBody : 0;
+
+	for (int k = 0; k < last - first; k++) {
+		a[k][0] = a[k][1] = a[k][2] = 0.0;
+	}
+	// The tiles are visited downwards, with the scalar kernel this is the same
+	// j = nMassive-1, ..., 0 order as without tiling
+	for (int j1 = nMassive; j1 > lower; j1 -= Constants::PerturberTileSize) {
+		int j0 = j1 - Constants::PerturberTileSize > lower ? j1 - Constants::PerturberTileSize : lower;
+		for (int i = first; i < last; i++) {
+			int i0 = 6*i;
+			int k = i - first;
+			if (single) {
+				_kernelFloat(j0, j1, _xMirror, _yMirror, _zMirror, _mMirrorF, y[i0 + 0], y[i0 + 1], y[i0 + 2], a[k]);
+			}
+			else {
+				_kernel(     j0, j1, _xMirror, _yMirror, _zMirror, _mMirror,  y[i0 + 0], y[i0 + 1], y[i0 + 2], a[k]);
 			}
-			// c = m_j/rij^3
-			double c = bodyData->mass[j] * 1.0/(rij2*rij);
+		}
+	}
+	// The dominant term of the central body is added last in double precision
+	if (single && lower > 0) {
+		for (int i = first; i < last; i++) {
+			int i0 = 6*i;
+			int k = i - first;
+			_kernel(0, lower, _xMirror, _yMirror, _zMirror, _mMirror, y[i0 + 0], y[i0 + 1], y[i0 + 2], a[k]);
+		}
+	}
+}
+
+/**
+ * The bodies are processed in blocks of ParticleBlockSize by TestParticleBlock(), the blocks
+ * are distributed among the threads.
+ */
+int Acceleration::GravityBC_NonSelfInteracting(double t, double *y, double *accel)
+{
+	const int B = Constants::ParticleBlockSize;
+
+	int	nMassive = bodyData->nBodies.NOfMassive();
+	int nTotal = bodyData->nBodies.total;
+	int n = nTotal - nMassive;
+	if (n <= 0) {
+		return 0;
+	}
+	double start = WallTime();
+
+	bool check = false;
+	if (mixedPrecision) {
+		check = _nNonSelfInteracting % Constants::MixedPrecisionCheck == 0;
+		_nNonSelfInteracting++;
+	}
+	double maxError = 0.0;
+
+	int nBlock = (n + B - 1)/B;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (n >= Constants::ParallelThreshold)
+#endif
+	for (int b = 0; b < nBlock; b++) {
+		int first = nMassive + b*B;
+		int last = first + B < nTotal ? first + B : nTotal;
+
+		double a[B][3];
+		TestParticleBlock(first, last, y, mixedPrecision, a);
+
+		if (check) {
+			double aRef[B][3];
+			TestParticleBlock(first, last, y, false, aRef);
+			double error = 0.0;
+			for (int k = 0; k < last - first; k++) {
+				double d = sqrt(SQR(a[k][0] - aRef[k][0]) + SQR(a[k][1] - aRef[k][1]) + SQR(a[k][2] - aRef[k][2]));
+				double r = sqrt(SQR(aRef[k][0]) + SQR(aRef[k][1]) + SQR(aRef[k][2]));
+				if (r > 0.0 && d/r > error) {
+					error = d/r;
+				}
+			}
+#ifdef _OPENMP
+			#pragma omp critical (MixedPrecisionError)
+#endif
+			if (error > maxError) {
+				maxError = error;
+			}
+		}
+
+		for (int i = first; i < last; i++) {
+			int i0 = 6*i;
+			int k = i - first;
+			accel[i0 + 0] = y[i0 + 3]; 
+			accel[i0 + 1] = y[i0 + 4]; 
+			accel[i0 + 2] = y[i0 + 5];
+			accel[i0 + 3] = a[k][0] * Constants::Gauss2;
+			accel[i0 + 4] = a[k][1] * Constants::Gauss2;
+			accel[i0 + 5] = a[k][2] * Constants::Gauss2;
+		}
+	}
+
+	if (check) {
+		nMixedPrecisionCheck++;
+		mixedPrecisionError = maxError;
+		if (maxError > maxMixedPrecisionError) {
+			maxMixedPrecisionError = maxError;
+		}
+	}
+	nTestParticleInteraction += (double)n*nMassive;
+	testParticleTime += WallTime() - start;
 
-			accel[i0 + 3] += c*dxij;
-			accel[i0 + 4] += c*dyij;
-			accel[i0 + 5] += c*dzij;
+	return 0;
+}
+
+/**
+ * The tree version of GravityBC(): every body feels the central body and the giant planets
+ * by direct summation and the rest of the massive bodies through the tree.
+ */
+int Acceleration::GravityBC_Tree(double t, double *y, double *accel)
+{
+	int nTotal = bodyData->nBodies.total;
+	int nCG = bodyData->nBodies.centralBody + bodyData->nBodies.giantPlanet;
+	int nMassive = bodyData->nBodies.NOfMassive();
+	bool parallel = nTotal >= Constants::ParallelThreshold;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=0; i<nTotal; i++) {
+		int i0 = 6*i; 
+		double r2 = SQR(y[i0 + 0]) + SQR(y[i0 + 1]) + SQR(y[i0 + 2]); 
+		double r = sqrt(r2); 
+		rm3[i]= 1.0 / (r2 * r);
+	}
+
+	int result = UpdateMirror(y);
+	HANDLE_RESULT(result);
+	result = _treeMassive.Build(nCG, nMassive, y, bodyData->mass);
+	HANDLE_RESULT(result);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+#endif
+	for (int i = 0; i < nTotal; i++) {
+		double a[3] = {0.0, 0.0, 0.0};
+		int i0 = 6*i;
+
+		accel[i0 + 0] = y[i0 + 3]; 
+		accel[i0 + 1] = y[i0 + 4]; 
+		accel[i0 + 2] = y[i0 + 5];
+
+		if (i < nCG) {
+			_kernel(i + 1, nCG, _xMirror, _yMirror, _zMirror, _mMirror, y[i0 + 0], y[i0 + 1], y[i0 + 2], a);
+			_kernel(0,     i,   _xMirror, _yMirror, _zMirror, _mMirror, y[i0 + 0], y[i0 + 1], y[i0 + 2], a);
+		}
+		else {
+			_kernel(0,     nCG, _xMirror, _yMirror, _zMirror, _mMirror, y[i0 + 0], y[i0 + 1], y[i0 + 2], a);
 		}
-		accel[i0 + 3] *= Constants::Gauss2;
-		accel[i0 + 4] *= Constants::Gauss2;
-		accel[i0 + 5] *= Constants::Gauss2;
+		_treeMassive.Evaluate(y[i0 + 0], y[i0 + 1], y[i0 + 2], i, openingAngle, a);
+
+		accel[i0 + 3] = a[0] * Constants::Gauss2;
+		accel[i0 + 4] = a[1] * Constants::Gauss2;
+		accel[i0 + 5] = a[2] * Constants::Gauss2;
 	}
 
 	return 0;
@@ -1,10 +1,13 @@
 #ifndef ACCELERATION_H_
 #define ACCELERATION_H_
 
+#include "GravityKernel.h"
+#include "Octree.h"
 #include "SolarisType.h"
 
 class BodyData;
 class Nebula;
+class Trajectory;
 class Vector;
 
 /**
@@ -16,18 +19,23 @@ public:
 	Acceleration(integrator_type_t iType, frame_center_t fCenter, BodyData *bD, Nebula *n);
 	~Acceleration();
 
+	int	SetGravityKernel(gravity_kernel_t type);
+
 	int	Compute(            double t, double *y, double *totalAccel);
 	int ComputeAstroCentric(double t, double *y, double *totalAccel);
 	int ComputeBaryCentric( double t, double *y, double *totalAccel);
 
 	int	GravityAC(          double t, double *y, double *a);
+	int	GravityAC_Tree(     double t, double *y, double *a);
 	int	GasDragAC(          double t, double *y, double *a);
 	int MigrationTypeIAC(   double t, double *y, double *a);
 	int MigrationTypeIIAC(  double t, double *y, double *a);
 
 	int	GravityBC(                   double t, double *y, double *a);
 	int	GravityBC_SelfInteracting(   double t, double *y, double *a);
+	int	GravityBC_SelfInteractingSymmetric(double t, double *y, double *a);
 	int GravityBC_NonSelfInteracting(double t, double *y, double *a);
+	int	GravityBC_Tree(              double t, double *y, double *a);
 	int	GasDragBC(                   double t, double *y, double *a);
 	int MigrationTypeIBC(            double t, double *y, double *a);
 	int MigrationTypeIIBC(           double t, double *y, double *a);
@@ -55,9 +63,73 @@ public:
 	bool		evaluateTypeIMigration;
 	bool		evaluateTypeIIMigration;
 
+	// The kernel used to compute the pairwise gravitational interactions
+	gravity_kernel_t		gravityKernel;
+	// If true, the mutual interactions of the massive bodies are computed only once per pair
+	bool					symmetricGravity;
+	// If true, the forces of the rocky planets, protoplanets and super-planetesimals are
+	// computed by the Barnes-Hut tree with the given opening angle
+	bool					treeGravity;
+	double					openingAngle;
+
+	// The number of the test particle - perturber interactions computed by
+	// GravityBC_NonSelfInteracting() and the wall time spent there [s]
+	double					nTestParticleInteraction;
+	double					testParticleTime;
+
+	// If true, the perturbations of the test particles (all forces except that of the central
+	// body) are computed in single precision. Every MixedPrecisionCheck-th evaluation is
+	// repeated in double precision, the last and the largest relative error are stored.
+	bool					mixedPrecision;
+	int						nMixedPrecisionCheck;
+	double					mixedPrecisionError;
+	double					maxMixedPrecisionError;
+
+	// The trajectory of the bodies in front of the test particles in the restricted problem mode
+	const Trajectory		*trajectory;
+
 private:
+	int		UpdateMirror(double *y);
+	void	FreeMirror();
+	int		AllocatePairBuffer(int n, int nThreads);
+	int		Reserve(double *&a, int &capacity, int n);
+	void	TestParticleBlock(int first, int last, double *y, bool single, double (*a)[3]);
+	void	FreePairBuffer();
+
 	integrator_type_t		_integratorType;
 	frame_center_t			_frameCenter;
+
+	// The number of elements allocated for rm3, accelGasDrag, accelMigrationTypeI and accelMigrationTypeII
+	int						_nRm3;
+	int						_nAccelGasDrag;
+	int						_nAccelMigrationTypeI;
+	int						_nAccelMigrationTypeII;
+
+	gravity_kernel_func_t	_kernel;
+	gravity_kernel_float_func_t _kernelFloat;
+	// Structure-of-arrays copy of the positions and masses of the massive bodies, it is
+	// refreshed from the interleaved y array once per Compute() and read by the kernels
+	int						_nMirror;
+	double					*_xMirror;
+	double					*_yMirror;
+	double					*_zMirror;
+	double					*_mMirror;
+	// Single precision copy of the masses, it is filled only in the mixed-precision mode
+	float					*_mMirrorF;
+	int						_nNonSelfInteracting;
+
+	// Per-thread accumulators of the symmetric kernel: ax, ay and az (3*_nPairBuffer doubles per thread)
+	int						_nPairBuffer;
+	int						_nPairThreads;
+	double					*_pairBuffer;
+
+	// Trees of the massive bodies except the central body and the giant planets and of the
+	// super-planetesimals, they are rebuilt at every evaluation of the accelerations
+	Octree					_treeMassive;
+	Octree					_treeSwarm;
+
+	// The interval of the trajectory used by the last Compute()
+	int						_trajectorySegment;
 };
 
 #endif
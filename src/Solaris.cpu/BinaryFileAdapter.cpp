@@ -15,8 +15,10 @@
 #include "Body.h"
 #include "BodyData.h"
 #include "BodyGroup.h"
+#include "Checkpoint.h"
 #include "Counter.h"
 #include "Ephemeris.h"
+#include "Error.h"
 #include "Output.h"
 #include "Phase.h"
 #include "Tools.h"
@@ -26,6 +28,18 @@ using namespace std;
 
 int BinaryFileAdapter::_propertyId = 0;
 int BinaryFileAdapter::_compositionId = 0;
+int BinaryFileAdapter::_phasesFileNumber = 1;
+
+// The size of the file in bytes, -1 if it does not exist
+static long long FileSize(const string& path)
+{
+	ifstream file(path.c_str(), ios::in | ios::binary);
+	if (!file) {
+		return -1;
+	}
+	file.seekg(0, ios::end);
+	return (long long)file.tellg();
+}
 
 BinaryFileAdapter::BinaryFileAdapter(Output *output) 
 {
@@ -118,7 +132,7 @@ void BinaryFileAdapter::SavePhases(double time, int n, double *y, int *id, outpu
 			string path = output->GetPath(output->phases);
 			ofstream writer;
 
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out | ios::binary);
@@ -144,12 +158,8 @@ void BinaryFileAdapter::SavePhases(double time, int n, double *y, int *id, outpu
 		}
 	case OUTPUT_TYPE_TEXT:
 		{
-			static bool firstcall = true;
-			static int number = 1;
-			stringstream ss;
-			ss << number;
-			string str = ss.str();
-			string path = output->GetPath(output->GetFilenameWithoutExt(output->phases) + '_' + str + ".txt");
+			static bool firstcall = !output->append;
+			string path = PhasesTextPath(_phasesFileNumber);
 
 			ofstream writer;
 
@@ -180,7 +190,7 @@ void BinaryFileAdapter::SavePhases(double time, int n, double *y, int *id, outpu
 				exit(1);
 			}
 			if (!firstcall && Tools::GetFileSize(path) >= 209715200) {
-				number++;
+				_phasesFileNumber++;
 				firstcall = true;
 			}
 //209715200
@@ -238,7 +248,7 @@ void BinaryFileAdapter::SaveIntegrals(double time, int n, double *integrals, out
 	{
 		case OUTPUT_TYPE_BINARY:
 		{
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			string path = output->GetPath(output->integrals);
 			ofstream writer;
@@ -281,7 +291,7 @@ void BinaryFileAdapter::SaveIntegrals(double time, int n, double *integrals, out
 		{
 			string path = output->GetPath(output->GetFilenameWithoutExt(output->integrals) + ".txt");
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out);
@@ -330,7 +340,7 @@ void BinaryFileAdapter::SaveTwoBodyAffairs(list<TwoBodyAffair>& list, output_typ
 		{
 			string path = output->GetPath(output->twoBodyAffair);
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out | ios::binary);
@@ -358,7 +368,7 @@ void BinaryFileAdapter::SaveTwoBodyAffairs(list<TwoBodyAffair>& list, output_typ
 		{
 			string path = output->GetPath(output->GetFilenameWithoutExt(output->twoBodyAffair) + ".txt");
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out);
@@ -442,7 +452,7 @@ void BinaryFileAdapter::SaveBodyProperties(double time, list<Body* >& bodyList,
 		{
 			string constPropPath = output->GetPath(output->constantProperties);
 			ofstream constPropWriter;
-			static bool firstcallC = true;
+			static bool firstcallC = !output->append;
 
 			if (firstcallC) {
 				constPropWriter.open(constPropPath.c_str(), ios::out | ios::binary);
@@ -460,7 +470,7 @@ void BinaryFileAdapter::SaveBodyProperties(double time, list<Body* >& bodyList,
 
 			string varPropPath = output->GetPath(output->variableProperties);
 			ofstream varPropWriter;
-			static bool firstcallV = true;
+			static bool firstcallV = !output->append;
 
 			if (firstcallV) {
 				varPropWriter.open(varPropPath.c_str(), ios::out | ios::binary);
@@ -490,7 +500,7 @@ void BinaryFileAdapter::SaveBodyProperties(double time, list<Body* >& bodyList,
 		{
 			string constPropPath = output->GetPath(output->GetFilenameWithoutExt(output->constantProperties) + ".txt");
 			ofstream constPropWriter;
-			static bool firstcallC = true;
+			static bool firstcallC = !output->append;
 
 			if (firstcallC) {
 				constPropWriter.open(constPropPath.c_str(), ios::out);
@@ -508,7 +518,7 @@ void BinaryFileAdapter::SaveBodyProperties(double time, list<Body* >& bodyList,
 
 			string varPropPath = output->GetPath(output->GetFilenameWithoutExt(output->variableProperties) + ".txt");
 			ofstream varPropWriter;
-			static bool firstcallV = true;
+			static bool firstcallV = !output->append;
 
 			if (firstcallV) {
 				varPropWriter.open(varPropPath.c_str(), ios::out);
@@ -546,7 +556,7 @@ void BinaryFileAdapter::SaveConstantProperty(Body* body, output_type_t type)
 		{
 			string constPropPath = output->GetPath(output->constantProperties);
 			ofstream constPropWriter;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				constPropWriter.open(constPropPath.c_str(), ios::out | ios::binary);
@@ -569,7 +579,7 @@ void BinaryFileAdapter::SaveConstantProperty(Body* body, output_type_t type)
 		{
 			string constPropPath = output->GetPath(output->GetFilenameWithoutExt(output->constantProperties) + ".txt");
 			ofstream constPropWriter;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				constPropWriter.open(constPropPath.c_str(), ios::out);
@@ -714,7 +724,7 @@ void BinaryFileAdapter::SaveVariableProperty(Body* body, double time, output_typ
 		{
 			string varPropPath = output->GetPath(output->variableProperties);
 			ofstream varPropWriter;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				varPropWriter.open(varPropPath.c_str(), ios::out | ios::binary);
@@ -737,7 +747,7 @@ void BinaryFileAdapter::SaveVariableProperty(Body* body, double time, output_typ
 		{
 			string varPropPath = output->GetPath(output->GetFilenameWithoutExt(output->variableProperties) + ".txt");
 			ofstream varPropWriter;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				varPropWriter.open(varPropPath.c_str(), ios::out);
@@ -788,7 +798,7 @@ void BinaryFileAdapter::SaveVariableProperty(ofstream& writer, Body* body, doubl
 				if (body->characteristics->componentList.size() > 0) {
 					string compPropPath = output->GetPath(output->compositionProperties);
 					ofstream compPropWriter;
-					static bool firstcall = true;
+					static bool firstcall = !output->append;
 
 					if (firstcall) {
 						compPropWriter.open(compPropPath.c_str(), ios::out | ios::binary);
@@ -835,7 +845,7 @@ void BinaryFileAdapter::SaveVariableProperty(ofstream& writer, Body* body, doubl
 				if (body->characteristics->componentList.size() > 0) {
 					string compPropPath = output->GetPath(output->GetFilenameWithoutExt(output->compositionProperties) + ".txt");
 					ofstream compPropWriter;
-					static bool firstcall = true;
+					static bool firstcall = !output->append;
 
 					if (firstcall) {
 						compPropWriter.open(compPropPath.c_str(), ios::out);
@@ -993,7 +1003,7 @@ void BinaryFileAdapter::SaveCollisionProperty(BodyData* bodyData, output_type_t
 
 			string path = output->GetPath("CollisionProperties.txt");
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out);
@@ -1106,7 +1116,7 @@ void BinaryFileAdapter::SaveElapsedTimes(double time, Counter counter, StopWatch
 		{
 			string path = output->GetPath("ElapsedTimeIntSim.txt");
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out);
@@ -1151,7 +1161,7 @@ void BinaryFileAdapter::SaveElapsedTimes(double time, StopWatch timer, output_ty
 		{
 			string path = output->GetPath("ElapsedTimeStep.txt");
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out);
@@ -1194,7 +1204,7 @@ void BinaryFileAdapter::SaveElapsedTimes(double time, StopWatch *timer, output_t
 		{
 			string path = output->GetPath("ElapsedTimeForce.txt");
 			ofstream writer;
-			static bool firstcall = true;
+			static bool firstcall = !output->append;
 
 			if (firstcall) {
 				writer.open(path.c_str(), ios::out);
@@ -1226,4 +1236,97 @@ void BinaryFileAdapter::SaveElapsedTimes(double time, StopWatch *timer, output_t
 			break;
 		}
 	}
-}
\ No newline at end of file
+}
+
+string BinaryFileAdapter::PhasesTextPath(int number)
+{
+	stringstream ss;
+	ss << number;
+	return output->GetPath(output->GetFilenameWithoutExt(output->phases) + '_' + ss.str() + ".txt");
+}
+
+/// The files which are extended during the integration, in the order their sizes are stored in the checkpoint.
+void BinaryFileAdapter::OutputFiles(vector<string>& files)
+{
+	string names[] = { output->phases, output->integrals, output->twoBodyAffair, output->constantProperties, output->variableProperties, output->compositionProperties };
+
+	files.clear();
+	for (int i = 0; i < (int)(sizeof(names)/sizeof(names[0])); i++) {
+		files.push_back(output->GetPath(names[i]));
+		files.push_back(output->GetPath(output->GetFilenameWithoutExt(names[i]) + ".txt"));
+	}
+	files.push_back(PhasesTextPath(_phasesFileNumber));
+	files.push_back(output->GetPath("CollisionProperties.txt"));
+}
+
+/**
+ * Writes the ids of the properties and the sizes of the output files into the checkpoint.
+ */
+void BinaryFileAdapter::SaveState(Checkpoint &checkpoint)
+{
+	checkpoint.Write(_propertyId);
+	checkpoint.Write(_compositionId);
+	checkpoint.Write(_phasesFileNumber);
+
+	vector<string> files;
+	OutputFiles(files);
+	for (int i = 0; i < (int)files.size(); i++) {
+		checkpoint.Write(FileSize(files[i]));
+	}
+}
+
+/**
+ * Restores the ids of the properties and cuts the output files back to their sizes at the time of
+ * the checkpoint, since the continued integration writes the records after it again. The files which
+ * did not exist then are removed.
+ */
+int BinaryFileAdapter::LoadState(Checkpoint &checkpoint)
+{
+	checkpoint.Read(_propertyId);
+	checkpoint.Read(_compositionId);
+	checkpoint.Read(_phasesFileNumber);
+
+	vector<string> files;
+	OutputFiles(files);
+	vector<long long> size(files.size());
+	for (int i = 0; i < (int)files.size(); i++) {
+		checkpoint.Read(size[i]);
+	}
+	if (checkpoint.Failed()) {
+		Error::_errMsg = "The state of the output files could not be read from the checkpoint!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	for (int i = 0; i < (int)files.size(); i++) {
+		long long current = FileSize(files[i]);
+		if (size[i] < 0) {
+			if (current >= 0 && remove(files[i].c_str()) != 0) {
+				Error::_errMsg = "The file '" + files[i] + "' could not be removed!";
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+		}
+		else if (current < size[i]) {
+			Error::_errMsg = "The file '" + files[i] + "' is shorter than at the time of the checkpoint!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		else if (current > size[i]) {
+			if (Tools::TruncateFile(files[i], size[i]) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+		}
+	}
+	// The text files of the phases started after the checkpoint
+	for (int n = _phasesFileNumber + 1; FileSize(PhasesTextPath(n)) >= 0; n++) {
+		if (remove(PhasesTextPath(n).c_str()) != 0) {
+			Error::_errMsg = "The file '" + PhasesTextPath(n) + "' could not be removed!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+	}
+
+	return 0;
+}
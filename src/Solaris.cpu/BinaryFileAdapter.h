@@ -4,12 +4,14 @@
 #include <cstdint>
 #include <list>
 #include <string>
+#include <vector>
 #include "Counter.h"
 #include "SolarisType.h"
 #include "StopWatch.h"
 
 class Body;
 class BodyData;
+class Checkpoint;
 class Output;
 class TwoBodyAffair;
 
@@ -48,11 +50,19 @@ public:
 	void	SaveElapsedTimes(double time, StopWatch timer, output_type_t type);
 	void	SaveElapsedTimes(double time, StopWatch *timer, output_type_t type);
 
+	void	SaveState(Checkpoint &checkpoint);
+	int		LoadState(Checkpoint &checkpoint);
+
 private:
 	std::string _errMsg;
 	Output		*output;
 	static int	_propertyId;
 	static int	_compositionId;
+	// The number of the current text file of the phases, a new one is started when it exceeds 200 MB
+	static int	_phasesFileNumber;
+
+	std::string	PhasesTextPath(int number);
+	void	OutputFiles(std::vector<std::string>& files);
 };
 
 #endif
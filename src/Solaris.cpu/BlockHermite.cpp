@@ -0,0 +1,367 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "BlockHermite.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Checkpoint.h"
+#include "Constants.h"
+#include "Error.h"
+#include "TimeLine.h"
+#include "SolarisMacro.h"
+#include "SolarisType.h"
+
+// The deepest level, the times are counted in units of dtMax/2^LEVELMAX
+#define LEVELMAX	40
+// The accuracy parameter of the initial time-step criterion eta_s |a|/|j|
+#define STARTETA	0.01
+
+static inline long long Ticks(int level)
+{
+	return 1LL << (LEVELMAX - level);
+}
+
+BlockHermite::BlockHermite()
+{
+	name			= "Hermite with block time-steps";
+	reference		= "Makino, J. & Aarseth, S. J., 1992, PASJ 44, 141";
+	// The Hermite state, its accelerations and jerks, the new ones of the active bodies and the phases returned by the last step
+	nWorkspaceArray	= 4;
+
+	eta				= Constants::BlockHermiteEta;
+	nBlockStep		= 0;
+	nForce			= 0.0;
+	nSharedForce	= 0.0;
+	levelMax		= 0;
+
+	_dtMax			= 0.0;
+	_tBase			= 0.0;
+	_nLast			= 0;
+}
+
+int BlockHermite::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
+{
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+
+	int nAllocation = this->nAllocation;
+	int result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	double	*state = Workspace(0);
+	double	*aj = Workspace(1);
+	double	*ajNew = Workspace(2);
+	double	*yLast = Workspace(3);
+	double	*y = bodyData->y;
+
+	// The integration restarts from the phases if they were changed since the last step
+	if (nTotal != _nLast || nAllocation != this->nAllocation || memcmp(bodyData->y0, yLast, nVar*sizeof(double)) != 0) {
+		if (Start(bodyData, timeLine) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+	}
+
+	double		t = timeLine->time;
+	long long	tickNext = NextTick();
+	double		tNew = _tBase + tickNext*Tick();
+	// If the Simulator clipped the step to reach an output or the end time all bodies are synchronized there
+	bool		sync = fabs(timeLine->hNext) < fabs(tNew - t) - 0.5*fabs(Tick());
+	if (sync) {
+		tNew = t + timeLine->hNext;
+	}
+
+	_active.clear();
+	for (int i=0; i<nTotal; i++) {
+		if (sync || _tick[i] + Ticks(_level[i]) == tickNext) {
+			_active.push_back(i);
+		}
+	}
+	int nActive = (int)_active.size();
+
+	bodyData->time	= t;
+	bodyData->h		= tNew - t;
+
+	Predict(bodyData, tNew, y);
+	Force(bodyData, y, &_active[0], nActive, ajNew);
+
+	bool	parallel = nActive >= Constants::ParallelThreshold;
+	int		nFailed = 0;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) reduction(+:nFailed) if (parallel)
+#endif
+	for (int l=0; l<nActive; l++) {
+		int i = _active[l];
+		int i0 = 6*i;
+		double dt = tNew - (_tBase + _tick[i]*Tick());
+		double dt2 = SQR(dt);
+		double a2[3], a3[3];
+		for (int k=0; k<3; k++) {
+			double da = aj[i0 + k] - ajNew[i0 + k];
+			a2[k] = (-6.0*da - dt*(4.0*aj[i0 + 3 + k] + 2.0*ajNew[i0 + 3 + k]))/dt2;
+			a3[k] = (12.0*da + 6.0*dt*(aj[i0 + 3 + k] + ajNew[i0 + 3 + k]))/(dt2*dt);
+			y[i0 + k]	  += dt2*dt2*(a2[k]/24.0 + dt*a3[k]/120.0);
+			y[i0 + 3 + k] += dt2*dt*(a2[k]/6.0 + dt*a3[k]/24.0);
+		}
+		memcpy(&state[i0], &y[i0], 6*sizeof(double));
+		memcpy(&aj[i0], &ajNew[i0], 6*sizeof(double));
+
+		// The criterion of Aarseth with the derivatives at the end of the step
+		for (int k=0; k<3; k++) {
+			a2[k] += dt*a3[k];
+		}
+		double A  = sqrt(SQR(aj[i0 + 0]) + SQR(aj[i0 + 1]) + SQR(aj[i0 + 2]));
+		double J  = sqrt(SQR(aj[i0 + 3]) + SQR(aj[i0 + 4]) + SQR(aj[i0 + 5]));
+		double A2 = sqrt(SQR(a2[0]) + SQR(a2[1]) + SQR(a2[2]));
+		double A3 = sqrt(SQR(a3[0]) + SQR(a3[1]) + SQR(a3[2]));
+		double d  = J*A3 + SQR(A2);
+		int level = d > 0.0 ? Level(sqrt(eta*(A*A2 + SQR(J))/d)) : 0;
+		// The step can be at most doubled and only if the new time is commensurate with the doubled step
+		if (!sync && level < _level[i]) {
+			level = tickNext % Ticks(_level[i] - 1) == 0 ? _level[i] - 1 : _level[i];
+		}
+		if (level > LEVELMAX) {
+			nFailed++;
+			level = LEVELMAX;
+		}
+		_level[i] = level;
+		_tick[i]  = tickNext;
+	}
+	if (nFailed > 0) {
+		Error::_errMsg = "The individual time-step of a body became too small!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	// After a full step of the first level (or a synchronization) every body is at the new time
+	if (sync || tickNext == Ticks(0)) {
+		_tBase = tNew;
+		std::fill(_tick.begin(), _tick.end(), 0LL);
+	}
+	int deepest = *std::max_element(_level.begin(), _level.end());
+	levelMax = std::max(levelMax, deepest);
+
+	nBlockStep++;
+	nForce += nActive;
+	nSharedForce += nTotal*fabs(tNew - t)/fabs(_dtMax/(double)(1LL << deepest));
+	memcpy(yLast, y, nVar*sizeof(double));
+	_nLast = nTotal;
+
+	timeLine->hDid = tNew - t;
+	// Update time
+	timeLine->time += timeLine->hDid;
+	bodyData->time = timeLine->time;
+	// The next step ends at the next block time
+	timeLine->hNext = _tBase + NextTick()*Tick() - timeLine->time;
+	bodyData->h = timeLine->hNext;
+	// Update the phases of the system
+	std::swap(bodyData->y0, bodyData->y);
+
+	return 0;
+}
+
+/**
+ * Starts the integration from bodyData->y0: the forces of every body are computed and their levels are
+ * set by the initial criterion. The longest step is fixed at the first start, it is the power of two
+ * (in days) above the longest initial step.
+ */
+int BlockHermite::Start(BodyData *bodyData, TimeLine *timeLine)
+{
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	double	*state = Workspace(0);
+	double	*aj = Workspace(1);
+
+	memcpy(state, bodyData->y0, nVar*sizeof(double));
+	_active.clear();
+	for (int i=0; i<nTotal; i++) {
+		_active.push_back(i);
+	}
+	Force(bodyData, state, &_active[0], (int)_active.size(), aj);
+	nForce += _active.size();
+
+	if (_dtMax == 0.0) {
+		double dtLongest = 0.0;
+		for (int i=0; i<nTotal; i++) {
+			int i0 = 6*i;
+			double A = sqrt(SQR(aj[i0 + 0]) + SQR(aj[i0 + 1]) + SQR(aj[i0 + 2]));
+			double J = sqrt(SQR(aj[i0 + 3]) + SQR(aj[i0 + 4]) + SQR(aj[i0 + 5]));
+			if (J > 0.0) {
+				dtLongest = std::max(dtLongest, STARTETA*A/J);
+			}
+		}
+		if (dtLongest == 0.0) {
+			Error::_errMsg = "The initial time-steps of the bodies could not be determined!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		_dtMax = pow(2.0, ceil(log(dtLongest)/log(2.0)));
+	}
+	_dtMax = timeLine->hNext >= 0.0 ? fabs(_dtMax) : -fabs(_dtMax);
+
+	_level.resize(nTotal);
+	_tick.assign(nTotal, 0LL);
+	for (int i=0; i<nTotal; i++) {
+		int i0 = 6*i;
+		double A = sqrt(SQR(aj[i0 + 0]) + SQR(aj[i0 + 1]) + SQR(aj[i0 + 2]));
+		double J = sqrt(SQR(aj[i0 + 3]) + SQR(aj[i0 + 4]) + SQR(aj[i0 + 5]));
+		_level[i] = J > 0.0 ? Level(STARTETA*A/J) : 0;
+		if (_level[i] > LEVELMAX) {
+			Error::_errMsg = "The individual time-step of a body is too small!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		levelMax = std::max(levelMax, _level[i]);
+	}
+	_tBase = timeLine->time;
+	_nLast = nTotal;
+
+	return 0;
+}
+
+/**
+ * The accelerations and jerks of the bodies in the list from the phases y. As in Acceleration::GravityBC()
+ * every body feels the massive bodies only.
+ */
+void BlockHermite::Force(BodyData *bodyData, const double *y, const int *list, int n, double *aj)
+{
+	int		nMassive = bodyData->nBodies.NOfMassive();
+	bool	parallel = n >= Constants::ParallelThreshold;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+#endif
+	for (int l=0; l<n; l++) {
+		int i = list[l];
+		int i0 = 6*i;
+		const double *yi = &y[i0];
+		double a[3] = {0.0, 0.0, 0.0};
+		double jerk[3] = {0.0, 0.0, 0.0};
+		for (int j=0; j<nMassive; j++) {
+			if (j == i)
+				continue;
+			const double *yj = &y[6*j];
+			double dx[3] = {yj[0] - yi[0], yj[1] - yi[1], yj[2] - yi[2]};
+			double dv[3] = {yj[3] - yi[3], yj[4] - yi[4], yj[5] - yi[5]};
+			double rij2 = SQR(dx[0]) + SQR(dx[1]) + SQR(dx[2]);
+			double rvij = dx[0]*dv[0] + dx[1]*dv[1] + dx[2]*dv[2];
+			double cij = Constants::Gauss2*bodyData->mass[j]/(rij2*sqrt(rij2));
+			for (int k=0; k<3; k++) {
+				a[k]	+= cij*dx[k];
+				jerk[k] += cij*(dv[k] - 3.0*rvij/rij2*dx[k]);
+			}
+		}
+		for (int k=0; k<3; k++) {
+			aj[i0 + k]	   = a[k];
+			aj[i0 + 3 + k] = jerk[k];
+		}
+	}
+}
+
+/// The phases of every body predicted to t by its Taylor series from its last correction
+void BlockHermite::Predict(BodyData *bodyData, double t, double *y)
+{
+	int		nTotal = bodyData->nBodies.total;
+	double	*state = Workspace(0);
+	double	*aj = Workspace(1);
+	bool	parallel = nTotal >= Constants::ParallelThreshold;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=0; i<nTotal; i++) {
+		int i0 = 6*i;
+		double dt = t - (_tBase + _tick[i]*Tick());
+		for (int k=0; k<3; k++) {
+			y[i0 + k]	  = state[i0 + k] + dt*(state[i0 + 3 + k] + dt/2.0*(aj[i0 + k] + dt/3.0*aj[i0 + 3 + k]));
+			y[i0 + 3 + k] = state[i0 + 3 + k] + dt*(aj[i0 + k] + dt/2.0*aj[i0 + 3 + k]);
+		}
+	}
+}
+
+/// The shallowest level whose step is not longer than dt, it is larger than LEVELMAX if dt is too small
+int BlockHermite::Level(double dt) const
+{
+	if (!(dt < fabs(_dtMax))) {
+		return 0;
+	}
+	if (dt <= fabs(_dtMax)/(double)(1LL << LEVELMAX)) {
+		return LEVELMAX + 1;
+	}
+	return (int)ceil(log(fabs(_dtMax)/dt)/log(2.0));
+}
+
+/// The time of the next block step in ticks measured from _tBase
+long long BlockHermite::NextTick() const
+{
+	long long tick = Ticks(0);
+	for (size_t i=0; i<_level.size(); i++) {
+		tick = std::min(tick, _tick[i] + Ticks(_level[i]));
+	}
+	return tick;
+}
+
+double BlockHermite::Tick() const
+{
+	return _dtMax/(double)(1LL << LEVELMAX);
+}
+#undef LEVELMAX
+#undef STARTETA
+
+/**
+ * The Hermite state is saved only if it belongs to the current phases, otherwise the integration
+ * restarts from the phases as it would without the checkpoint.
+ */
+void BlockHermite::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	Integrator::SaveState(checkpoint, bodyData);
+	checkpoint.Write(nBlockStep);
+	checkpoint.Write(nForce);
+	checkpoint.Write(nSharedForce);
+	checkpoint.Write(levelMax);
+	checkpoint.Write(_dtMax);
+
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	bool	valid = nTotal == _nLast && _nLast > 0 && memcmp(bodyData->y0, Workspace(3), nVar*sizeof(double)) == 0;
+	checkpoint.Write(valid);
+	if (!valid) {
+		return;
+	}
+	checkpoint.Write(_tBase);
+	checkpoint.WriteVector(_level);
+	checkpoint.WriteVector(_tick);
+	checkpoint.WriteArray(Workspace(0), nVar);
+	checkpoint.WriteArray(Workspace(1), nVar);
+}
+
+int BlockHermite::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	int result = Integrator::LoadState(checkpoint, bodyData);
+	HANDLE_RESULT(result);
+	checkpoint.Read(nBlockStep);
+	checkpoint.Read(nForce);
+	checkpoint.Read(nSharedForce);
+	checkpoint.Read(levelMax);
+	checkpoint.Read(_dtMax);
+
+	bool valid = false;
+	checkpoint.Read(valid);
+	if (!valid || checkpoint.Failed()) {
+		_nLast = 0;
+		return 0;
+	}
+
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	checkpoint.Read(_tBase);
+	checkpoint.ReadVector(_level);
+	checkpoint.ReadVector(_tick);
+	checkpoint.ReadArray(Workspace(0), nVar);
+	checkpoint.ReadArray(Workspace(1), nVar);
+	memcpy(Workspace(3), bodyData->y0, nVar*sizeof(double));
+	_nLast = nTotal;
+
+	return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef BLOCKHERMITE_H_
+#define BLOCKHERMITE_H_
+
+#include <string>
+#include <vector>
+
+#include "Integrator.h"
+
+class Acceleration;
+class BodyData;
+class Checkpoint;
+class TimeLine;
+
+/**
+ * Fourth order Hermite predictor-corrector with hierarchical individual time-steps. Every body has its
+ * own step dtMax/2^k chosen by the criterion of Aarseth, the bodies of the same level form a block.
+ * A Driver() call advances the block(s) due at the next block time: only their forces are evaluated,
+ * the other bodies are predicted to that time. The phases returned in bodyData->y0 are therefore
+ * synchronized, the Hermite state of the bodies is kept in the workspace. If the Simulator changes
+ * the phases (e.g. a merger or the removal of a body) the integration restarts from them.
+ * The integrator works in the barycentric frame: in the astrocentric one the indirect terms of a
+ * close-in planet would force its short step on every body. The forces of the nebula are not supported.
+ */
+class BlockHermite : public Integrator
+{
+public:
+	BlockHermite();
+
+	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
+	void		SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	int			LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+	// The accuracy parameter of the time-step criterion
+	double		eta;
+	// The number of block steps and of the force evaluations of individual bodies
+	int			nBlockStep;
+	double		nForce;
+	// The number of force evaluations a shared step equal to the smallest individual one would have needed
+	double		nSharedForce;
+	// The deepest level used so far
+	int			levelMax;
+
+private:
+	int			Start(BodyData *bodyData, TimeLine *timeLine);
+	void		Force(BodyData *bodyData, const double *y, const int *list, int n, double *aj);
+	void		Predict(BodyData *bodyData, double t, double *y);
+	int			Level(double dt) const;
+	long long	NextTick() const;
+	double		Tick() const;
+
+	// The level and the time of the last correction of the bodies in ticks measured from _tBase
+	std::vector<int>		_level;
+	std::vector<long long>	_tick;
+	// The bodies corrected by the current block step
+	std::vector<int>		_active;
+
+	// The longest step (signed), and the time when all bodies were synchronized for the last time
+	double		_dtMax;
+	double		_tBase;
+	// The number of bodies at the end of the last step
+	int			_nLast;
+};
+
+#endif
@@ -7,6 +7,10 @@
 
 int Body::_bodyId = 0;
 
+Pool<Phase>				Body::phasePool;
+Pool<OrbitalElement>	Body::orbitalElementPool;
+Pool<Characteristics>	Body::characteristicsPool;
+
 Body::Body() 
 {
 	_id				= Body::_bodyId++;
@@ -6,6 +6,7 @@
 #include "Phase.h"
 #include "OrbitalElement.h"
 #include "Characteristics.h"
+#include "Pool.h"
 #include "SolarisType.h"
 
 class Phase;
@@ -51,6 +52,12 @@ public:
 	// id of the class Body, its value will be assigned to the next instance of Body
 	// guaranteeing the uniqueness of the _id field of each Body object.
 	static int _bodyId;
+
+	// The phases, orbital elements and characteristics of the bodies are created in these pools,
+	// they live until the end of the run
+	static Pool<Phase>				phasePool;
+	static Pool<OrbitalElement>		orbitalElementPool;
+	static Pool<Characteristics>	characteristicsPool;
 };
 
 #endif
@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 #include "BodyData.h"
+#include "Checkpoint.h"
 #include "Error.h"
 
 BodyData::BodyData()
@@ -29,6 +32,8 @@ BodyData::BodyData()
 	accel		 = 0;
 	error		 = 0;
 
+	_capacity	 = 0;
+
 	bc[0] = bc[1] = bc[2] = bc[3] = bc[4] = bc[5] = 0.0;
 	phaseOfBC.position.x = phaseOfBC.position.y = phaseOfBC.position.z = 0.0;
 	phaseOfBC.velocity.x = phaseOfBC.velocity.y = phaseOfBC.velocity.z = 0.0;
@@ -182,10 +187,186 @@ int BodyData::Allocate()
 		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 		return 1;
 	}
+	_capacity = nBodies.total;
+
+	return 0;
+}
+
+// Replaces the array a by one of capacity elements, which starts with the first n elements of a
+template<class T> static bool Reallocate(T *&a, int n, int capacity)
+{
+	T *b = new T[capacity];
+	if (b == 0) {
+		return false;
+	}
+	if (n > 0) {
+		memcpy(b, a, n*sizeof(T));
+	}
+	delete[] a;
+	a = b;
+
+	return true;
+}
+
+/// Makes room for capacity bodies, the data of the current bodies is kept
+int BodyData::Reserve(int capacity)
+{
+	if (capacity <= _capacity) {
+		return 0;
+	}
+
+	int n = nBodies.total;
+	bool allocated =
+		Reallocate(id, n, capacity)				&& Reallocate(type, n, capacity)		&&
+		Reallocate(migType, n, capacity)		&& Reallocate(migStopAt, n, capacity)	&&
+		Reallocate(indexOfNN, n, capacity)		&& Reallocate(distanceOfNN, n, capacity)	&&
+		Reallocate(mass, n, capacity)			&& Reallocate(radius, n, capacity)		&&
+		Reallocate(density, n, capacity)		&& Reallocate(cD, n, capacity)			&&
+		Reallocate(gammaStokes, n, capacity)	&& Reallocate(gammaEpstein, n, capacity)	&&
+		Reallocate(y0, 6*n, 6*capacity)			&& Reallocate(y, 6*n, 6*capacity)		&&
+		Reallocate(yBetterEst, 0, 6*capacity)	&& Reallocate(yscale, 0, 6*capacity)	&&
+		Reallocate(accel, 6*n, 6*capacity)		&& Reallocate(error, 0, 6*capacity);
+	if (!allocated) {
+		Error::_errMsg = "host memory allocation";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	_capacity = capacity;
+
+	return 0;
+}
+
+/**
+ * Opens a gap for n bodies of the given type at index, the bodies from index are moved up by n. The
+ * capacity is at least doubled when the arrays are full, so the body groups can be included one by one
+ * without copying all bodies at each of them. The caller sets the data of the new bodies, and maps their
+ * ids by BuildIdIndex(index, n).
+ */
+int BodyData::Insert(int index, int n, body_type_t bodyType)
+{
+	int nOld = nBodies.total;
+	if (nOld + n > _capacity && Reserve(2*_capacity > nOld + n ? 2*_capacity : nOld + n) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	if (nBodies.UpdateAfterInsert(bodyType, n) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	int m = nOld - index;
+	memmove(&id[index + n],				&id[index],				m*sizeof(int));
+	memmove(&type[index + n],			&type[index],			m*sizeof(int));
+	memmove(&migType[index + n],		&migType[index],		m*sizeof(int));
+	memmove(&migStopAt[index + n],		&migStopAt[index],		m*sizeof(double));
+	memmove(&indexOfNN[index + n],		&indexOfNN[index],		m*sizeof(int));
+	memmove(&distanceOfNN[index + n],	&distanceOfNN[index],	m*sizeof(double));
+	memmove(&mass[index + n],			&mass[index],			m*sizeof(double));
+	memmove(&radius[index + n],			&radius[index],			m*sizeof(double));
+	memmove(&density[index + n],		&density[index],		m*sizeof(double));
+	memmove(&cD[index + n],				&cD[index],				m*sizeof(double));
+	memmove(&gammaStokes[index + n],	&gammaStokes[index],	m*sizeof(double));
+	memmove(&gammaEpstein[index + n],	&gammaEpstein[index],	m*sizeof(double));
+	memmove(&y0[6*(index + n)],			&y0[6*index],			6*m*sizeof(double));
+	memmove(&y[6*(index + n)],			&y[6*index],			6*m*sizeof(double));
+	memmove(&accel[6*(index + n)],		&accel[6*index],		6*m*sizeof(double));
+
+	for (int i=0; i<nBodies.total; i++) {
+		if (index <= i && i < index + n) {
+			indexOfNN[i] = -1;
+			distanceOfNN[i] = 0.0;
+		}
+		else if (indexOfNN[i] >= index) {
+			indexOfNN[i] += n;
+		}
+	}
+	for (int i=index + n; i<nBodies.total; i++) {
+		_indexOfId[id[i]] = i;
+	}
+
+	return 0;
+}
+
+/**
+ * Removes the bodies at the given indices in one pass: the remaining bodies are moved down to close the
+ * gaps and keep their order, so the bodies stay sorted by their type. The indices are sorted and the
+ * duplicates are dropped. The indexOfNN of the remaining bodies is renumbered.
+ */
+int BodyData::Remove(std::vector<int> &index)
+{
+	if (index.empty()) {
+		return 0;
+	}
+	std::sort(index.begin(), index.end());
+	index.erase(std::unique(index.begin(), index.end()), index.end());
+
+	int n = nBodies.total;
+	for (std::vector<int>::const_iterator it = index.begin(); it != index.end(); it++) {
+		if (nBodies.UpdateAfterRemove((body_type_t)(type[*it])) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		_indexOfId.erase(id[*it]);
+	}
+
+	_newIndex.assign(n, -1);
+	int j = index[0];
+	for (int i=0; i<j; i++) {
+		_newIndex[i] = i;
+	}
+	std::vector<int>::const_iterator next = index.begin();
+	for (int i=index[0]; i<n; i++) {
+		if (next != index.end() && *next == i) {
+			next++;
+			continue;
+		}
+		id[j] = id[i];
+		type[j] = type[i];
+		migType[j] = migType[i];
+		migStopAt[j] = migStopAt[i];
+		indexOfNN[j] = indexOfNN[i];
+		distanceOfNN[j] = distanceOfNN[i];
+
+		mass[j] = mass[i];
+		radius[j] = radius[i];
+		density[j] = density[i];
+		cD[j] = cD[i];
+		gammaStokes[j] = gammaStokes[i];
+		gammaEpstein[j] = gammaEpstein[i];
+
+		memcpy(&y0[6*j], &y0[6*i], 6*sizeof(double));
+		memcpy(&y[6*j], &y[6*i], 6*sizeof(double));
+		memcpy(&accel[6*j], &accel[6*i], 6*sizeof(double));
+
+		_newIndex[i] = j;
+		_indexOfId[id[j]] = j;
+		j++;
+	}
+
+	for (int i=0; i<nBodies.total; i++) {
+		if (indexOfNN[i] >= 0) {
+			indexOfNN[i] = _newIndex[indexOfNN[i]];
+		}
+	}
 
 	return 0;
 }
 
+/// Maps the ids of the n bodies from first to their indices, it must be called after the ids are set
+void BodyData::BuildIdIndex(int first, int n)
+{
+	for (int i=first; i<first + n; i++) {
+		_indexOfId[id[i]] = i;
+	}
+}
+
+int BodyData::IndexOf(int bodyId) const
+{
+	std::unordered_map<int, int>::const_iterator it = _indexOfId.find(bodyId);
+
+	return it != _indexOfId.end() ? it->second : -1;
+}
+
 void BodyData::Free()
 {
 	delete[] id;
@@ -207,4 +388,94 @@ void BodyData::Free()
 	delete[] yscale;
 	delete[] accel;
 	delete[] error;
+
+	_indexOfId.clear();
+	_capacity = 0;
+}
+
+/**
+ * Writes the bodies and the integrals into the checkpoint. The ids and the two phase arrays, which the
+ * integrators swap at every step, are saved together with the nBodies.removed elements after the bodies,
+ * since the phase files list the removed bodies from there. The other arrays of the steps are not saved.
+ */
+void BodyData::SaveState(Checkpoint &checkpoint)
+{
+	int n = nBodies.total;
+	int nArray = nBodies.total + nBodies.removed;
+
+	checkpoint.Write(nBodies);
+	checkpoint.Write(time);
+	checkpoint.Write(h);
+	checkpoint.WriteArray(id, nArray);
+	checkpoint.WriteArray(type, n);
+	checkpoint.WriteArray(migType, n);
+	checkpoint.WriteArray(migStopAt, n);
+	checkpoint.WriteArray(indexOfNN, n);
+	checkpoint.WriteArray(distanceOfNN, n);
+	checkpoint.WriteArray(mass, n);
+	checkpoint.WriteArray(radius, n);
+	checkpoint.WriteArray(density, n);
+	checkpoint.WriteArray(cD, n);
+	checkpoint.WriteArray(gammaStokes, n);
+	checkpoint.WriteArray(gammaEpstein, n);
+	checkpoint.WriteArray(y0, 6*nArray);
+	checkpoint.WriteArray(y, 6*nArray);
+
+	checkpoint.WriteArray(bc, 6);
+	checkpoint.Write(phaseOfBC.bodyId);
+	checkpoint.Write(phaseOfBC.position);
+	checkpoint.Write(phaseOfBC.velocity);
+	checkpoint.WriteArray(angularMomentum, 2);
+	checkpoint.WriteArray(kineticEnergy, 2);
+	checkpoint.WriteArray(potentialEnergy, 2);
+	checkpoint.WriteArray(totalEnergy, 2);
+	checkpoint.WriteArray(integrals, 16);
+}
+
+/// Replaces the bodies by those of the checkpoint.
+int BodyData::LoadState(Checkpoint &checkpoint)
+{
+	Free();
+	checkpoint.Read(nBodies);
+	if (checkpoint.Failed() || nBodies.total <= 0) {
+		Error::_errMsg = "The bodies could not be read from the checkpoint!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	int n = nBodies.total;
+	int nArray = nBodies.total + nBodies.removed;
+	if (Allocate() == 1 || Reserve(nArray) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	checkpoint.Read(time);
+	checkpoint.Read(h);
+	checkpoint.ReadArray(id, nArray);
+	checkpoint.ReadArray(type, n);
+	checkpoint.ReadArray(migType, n);
+	checkpoint.ReadArray(migStopAt, n);
+	checkpoint.ReadArray(indexOfNN, n);
+	checkpoint.ReadArray(distanceOfNN, n);
+	checkpoint.ReadArray(mass, n);
+	checkpoint.ReadArray(radius, n);
+	checkpoint.ReadArray(density, n);
+	checkpoint.ReadArray(cD, n);
+	checkpoint.ReadArray(gammaStokes, n);
+	checkpoint.ReadArray(gammaEpstein, n);
+	checkpoint.ReadArray(y0, 6*nArray);
+	checkpoint.ReadArray(y, 6*nArray);
+
+	checkpoint.ReadArray(bc, 6);
+	checkpoint.Read(phaseOfBC.bodyId);
+	checkpoint.Read(phaseOfBC.position);
+	checkpoint.Read(phaseOfBC.velocity);
+	checkpoint.ReadArray(angularMomentum, 2);
+	checkpoint.ReadArray(kineticEnergy, 2);
+	checkpoint.ReadArray(potentialEnergy, 2);
+	checkpoint.ReadArray(totalEnergy, 2);
+	checkpoint.ReadArray(integrals, 16);
+	BuildIdIndex(0, n);
+
+	return 0;
 }
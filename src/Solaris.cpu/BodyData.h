@@ -1,10 +1,16 @@
 #ifndef BODYDATA_H_
 #define BODYDATA_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "NBodies.h"
 #include "Phase.h"
+#include "SolarisType.h"
 #include "Vector.h"
 
+class Checkpoint;
+
 class BodyData {
 public:
 
@@ -12,8 +18,17 @@ public:
 	~BodyData();
 
 	int Allocate();
+	int Insert(int index, int n, body_type_t bodyType);
+	int Remove(std::vector<int> &index);
 	void Free();
 
+	void SaveState(Checkpoint &checkpoint);
+	int LoadState(Checkpoint &checkpoint);
+
+	void BuildIdIndex(int first, int n);
+	// The index of the body with the given id, or -1 if there is no such body
+	int IndexOf(int bodyId) const;
+
 	NBodies nBodies;
 
 	double	time;
@@ -48,6 +63,16 @@ public:
 	double	potentialEnergy[2];
 	double	totalEnergy[2];
 	double	integrals[16];
+
+private:
+	int Reserve(int capacity);
+
+	// The number of bodies the arrays can hold
+	int								_capacity;
+	// The index of the bodies by their id, maintained by Insert() and Remove()
+	std::unordered_map<int, int>	_indexOfId;
+	// The index of the bodies after the last Remove(), -1 for the removed ones
+	std::vector<int>				_newIndex;
 };
 
 #endif
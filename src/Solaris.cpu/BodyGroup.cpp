@@ -89,7 +89,7 @@ BodyGroup::BodyGroup(std::string guid, std::string description, std::string epoc
 int BodyGroup::CountBy(body_type_t type)
 {
 	int	result = 0;
-	for (std::list<Body>::iterator bodyIterator = items.begin(); bodyIterator != items.end(); bodyIterator++) {
+	for (std::vector<Body>::iterator bodyIterator = items.begin(); bodyIterator != items.end(); bodyIterator++) {
 		if (bodyIterator->type == type)
 			result++;
 	}
@@ -102,7 +102,7 @@ int BodyGroup::CountBy(body_type_t type)
 int BodyGroup::CountBy(double mass)
 {
     int result = 0;
-	for (std::list<Body>::iterator bodyIterator = items.begin(); bodyIterator != items.end(); bodyIterator++) {
+	for (std::vector<Body>::iterator bodyIterator = items.begin(); bodyIterator != items.end(); bodyIterator++) {
 		if (bodyIterator->type == BODY_TYPE_TESTPARTICLE)
 			continue;
 		if (bodyIterator->characteristics->mass >= mass)
@@ -116,7 +116,7 @@ int BodyGroup::CountBy(double mass)
 /// In case of equality the reference of the Body is added to the result.
 void BodyGroup::FindBy(body_type_t type, std::list<Body *> &result)
 {
-	for (std::list<Body>::iterator it = items.begin(); it != items.end(); it++) {
+	for (std::vector<Body>::iterator it = items.begin(); it != items.end(); it++) {
 		if (it->type == type) {
 			result.push_back(&(*it));
 		}
@@ -156,7 +156,7 @@ int BodyGroup::SetStartTime(double startTimeOfMainSimulation)
 /// </summary>
 bool BodyGroup::ContainsMassiveBody()
 {
-	for (std::list<Body>::iterator it = items.begin(); it != items.end(); it++) {
+	for (std::vector<Body>::iterator it = items.begin(); it != items.end(); it++) {
 		if (it->type == BODY_TYPE_TESTPARTICLE)
 			continue;
 
@@ -169,7 +169,7 @@ bool BodyGroup::ContainsMassiveBody()
 /// Iterates over the Bodies and stores their reference in the result parameter.
 int BodyGroup::ToBodyList(std::list<Body *> &result)
 {
-	for (std::list<Body>::iterator it = items.begin(); it != items.end(); it++) {
+	for (std::vector<Body>::iterator it = items.begin(); it != items.end(); it++) {
 		result.push_back(&(*it));
 	}
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 
 #include "Body.h"
 
@@ -32,7 +33,8 @@ public:
 		return (rhs._id == _id);
     }
 
-	std::list<Body> items;
+	// The bodies of the group are stored contiguously
+	std::vector<Body> items;
 
 	double		offset;
 	double		startTime;
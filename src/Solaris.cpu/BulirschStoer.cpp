@@ -0,0 +1,403 @@
+#include <cmath>
+#include <algorithm>
+
+#include "BulirschStoer.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Checkpoint.h"
+#include "Constants.h"
+#include "Error.h"
+#include "TimeLine.h"
+#include "SolarisMacro.h"
+
+// The index of the last column of the extrapolation table, the step tries at most KMAX + 1 columns
+#define KMAX		8
+
+BulirschStoer::BulirschStoer()
+{
+	name		= "Bulirsch-Stoer";
+	reference	= "Hairer, E., Norsett, S. P. & Wanner, G., 1993, Solving Ordinary Differential Equations I., Springer, Section II.9.";
+	// f0, the two arrays of the modified midpoint rule, the derivatives at a substep and the KMAX
+	// columns of the extrapolation table
+	nWorkspaceArray	= 4 + KMAX;
+
+	nEvaluation		= 0;
+
+	// The step number sequence 2, 4, 6, ... and the evaluations needed to complete the kth column
+	// (including the one at the initial point)
+	for (int k = 0; k <= KMAX; k++) {
+		nSeq[k] = 2*(k + 1);
+		work[k] = k == 0 ? nSeq[0] + 1 : work[k - 1] + nSeq[k];
+		for (int l = 0; l <= KMAX; l++) {
+			double ratio = (double)nSeq[k]/nSeq[l];
+			coeff[k][l] = l < k ? 1.0/(ratio*ratio - 1.0) : 0.0;
+		}
+		_hOpt[k] = 0.0;
+		_cost[k] = 0.0;
+	}
+
+	// The target column is set from epsilon by the first Driver() call
+	_kTarget	= 0;
+	_firstStep	= true;
+	_prevReject	= false;
+}
+
+// constants for the step size and order control
+#define STEPFAC1	0.65
+#define STEPFAC2	0.94
+#define STEPFAC3	0.02
+#define STEPFAC4	4.0
+#define KFAC1		0.8
+#define KFAC2		0.9
+// For the scaling used to monitor accuracy
+#define TINY		1.0e-30
+
+int BulirschStoer::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
+{
+	int result = AllocateWorkspace(bodyData->nBodies.NOfVar());
+	HANDLE_RESULT(result);
+
+	bodyData->time	= timeLine->time;
+	bodyData->h		= timeLine->hNext;
+
+	// The forces of the nebula are evaluated at every substep, since the extrapolation requires
+	// the same smooth right-hand side in every sequence
+	acceleration->evaluateGasDrag			= true;
+	acceleration->evaluateTypeIMigration	= true;
+	acceleration->evaluateTypeIIMigration	= true;
+
+	// Calculate the derivatives in the initial point, they are shared by all sequences
+	result = acceleration->Compute(timeLine->time, bodyData->y0, Workspace(0));
+	HANDLE_RESULT(result);
+	nEvaluation++;
+
+	if (_kTarget == 0) {
+		_kTarget = std::max(1, std::min(KMAX - 1, (int)(-log10(epsilon + 1.0e-12)*0.6 + 1.5)));
+	}
+
+	int		k = 0;
+	bool	reject = false;
+	double	hNew = 0.0;
+	while ( 1 ) {
+		if (Step(bodyData, acceleration, k, reject, hNew) == 1) {
+			Error::_errMsg = "An error occurred during Bulirsch-Stoer step!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (!reject) {
+			break;
+		}
+		nRejectedStep++;
+		_prevReject = true;
+		if (fabs(hNew) < 1.0 / 86400.0) /* = 1 sec */ {
+			Error::_errMsg = "Stepsize-underflow occurred during Bulirsch-Stoer step!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		bodyData->h = hNew;
+	}
+	double	h = bodyData->h;
+	_firstStep = false;
+
+	// The column of the next step is the one with the smallest work per unit step among the
+	// neighbours of the converged column k
+	int kOpt = 0;
+	if (k == 1) {
+		kOpt = 2;
+	}
+	else if (k <= _kTarget) {
+		kOpt = k;
+		if (_cost[k - 1] < KFAC1*_cost[k]) {
+			kOpt = k - 1;
+		}
+		else if (_cost[k] < KFAC2*_cost[k - 1]) {
+			kOpt = std::min(k + 1, KMAX - 1);
+		}
+	}
+	else {
+		kOpt = k - 1;
+		if (k > 2 && _cost[k - 2] < KFAC1*_cost[k - 1]) {
+			kOpt = k - 2;
+		}
+		if (_cost[k] < KFAC2*_cost[kOpt]) {
+			kOpt = std::min(k, KMAX - 1);
+		}
+	}
+	if (_prevReject) {
+		// After a rejection neither the order nor the step size is increased
+		_kTarget = std::min(kOpt, k);
+		hNew = std::min(fabs(h), _hOpt[_kTarget]);
+		_prevReject = false;
+	}
+	else {
+		if (kOpt <= k) {
+			hNew = _hOpt[kOpt];
+		}
+		else if (k < _kTarget && _cost[k] < KFAC2*_cost[k - 1]) {
+			hNew = _hOpt[k]*work[kOpt + 1]/work[k];
+		}
+		else {
+			hNew = _hOpt[k]*work[kOpt]/work[k];
+		}
+		_kTarget = kOpt;
+	}
+
+	timeLine->hDid = h;
+	// Update time
+	timeLine->time += timeLine->hDid;
+	bodyData->time = timeLine->time;
+	// Calculate the next stepsize
+	timeLine->hNext = h >= 0.0 ? hNew : -hNew;
+	bodyData->h = timeLine->hNext;
+	// Update the phases of the system
+	std::swap(bodyData->y0, bodyData->y);
+
+	return 0;
+}
+
+/**
+ * Computes the columns of the extrapolation table up to _kTarget + 1 and stops at the first one
+ * which is accurate enough, or rejects the step if convergence is not expected within the target
+ * columns. On return k is the last column computed, the extrapolated phases are in bodyData->y,
+ * and if the step was rejected hNew is the step size to retry with.
+ */
+int BulirschStoer::Step(BodyData *bodyData, Acceleration *acceleration, int &k, bool &reject, double &hNew)
+{
+	int		nVar = bodyData->nBodies.NOfVar();
+	double	h = bodyData->h;
+
+	reject = false;
+	for (k = 0; k <= _kTarget + 1; k++) {
+		// The first sequence is the initial value of the extrapolation, the others fill the table
+		double *yOut = k == 0 ? bodyData->y : Workspace(4 + k - 1);
+		if (ModifiedMidpoint(bodyData, acceleration, nSeq[k], yOut) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (k == 0) {
+			continue;
+		}
+		Extrapolate(k, nVar, bodyData->y);
+
+		double err = ErrorMax(bodyData, Workspace(4));
+		double expo = 1.0/(2*k + 1);
+		double facMin = pow(STEPFAC3, expo);
+		double fac = 0.0;
+		if (err == 0.0) {
+			fac = 1.0/facMin;
+		}
+		else {
+			fac = STEPFAC2/pow(err/STEPFAC1, expo);
+			fac = std::max(facMin/STEPFAC4, std::min(1.0/facMin, fac));
+		}
+		_hOpt[k] = fabs(h*fac);
+		_cost[k] = work[k]/_hOpt[k];
+
+		if (_firstStep && err <= 1.0) {
+			break;
+		}
+		// The convergence window is the columns _kTarget - 1, _kTarget and _kTarget + 1. The step is
+		// rejected early if the error is not expected to drop below the tolerance within the window.
+		if (k == _kTarget - 1 && !_prevReject && !_firstStep) {
+			if (err <= 1.0) {
+				break;
+			}
+			double ratio = (double)nSeq[_kTarget]*nSeq[_kTarget + 1]/(nSeq[0]*nSeq[0]);
+			if (err > ratio*ratio) {
+				reject = true;
+				_kTarget = k;
+				if (_kTarget > 1 && _cost[k - 1] < KFAC1*_cost[k]) {
+					_kTarget--;
+				}
+				hNew = _hOpt[_kTarget];
+				break;
+			}
+		}
+		if (k == _kTarget) {
+			if (err <= 1.0) {
+				break;
+			}
+			double ratio = (double)nSeq[k + 1]/nSeq[0];
+			if (err > ratio*ratio) {
+				reject = true;
+				if (_kTarget > 1 && _cost[k - 1] < KFAC1*_cost[k]) {
+					_kTarget--;
+				}
+				hNew = _hOpt[_kTarget];
+				break;
+			}
+		}
+		if (k == _kTarget + 1) {
+			if (err > 1.0) {
+				reject = true;
+				if (_kTarget > 1 && _cost[_kTarget - 1] < KFAC1*_cost[_kTarget]) {
+					_kTarget--;
+				}
+				hNew = _hOpt[_kTarget];
+			}
+			break;
+		}
+	}
+	if (reject) {
+		hNew = h >= 0.0 ? hNew : -hNew;
+	}
+	nTrialStep++;
+
+	return 0;
+}
+
+/// The modified midpoint rule from bodyData->y0 over bodyData->h with nStep substeps, the derivatives at the initial point are in Workspace(0)
+int BulirschStoer::ModifiedMidpoint(BodyData *bodyData, Acceleration *acceleration, int nStep, double *yOut)
+{
+	int		nVar = bodyData->nBodies.NOfVar();
+	bool	parallel = nVar >= Constants::ParallelVarThreshold;
+	double	t = bodyData->time;
+	double	hs = bodyData->h/nStep;
+
+	const double* __restrict y0 = bodyData->y0;
+	const double* __restrict f0 = Workspace(0);
+	double* __restrict ym = Workspace(1);
+	double* __restrict yn = Workspace(2);
+	double* __restrict f = Workspace(3);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=0; i<nVar; i++) {
+		ym[i] = y0[i];
+		yn[i] = y0[i] + hs*f0[i];
+	}
+	for (int m=1; m<nStep; m++) {
+		int result = acceleration->Compute(t + m*hs, yn, f);
+		HANDLE_RESULT(result);
+		nEvaluation++;
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static) if (parallel)
+#endif
+		for (int i=0; i<nVar; i++) {
+			ym[i] += 2.0*hs*f[i];
+		}
+		std::swap(ym, yn);
+	}
+	int result = acceleration->Compute(t + bodyData->h, yn, f);
+	HANDLE_RESULT(result);
+	nEvaluation++;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=0; i<nVar; i++) {
+		yOut[i] = 0.5*(ym[i] + yn[i] + hs*f[i]);
+	}
+
+	// The first pass reads y0 and f0 and writes ym and yn, a substep reads f and updates ym, the last
+	// pass reads three arrays and writes yOut
+	nStageByte += (4 + 3*(nStep - 1) + 4) * (double)nVar * sizeof(double);
+
+	return 0;
+}
+
+/**
+ * Aitken-Neville extrapolation in h^2 with the kth column just computed. The table is kept in reverse
+ * order: on entry Workspace(4 + k - 1) holds the new sequence and y the diagonal element of the
+ * previous row, on return Workspace(4) holds T(k, k-1) and y the new diagonal element T(k, k).
+ */
+void BulirschStoer::Extrapolate(int k, int nVar, double *y)
+{
+	bool	parallel = nVar >= Constants::ParallelVarThreshold;
+
+	for (int j=k-1; j>0; j--) {
+		double* __restrict tj = Workspace(4 + j);
+		double* __restrict tj1 = Workspace(4 + j - 1);
+		double c = coeff[k][j];
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static) if (parallel)
+#endif
+		for (int i=0; i<nVar; i++) {
+			tj1[i] = tj[i] + c*(tj[i] - tj1[i]);
+		}
+	}
+	double* __restrict t0 = Workspace(4);
+	double c = coeff[k][0];
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if (parallel)
+#endif
+	for (int i=0; i<nVar; i++) {
+		y[i] = t0[i] + c*(t0[i] - y[i]);
+	}
+
+	nStageByte += 3*k * (double)nVar * sizeof(double);
+}
+
+/// The largest difference of the last two elements of the diagonal scaled as in RungeKuttaFehlberg78 and divided by epsilon
+double BulirschStoer::ErrorMax(BodyData *bodyData, const double *yPrev)
+{
+	int		nVar = bodyData->nBodies.NOfVar();
+	bool	parallel = nVar >= Constants::ParallelVarThreshold;
+	double	h = bodyData->h;
+
+	const double* __restrict y0 = bodyData->y0;
+	const double* __restrict f0 = Workspace(0);
+	const double* __restrict y = bodyData->y;
+	double* __restrict yerr = bodyData->error;
+	double* __restrict yscale = bodyData->yscale;
+	double errMax = 0.0;
+#ifdef _OPENMP
+	#pragma omp parallel if (parallel)
+#endif
+	{
+		double errMaxLocal = 0.0;
+#ifdef _OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (int i=0; i<nVar; i++) {
+			double err = fabs(y[i] - yPrev[i]);
+			yerr[i] = err;
+			yscale[i] = fabs(y0[i]) + fabs(h*f0[i]) + TINY;
+			err /= yscale[i];
+			errMaxLocal = err > errMaxLocal ? err : errMaxLocal;
+		}
+#ifdef _OPENMP
+		#pragma omp critical
+#endif
+		{
+			if (errMaxLocal > errMax)
+				errMax = errMaxLocal;
+		}
+	}
+
+	return errMax / epsilon;
+}
+
+#undef KMAX
+#undef STEPFAC1
+#undef STEPFAC2
+#undef STEPFAC3
+#undef STEPFAC4
+#undef KFAC1
+#undef KFAC2
+#undef TINY
+
+void BulirschStoer::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	Integrator::SaveState(checkpoint, bodyData);
+	checkpoint.Write(nEvaluation);
+	checkpoint.WriteArray(_hOpt, 9);
+	checkpoint.WriteArray(_cost, 9);
+	checkpoint.Write(_kTarget);
+	checkpoint.Write(_firstStep);
+	checkpoint.Write(_prevReject);
+}
+
+int BulirschStoer::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	int result = Integrator::LoadState(checkpoint, bodyData);
+	HANDLE_RESULT(result);
+	checkpoint.Read(nEvaluation);
+	checkpoint.ReadArray(_hOpt, 9);
+	checkpoint.ReadArray(_cost, 9);
+	checkpoint.Read(_kTarget);
+	checkpoint.Read(_firstStep);
+	checkpoint.Read(_prevReject);
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef BULIRSCHSTOER_H_
+#define BULIRSCHSTOER_H_
+
+#include <string>
+#include "Integrator.h"
+
+class Acceleration;
+class BodyData;
+class Checkpoint;
+class TimeLine;
+
+/**
+ * Gragg-Bulirsch-Stoer extrapolation integrator. The step is computed by the modified midpoint rule
+ * with n = 2, 4, 6, ... substeps and the results are extrapolated to zero substep length by
+ * polynomials in h^2. Both the number of columns (the order) and the step size are chosen to
+ * minimize the work per unit step, as in the ODEX code of Hairer & Wanner.
+ */
+class BulirschStoer : public Integrator
+{
+public:
+	BulirschStoer();
+
+	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
+	void		SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	int			LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+	// The number of the evaluations of the accelerations
+	int			nEvaluation;
+
+private:
+	int			Step(BodyData *bodyData, Acceleration *acceleration, int &k, bool &reject, double &hNew);
+	int			ModifiedMidpoint(BodyData *bodyData, Acceleration *acceleration, int nStep, double *yOut);
+	void		Extrapolate(int k, int nVar, double *y);
+	double		ErrorMax(BodyData *bodyData, const double *yPrev);
+
+	// The number of substeps of the (at most 9) columns, the cumulative number of evaluations up to
+	// them and the coefficients of the extrapolation
+	int			nSeq[9];
+	double		work[9];
+	double		coeff[9][9];
+
+	// The optimal step size and the work per unit step of the columns computed by the last Step()
+	double		_hOpt[9];
+	double		_cost[9];
+	// The column in which convergence is expected
+	int			_kTarget;
+	bool		_firstStep;
+	bool		_prevReject;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#ifdef WIN32
+	#include <io.h>
+	#include <Windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "Checkpoint.h"
+#include "Error.h"
+
+// The first bytes of a checkpoint file
+static const char Tag[8] = { 'S', 'O', 'L', 'A', 'R', 'I', 'S', 'C' };
+
+Checkpoint::Checkpoint()
+{
+	_file	= 0;
+	_failed	= false;
+}
+
+Checkpoint::~Checkpoint()
+{
+	Close();
+}
+
+/// Opens the temporary file of the snapshot for writing and writes the header.
+int Checkpoint::Create(const std::string &path)
+{
+	Close();
+	_path		= path;
+	_tempPath	= path + ".tmp";
+	_failed		= false;
+
+	_file = fopen(_tempPath.c_str(), "wb");
+	if (_file == 0) {
+		Error::_errMsg = "The file '" + _tempPath + "' could not be created!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	int v = version;
+	WriteArray(Tag, sizeof(Tag));
+	Write(v);
+
+	return 0;
+}
+
+/// Flushes the temporary file to the disk and replaces the previous snapshot with it.
+int Checkpoint::Commit()
+{
+	bool written = !_failed && _file != 0 && fflush(_file) == 0;
+#ifdef WIN32
+	written = written && _commit(_fileno(_file)) == 0;
+#else
+	written = written && fsync(fileno(_file)) == 0;
+#endif
+	if (_file != 0 && fclose(_file) != 0) {
+		written = false;
+	}
+	_file = 0;
+	if (!written) {
+		remove(_tempPath.c_str());
+		Error::_errMsg = "The file '" + _tempPath + "' could not be written!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	// The rename is atomic, a reader finds either the previous or the new snapshot
+#ifdef WIN32
+	bool renamed = MoveFileExA(_tempPath.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool renamed = rename(_tempPath.c_str(), _path.c_str()) == 0;
+#endif
+	if (!renamed) {
+		Error::_errMsg = "The file '" + _tempPath + "' could not be renamed to '" + _path + "'!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	return 0;
+}
+
+/// Opens the snapshot for reading and checks its header.
+int Checkpoint::Open(const std::string &path)
+{
+	Close();
+	_path	= path;
+	_failed	= false;
+
+	_file = fopen(path.c_str(), "rb");
+	if (_file == 0) {
+		Error::_errMsg = "The checkpoint '" + path + "' could not be opened!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	char tag[sizeof(Tag)];
+	int	 v = 0;
+	ReadArray(tag, sizeof(tag));
+	Read(v);
+	if (_failed || memcmp(tag, Tag, sizeof(Tag)) != 0) {
+		Close();
+		Error::_errMsg = "The file '" + path + "' is not a checkpoint!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	if (v != version) {
+		Close();
+		std::ostringstream msg;
+		msg << "The checkpoint '" << path << "' has version " << v << ", only version " << version << " can be read!";
+		Error::_errMsg = msg.str();
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	return 0;
+}
+
+void Checkpoint::Close()
+{
+	if (_file != 0) {
+		fclose(_file);
+		_file = 0;
+	}
+}
+
+void Checkpoint::Write(const std::string &s)
+{
+	int n = (int)s.size();
+	Write(n);
+	WriteArray(s.c_str(), n);
+}
+
+void Checkpoint::Read(std::string &s)
+{
+	int n = 0;
+	Read(n);
+	if (n < 0) {
+		_failed = true;
+	}
+	if (_failed) {
+		s.clear();
+		return;
+	}
+	std::vector<char> buffer(n + 1, '\0');
+	ReadArray(&buffer[0], n);
+	s = &buffer[0];
+}
+
+void Checkpoint::WriteBytes(const void *p, size_t n)
+{
+	if (_file == 0 || (n > 0 && fwrite(p, 1, n, _file) != n)) {
+		_failed = true;
+	}
+}
+
+void Checkpoint::ReadBytes(void *p, size_t n)
+{
+	if (_file == 0 || (n > 0 && fread(p, 1, n, _file) != n)) {
+		_failed = true;
+		memset(p, 0, n);
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * A binary snapshot of the state of a simulation from which an interrupted run is continued. The file
+ * starts with a tag and the version of the format, the values follow in the order they were written, in
+ * the byte order of the machine. The snapshot is written into a temporary file which replaces the previous
+ * snapshot only after it was completely written and flushed to the disk, therefore an interruption during
+ * the write leaves the previous snapshot intact.
+ * The failures of the individual reads and writes are collected, the caller checks Failed() at the end.
+ */
+class Checkpoint
+{
+public:
+	Checkpoint();
+	~Checkpoint();
+
+	int		Create(const std::string &path);
+	int		Commit();
+	int		Open(const std::string &path);
+	void	Close();
+
+	template<class T> void	Write(const T &value)					{ WriteBytes(&value, sizeof(T)); }
+	template<class T> void	WriteArray(const T *a, int n)			{ WriteBytes(a, n*sizeof(T)); }
+	template<class T> void	WriteVector(const std::vector<T> &v)
+	{
+		int n = (int)v.size();
+		Write(n);
+		if (n > 0) {
+			WriteArray(&v[0], n);
+		}
+	}
+	void	Write(const std::string &s);
+
+	template<class T> void	Read(T &value)							{ ReadBytes(&value, sizeof(T)); }
+	template<class T> void	ReadArray(T *a, int n)					{ ReadBytes(a, n*sizeof(T)); }
+	template<class T> void	ReadVector(std::vector<T> &v)
+	{
+		int n = 0;
+		Read(n);
+		if (n < 0) {
+			_failed = true;
+		}
+		if (!_failed && n > 0) {
+			v.resize(n);
+			ReadArray(&v[0], n);
+		}
+	}
+	void	Read(std::string &s);
+
+	// True if a read or a write failed since the file was opened
+	bool	Failed() const		{ return _failed; }
+
+	// The version of the format, it must be increased whenever the content of the snapshot changes
+	static const int version = 1;
+
+private:
+	void	WriteBytes(const void *p, size_t n);
+	void	ReadBytes(void *p, size_t n);
+
+	FILE		*_file;
+	std::string	_path;
+	std::string	_tempPath;
+	bool		_failed;
+};
+
+#endif
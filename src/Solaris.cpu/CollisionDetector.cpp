@@ -0,0 +1,117 @@
+#include <cmath>
+
+#include "CollisionDetector.h"
+#include "SolarisMacro.h"
+
+CollisionDetector::CollisionDetector()
+{
+	_nBucket  = 0;
+	_cellSize = 0.0;
+}
+
+/**
+ * Collects into pairs every pair (i, j) of the bodies for which factor*(radius_i + radius_j) > r_ij.
+ * The bodies [0, first), i.e. the central body, are large compared to the others, they are compared
+ * with every body directly, the bodies [first, n) are binned into the grid.
+ * y is the interleaved (x, y, z, vx, vy, vz) array.
+ */
+int CollisionDetector::FindOverlaps(int first, int n, const double *y, const double *radius, double factor, std::vector<CollisionPair> &pairs)
+{
+	pairs.clear();
+
+	for (int i = 0; i < first; i++) {
+		for (int j = i + 1; j < n; j++) {
+			double r = sqrt(SQR(y[6*j + 0] - y[6*i + 0]) + SQR(y[6*j + 1] - y[6*i + 1]) + SQR(y[6*j + 2] - y[6*i + 2]));
+			if (factor*(radius[i] + radius[j]) > r) {
+				CollisionPair p = { i, j, r };
+				pairs.push_back(p);
+			}
+		}
+	}
+
+	// Only the bodies with non-zero radius are binned, the rest can touch only them
+	double maxRadius = 0.0;
+	int nBinned = 0;
+	for (int i = first; i < n; i++) {
+		if (radius[i] > 0.0) {
+			nBinned++;
+			if (radius[i] > maxRadius) {
+				maxRadius = radius[i];
+			}
+		}
+	}
+	if (nBinned == 0 || factor <= 0.0) {
+		return 0;
+	}
+	_cellSize = 2.0*factor*maxRadius;
+	for (_nBucket = 1; _nBucket < 2*nBinned; _nBucket *= 2)
+		;
+
+	// Counting sort of the binned bodies by bucket
+	_cellStart.assign(_nBucket + 1, 0);
+	_cellBody.resize(nBinned);
+	_bucket.resize(n);
+	for (int i = first; i < n; i++) {
+		if (radius[i] > 0.0) {
+			_bucket[i] = Hash((long long)floor(y[6*i + 0]/_cellSize), (long long)floor(y[6*i + 1]/_cellSize), (long long)floor(y[6*i + 2]/_cellSize));
+			_cellStart[_bucket[i] + 1]++;
+		}
+	}
+	for (int b = 0; b < _nBucket; b++) {
+		_cellStart[b + 1] += _cellStart[b];
+	}
+	_next.assign(_cellStart.begin(), _cellStart.end() - 1);
+	for (int i = first; i < n; i++) {
+		if (radius[i] > 0.0) {
+			_cellBody[_next[_bucket[i]]++] = i;
+		}
+	}
+
+	for (int i = first; i < n; i++) {
+		long long ix = (long long)floor(y[6*i + 0]/_cellSize);
+		long long iy = (long long)floor(y[6*i + 1]/_cellSize);
+		long long iz = (long long)floor(y[6*i + 2]/_cellSize);
+		// Different cells may share a bucket, every bucket is visited only once
+		int visited[27];
+		int nVisited = 0;
+		for (int dx = -1; dx <= 1; dx++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dz = -1; dz <= 1; dz++) {
+					int b = Hash(ix + dx, iy + dy, iz + dz);
+					bool seen = false;
+					for (int k = 0; k < nVisited; k++) {
+						if (visited[k] == b) {
+							seen = true;
+							break;
+						}
+					}
+					if (seen) {
+						continue;
+					}
+					visited[nVisited++] = b;
+
+					for (int k = _cellStart[b]; k < _cellStart[b + 1]; k++) {
+						int j = _cellBody[k];
+						// A pair of binned bodies is found from both sides, it is kept only once
+						if (j == i || (j < i && radius[i] > 0.0)) {
+							continue;
+						}
+						double r = sqrt(SQR(y[6*j + 0] - y[6*i + 0]) + SQR(y[6*j + 1] - y[6*i + 1]) + SQR(y[6*j + 2] - y[6*i + 2]));
+						if (factor*(radius[i] + radius[j]) > r) {
+							CollisionPair p = { i < j ? i : j, i < j ? j : i, r };
+							pairs.push_back(p);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+int CollisionDetector::Hash(long long ix, long long iy, long long iz) const
+{
+	unsigned long long h = (unsigned long long)ix*73856093ULL ^ (unsigned long long)iy*19349663ULL ^ (unsigned long long)iz*83492791ULL;
+	return (int)(h & (unsigned long long)(_nBucket - 1));
+}
@@ -0,0 +1,40 @@
+#ifndef COLLISIONDETECTOR_H_
+#define COLLISIONDETECTOR_H_
+
+#include <vector>
+
+/**
+ * A pair of bodies closer to each other than factor*(radius_i + radius_j), i < j.
+ */
+struct CollisionPair
+{
+	int		i;
+	int		j;
+	double	distance;
+};
+
+/**
+ * Finds the overlapping pairs of bodies with a spatial hash: the bodies are binned into a uniform
+ * grid, whose cell is as large as the largest possible contact distance, and only the bodies of
+ * the 27 neighbouring cells are compared. The cost is O(N) for any reasonable distribution.
+ */
+class CollisionDetector
+{
+public:
+	CollisionDetector();
+
+	int		FindOverlaps(int first, int n, const double *y, const double *radius, double factor, std::vector<CollisionPair> &pairs);
+
+private:
+	int		Hash(long long ix, long long iy, long long iz) const;
+
+	int					_nBucket;
+	double				_cellSize;
+	// The bodies of bucket b are _cellBody[_cellStart[b]], ..., _cellBody[_cellStart[b + 1] - 1]
+	std::vector<int>	_cellStart;
+	std::vector<int>	_cellBody;
+	std::vector<int>	_bucket;
+	std::vector<int>	_next;
+};
+
+#endif
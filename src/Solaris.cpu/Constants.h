@@ -12,6 +12,24 @@ namespace Constants
 	const std::string Usage				  = "Usage is -id <directory> -is <settings file> -ib <bodygrouplist file> -in <nebula file> | -c <directory> <settings file> <bodygrouplist file> <nebula file>\n";
 
 	const int	 CheckForSM			      = 100;
+	// Below this number of bodies the force loops are not distributed among threads
+	const int	 ParallelThreshold	      = 64;
+	// Below this number of variables the stage loops of the integrators are not distributed among threads
+	const int	 ParallelVarThreshold     = 16384;
+	// Tile sizes of the test particle kernel: a block of particles is processed against
+	// a tile of perturbers (4 doubles each, 8 kB) which fits into the L1 cache
+	const int	 ParticleBlockSize	      = 64;
+	const int	 PerturberTileSize	      = 256;
+	// The number of test particles integrated together with their own step size in the restricted problem mode
+	const int	 RestrictedChunkSize      = 256;
+	// Every MixedPrecisionCheck-th single precision evaluation is compared with the double one
+	const int	 MixedPrecisionCheck      = 1000;
+	// The default step size of the Wisdom-Holman integrator is the shortest period divided by this number
+	const int	 WisdomHolmanStepsPerOrbit= 20;
+	// The maximum number of iterations of the universal variable Kepler solver
+	const int	 KeplerMaxIteration	      = 50;
+	// The accuracy parameter of the time-step criterion of the block time-step Hermite integrator
+	const double BlockHermiteEta		  = 0.01;
 	const double SmallestNumber		      = 1.0e-50;
 
 	const double Pi					      = 3.14159265358979323846;
@@ -7,15 +7,20 @@ Counter::Counter()
 	ejection		= 0ull;
 	hitCentrum		= 0ull;
 	collision		= 0ull;
+	locatedEvent	= 0ull;
 }
 
 std::ostream& operator<<(std::ostream& output, Counter counter)
 {
 	output << "succeded steps: " << counter.succededStep << std::endl;
 	output << "  failed steps: " << counter.failedStep << std::endl;
+	// The fraction of the trial steps rejected by the step size control
+	unsigned long long int trial = counter.succededStep + counter.failedStep;
+	output << "  reject ratio: " << (trial > 0 ? (double)counter.failedStep/trial : 0.0) << std::endl;
 	output << "      ejection: " << counter.ejection << std::endl;
 	output << "   hit centrum: " << counter.hitCentrum << std::endl;
 	output << "     collision: " << counter.collision << std::endl;
+	output << "located events: " << counter.locatedEvent << std::endl;
 
 	return output;
 }
@@ -14,6 +14,8 @@ public:
 	unsigned long long int ejection;
 	unsigned long long int hitCentrum;
 	unsigned long long int collision;
+	// The steps shortened to the time of an event located within them
+	unsigned long long int locatedEvent;
 
 	// Output streams
 	friend std::ostream& operator<<( std::ostream& output, Counter counter);
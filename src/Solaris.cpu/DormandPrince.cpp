@@ -5,137 +5,159 @@
 #include "DormandPrince.h"
 #include "Acceleration.h"
 #include "BodyData.h"
+#include "Checkpoint.h"
 #include "Error.h"
+#include "RungeKuttaEngine.h"
 #include "TimeLine.h"
 #include "SolarisMacro.h"
 
+#define SQRT21	4.5825756949558400065880471937280
+
+// The Butcher tableau of the Runge-Kutta-Nystrom 7(6) pair, the step advances the 7th order positions
+struct DormandPrince76 { enum { nStage = 9 }; };
+
+BUTCHER_NODE(DormandPrince76, 1, 1.0/10.0)
+BUTCHER_NODE(DormandPrince76, 2, 1.0/5.0)
+BUTCHER_NODE(DormandPrince76, 3, 3.0/8.0)
+BUTCHER_NODE(DormandPrince76, 4, 1.0/2.0)
+BUTCHER_NODE(DormandPrince76, 5, (7.0 - SQRT21)/14.0)
+BUTCHER_NODE(DormandPrince76, 6, (7.0 + SQRT21)/14.0)
+BUTCHER_NODE(DormandPrince76, 7, 1.0)
+BUTCHER_NODE(DormandPrince76, 8, 1.0)
+
+BUTCHER(DormandPrince76, 1, 0, 1.0/200.0)
+BUTCHER(DormandPrince76, 2, 0, 1.0/150.0)
+BUTCHER(DormandPrince76, 2, 1, 1.0/75.0)
+BUTCHER(DormandPrince76, 3, 0, 171.0/8192.0)
+BUTCHER(DormandPrince76, 3, 1, 45.0/4096.0)
+BUTCHER(DormandPrince76, 3, 2, 315.0/8192.0)
+BUTCHER(DormandPrince76, 4, 0, 5.0/288.0)
+BUTCHER(DormandPrince76, 4, 1, 25.0/528.0)
+BUTCHER(DormandPrince76, 4, 2, 25.0/672.0)
+BUTCHER(DormandPrince76, 4, 3, 16.0/693.0)
+BUTCHER(DormandPrince76, 5, 0, (1003.0 - 205.0*SQRT21)/12348.0)
+BUTCHER(DormandPrince76, 5, 1,-25.0*(751.0 - 173.0*SQRT21)/90552.0)
+BUTCHER(DormandPrince76, 5, 2, 25.0*(624.0 - 137.0*SQRT21)/43218.0)
+BUTCHER(DormandPrince76, 5, 3,-128.0*(361.0 - 79.0*SQRT21)/237699.0)
+BUTCHER(DormandPrince76, 5, 4, (3411.0 - 745.0*SQRT21)/24696.0)
+BUTCHER(DormandPrince76, 6, 0, (793.0 + 187.0*SQRT21)/12348.0)
+BUTCHER(DormandPrince76, 6, 1,-25.0*(331.0 + 113.0*SQRT21)/90552.0)
+BUTCHER(DormandPrince76, 6, 2, 25.0*(1044.0 + 247.0*SQRT21)/43218.0)
+BUTCHER(DormandPrince76, 6, 3,-128.0*(14885.0 + 3779.0*SQRT21)/9745659.0)
+BUTCHER(DormandPrince76, 6, 4, (3327.0 + 797.0*SQRT21)/24696.0)
+BUTCHER(DormandPrince76, 6, 5,-(581.0 + 127.0*SQRT21)/1722.0)
+BUTCHER(DormandPrince76, 7, 0,-(157.0 - 3.0*SQRT21)/378.0)
+BUTCHER(DormandPrince76, 7, 1, 25.0*(143.0 - 10.0*SQRT21)/2772.0)
+BUTCHER(DormandPrince76, 7, 2,-25.0*(876.0 + 55.0*SQRT21)/3969.0)
+BUTCHER(DormandPrince76, 7, 3, 1280.0*(913.0 + 18.0*SQRT21)/596673.0)
+BUTCHER(DormandPrince76, 7, 4,-(1353.0 + 26.0*SQRT21)/2268.0)
+BUTCHER(DormandPrince76, 7, 5, 7.0*(1777.0 + 377.0*SQRT21)/4428.0)
+BUTCHER(DormandPrince76, 7, 6, 7.0*(5.0 - SQRT21)/36.0)
+// The last stage is computed at the positions the step ends with
+BUTCHER(DormandPrince76, 8, 0, 1.0/20.0)
+BUTCHER(DormandPrince76, 8, 4, 8.0/45.0)
+BUTCHER(DormandPrince76, 8, 5, 7.0*(7.0 + SQRT21)/360.0)
+BUTCHER(DormandPrince76, 8, 6, 7.0*(7.0 - SQRT21)/360.0)
+
+BUTCHER(DormandPrince76, BUTCHER_B, 0, 1.0/20.0)
+BUTCHER(DormandPrince76, BUTCHER_B, 4, 8.0/45.0)
+BUTCHER(DormandPrince76, BUTCHER_B, 5, 7.0*(7.0 + SQRT21)/360.0)
+BUTCHER(DormandPrince76, BUTCHER_B, 6, 7.0*(7.0 - SQRT21)/360.0)
+
+BUTCHER(DormandPrince76, BUTCHER_BDOT, 0, 1.0/20.0)
+BUTCHER(DormandPrince76, BUTCHER_BDOT, 4, 16.0/45.0)
+BUTCHER(DormandPrince76, BUTCHER_BDOT, 5, 49.0/180.0)
+BUTCHER(DormandPrince76, BUTCHER_BDOT, 6, 49.0/180.0)
+BUTCHER(DormandPrince76, BUTCHER_BDOT, 7, 1.0/20.0)
+
+// The difference of the 7th and 6th order positions
+BUTCHER(DormandPrince76, BUTCHER_E, 7, 1.0/20.0)
+BUTCHER(DormandPrince76, BUTCHER_E, 8,-1.0/20.0)
+
+#undef SQRT21
+
 DormandPrince::DormandPrince()
 {
 	reference	= "New Runge-Kutta Algorithms for Numerical Simulation in Dynamical Astronomy, Celestial Mechanics, Vol. 18(1978), 223-232.";
 
 	maxIter			= 10;
-	sizeHeightRKD	= 9;
-
-	double sQ = sqrt(21.0); 
-
-	b[0] = 1.0/20.0; 
-	b[1] = 0.0; 
-	b[2] = 0.0; 
-	b[3] = 0.0; 
-	b[4] = 8.0/45.0; 
-	b[5] = 7.0*(7.0 + sQ)/360.0; 
-	b[6] = 7.0*(7.0 - sQ)/360.0; 
-	b[7] =-1.0/20.0; 
-	b[8] = 1.0/20.0; 
-
-	bh[0] = 1.0/20.0; 
-	bh[1] = 0.0; 
-	bh[2] = 0.0; 
-	bh[3] = 0.0; 
-	bh[4] = 8.0/45.0; 
-	bh[5] = 7.0*(7.0 + sQ)/360.0; 
-	bh[6] = 7.0*(7.0 - sQ)/360.0; 
-	bh[7] = 0.0, 
-	bh[8] = 0.0;        
-
-	bdh[0] = 1.0/20.0; 
-	bdh[1] = 0.0; 
-	bdh[2] = 0.0; 
-	bdh[3] = 0.0; 
-	bdh[4] = 16.0/45.0; 
-	bdh[5] = 49.0/180.0; 
-	bdh[6] = 49.0/180.0; 
-	bdh[7] = 1.0/20.0; 
-	bdh[8] = 0.0; 
-
-	c[0] = 0.0; 
-	c[1] = 1.0/10.0; 
-	c[2] = 1.0/5.0; 
-	c[3] = 3.0/8.0; 
-	c[4] = 1.0/2.0; 
-	c[5] = (7.0 - sQ)/14.0; 
-	c[6] = (7.0 + sQ)/14.0; 
-	c[7] = 1.0; 
-	c[8] = 1.0; 
-
-	for (int i = 0; i < 9; i++) {
-		for (int j = 0; j < 8; j++) {
-			a[i][j] = 0.0;
-		}
-	}
+	nEvaluation		= 0;
+	nReusedEvaluation = 0;
+	_fsalTime		= 0.0;
+	_fsalY			= 0;
+	_fsalN			= 0;
+	_fsalAllocation = 0;
+	// f[1], ..., f[8] and yTemp
+	nWorkspaceArray	= 9;
+	// The step leaves the phases and the derivatives at its start in bodyData->y and bodyData->accel
+	denseOutput		= true;
+	_errorMax		= 0.0;
 
-	a[1][0] = 1.0/200.0; 
-       
-	a[2][0] = 1.0/150.0; 
-	a[2][1] = 1.0/75.0; 
-       
-	a[3][0] = 171.0/8192.0; 
-	a[3][1] = 45.0/4096.0; 
-	a[3][2] = 315.0/8192.0; 
-     
-	a[4][0] = 5.0/288.0; 
-	a[4][1] = 25.0/528.0; 
-	a[4][2] = 25.0/672.0; 
-	a[4][3] = 16.0/693.0; 
-       
-	a[5][0] = (1003.0 - 205.0*sQ)/12348.0; 
-	a[5][1] =-25.0*(751.0 - 173.0*sQ)/90552.0; 
-	a[5][2] = 25.0*(624.0 - 137.0*sQ)/43218.0; 
-	a[5][3] =-128.0*(361.0 - 79.0*sQ)/237699.0; 
-	a[5][4] = (3411.0 - 745.0*sQ)/24696.0; 
-       
-	a[6][0] = (793.0 + 187.0*sQ)/12348.0; 
-	a[6][1] =-25.0*(331.0 + 113.0*sQ)/90552.0; 
-	a[6][2] = 25.0*(1044.0 + 247.0*sQ)/43218.0; 
-	a[6][3] =-128.0*(14885.0 + 3779.0*sQ)/9745659.0; 
-	a[6][4] = (3327.0 + 797.0*sQ)/24696.0; 
-	a[6][5] =-(581.0 + 127.0*sQ)/1722.0; 
-     
-	a[7][0] =-(157.0 - 3.0*sQ)/378.0; 
-	a[7][1] = 25.0*(143.0 - 10.0*sQ)/2772.0; 
-	a[7][2] =-25.0*(876.0 + 55.0*sQ)/3969.0; 
-	a[7][3] = 1280.0*(913.0 + 18.0*sQ)/596673.0; 
-	a[7][4] =-(1353.0 + 26.0*sQ)/2268.0; 
-	a[7][5] = 7.0*(1777.0 + 377.0*sQ)/4428.0; 
-	a[7][6] = 7.0*(5.0 - sQ)/36.0; 
-       
-	a[8][0] = 1.0/20.0; 
-	a[8][4] = 8.0/45.0; 
-	a[8][5] = 7.0*(7.0 + sQ)/360.0; 
-	a[8][6] = 7.0*(7.0 - sQ)/360.0; 
 }
 
 int DormandPrince::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
 {
 	bodyData->time	= timeLine->time;
 
-	acceleration->evaluateGasDrag			= true;
-	acceleration->evaluateTypeIMigration	= true;
-	acceleration->evaluateTypeIIMigration	= true;
-
-	// Calculate the acceleration in the initial point
-	acceleration->Compute(timeLine->time, bodyData->y0, bodyData->accel);
-
-	// NOTE: Kikapcsolom a GasDrag erők kiszámítását, gyorsítva ezzel az integrálást.
-	// Készíteni összehasonlításokat, és értékelni az eredményeket, abbol a szempontbol, hogy így mennyire pontos az integralas.
-	acceleration->evaluateGasDrag			= false;
-	acceleration->evaluateTypeIMigration	= false;
-	acceleration->evaluateTypeIIMigration	= false;
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	int		result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+
+	// The last stage of the previous step was computed at the phases the step ended with. It is the first
+	// stage of this step unless the Simulator has changed the phases since, or the forces of the nebula are
+	// present, these are evaluated only at the initial point.
+	if (acceleration->nebula == 0 && _fsalTime == timeLine->time && _fsalY == bodyData->y0 && _fsalN == nTotal && _fsalAllocation == nAllocation) {
+		double *f8 = Workspace(7);
+		for (int i = 0; i < nTotal; i++) {
+			int i0 = 6*i;
+			for (int j = 0; j < 3; j++) {
+				bodyData->accel[i0 + j]		= bodyData->y0[i0 + j + 3];
+				bodyData->accel[i0 + j + 3] = f8[i0 + j + 3];
+			}
+		}
+		nReusedEvaluation++;
+	}
+	else {
+		acceleration->evaluateGasDrag			= true;
+		acceleration->evaluateTypeIMigration	= true;
+		acceleration->evaluateTypeIIMigration	= true;
+
+		// Calculate the acceleration in the initial point
+		result = acceleration->Compute(timeLine->time, bodyData->y0, bodyData->accel);
+		HANDLE_RESULT(result);
+		nEvaluation++;
+
+		// NOTE: Kikapcsolom a GasDrag erők kiszámítását, gyorsítva ezzel az integrálást.
+		// Készíteni összehasonlításokat, és értékelni az eredményeket, abbol a szempontbol, hogy így mennyire pontos az integralas.
+		acceleration->evaluateGasDrag			= false;
+		acceleration->evaluateTypeIMigration	= false;
+		acceleration->evaluateTypeIIMigration	= false;
+	}
 
+	// The rejected steps restart from the same initial point, f[0] is computed only once
 	int		iter = 0;
 	double	errorMax = 0.0;
 	do {
 		iter++;
 		bodyData->h		= timeLine->hNext;
-		//if (Step(bodyData, acceleration) == 1) {
 		if (Step2(bodyData, acceleration) == 1) {
 			Error::_errMsg = "An error occurred during Dormand-Prince step!";
 			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 			return 1;
 		}
-		errorMax = GetErrorMax(bodyData->nBodies.NOfVar(), bodyData->error);
+		// The error maximum was computed by the Step2() together with the solution
+		errorMax = _errorMax;
 		timeLine->hDid = bodyData->h;
-		timeLine->hNext = errorMax < 1.0e-20 ? 2.0*bodyData->h : 0.9*bodyData->h*pow(epsilon / errorMax, 1.0/7.0);
+		if (stepControl == STEP_CONTROL_PI) {
+			timeLine->hNext = PIStepFactor(errorMax / epsilon, 7) * bodyData->h;
+		}
+		else {
+			timeLine->hNext = errorMax < 1.0e-20 ? 2.0*bodyData->h : 0.9*bodyData->h*pow(epsilon / errorMax, 1.0/7.0);
+		}
+		if (errorMax > epsilon) {
+			nRejectedStep++;
+		}
 	} while (errorMax > epsilon && iter <= maxIter);
 	if (iter > maxIter) {
 		Error::_errMsg = "An error occurred during Dormand-Prince driver: iteration number exceeded maxIter!";
@@ -148,82 +170,19 @@ int DormandPrince::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLi
 	// Update the phases of the system
 	std::swap(bodyData->y0, bodyData->y);
 
+	_fsalTime	= timeLine->time;
+	_fsalY		= bodyData->y0;
+	_fsalN		= nTotal;
+	_fsalAllocation = nAllocation;
+
 	return 0;
 }
 
-int DormandPrince::Step(BodyData *bodyData, Acceleration *acceleration)
+// The error of the positions is not scaled
+struct DormandPrinceError
 {
-	// These arrays will contain the accelerations computed along the trajectory of the current step
-	double	*f[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
-	// Contains the approximation of the solution
-	double	*yTemp = 0;
-	int		nVar = bodyData->nBodies.NOfVar();
-
-	f[0] = bodyData->accel;
-	for (int i = 1; i < 9; i++) {
-		f[i] = new double[nVar];
-		HANDLE_NULL(f[i]);
-		memset(f[i], 0, nVar*sizeof(double));
-	}
-
-	yTemp = new double[nVar];
-	HANDLE_NULL(yTemp);
-	memset(yTemp, 0, nVar*sizeof(double));
-
-	double	h = bodyData->h;
-	double	h2 = h*h;
-
-	for (int k = 1; k < sizeHeightRKD; k++) {
-		double	ttemp = bodyData->time + c[k] * h;
-		for (int i = 0; i < bodyData->nBodies.total; i++) {
-			int i0 = 6*i;
-			for (int j = 0; j < 3; j++) {
-				int n = i0 + j;
-				// Compute the coordinates
-				yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3];
-				// Copy the velocities
-				yTemp[n+3]	= bodyData->y0[n+3];
-				double sum_a = 0.0;
-				for (int l = 0; l < k; l++) {
-					sum_a += a[k][l]*f[l][n+3];
-				}
-				// Compute the coordinates
-				yTemp[n]	+= h2*sum_a;
-				// Compute the velocities
-				yTemp[n+3]	+= h*sum_a;
-			}
-		}
-		acceleration->Compute(ttemp, yTemp, f[k]);
-	}
-
-	for (int i = 0; i < bodyData->nBodies.total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j<3; j++) {
-			int n = i0 + j;
-			// Compute the coordinates after the set
-			bodyData->y[n]			 = bodyData->y0[n] + h*bodyData->y0[n+3];
-			bodyData->yBetterEst[n]  = bodyData->y[n];
-			// Compute the velocities after the set
-			bodyData->y[n+3]		 = bodyData->y0[n+3];
-			for (int k = 0; k < sizeHeightRKD; k++)
-			{
-				double	a = f[k][n+3];
-				bodyData->y[n]			+= h2*b[k]*a;
-				bodyData->yBetterEst[n]	+= h2*bh[k]*a;
-				bodyData->y[n+3]		+=  h*bdh[k]*a;
-			}
-			bodyData->error[n] = h2 * fabs(f[7][n+3] - f[8][n+3]) / 20.0;
-			bodyData->error[n+3] = 0.0;
-		}
-	}
-
-	// i=0 changed to i=1
-	for (int i = 1; i < 9; i++)
-		delete[] f[i];
-	delete[] yTemp;
-
-	return 0;
-}
+	double operator()(int, double error) const	{ return error; }
+};
 
 int DormandPrince::Step2(BodyData *bodyData, Acceleration *acceleration)
 {
@@ -233,182 +192,25 @@ int DormandPrince::Step2(BodyData *bodyData, Acceleration *acceleration)
 	double	*yTemp = 0;
 	int		nVar = bodyData->nBodies.NOfVar();
 
+	// The workspace is sized by Simulator::BodyListToBodyData(), this call does not allocate
+	int result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	// f1 = f[0] is computed by the Driver() at the initial point
+	f[0] = bodyData->accel;
 	for (int i = 1; i < 9; i++) {
-		f[i] = new double[nVar];
-		HANDLE_NULL(f[i]);
-		memset(f[i], 0, nVar*sizeof(double));
+		f[i] = Workspace(i - 1);
 	}
-
-	yTemp = new double[nVar];
-	HANDLE_NULL(yTemp);
-	memset(yTemp, 0, nVar*sizeof(double));
+	yTemp = Workspace(8);
 
 	int		n_total = bodyData->nBodies.total;
 	double	h = bodyData->h;
-	double	h2 = h*h;
-
-	int k = 0;
-	// f1 = f[0]
-	double	ttemp = bodyData->time + c[k] * h;
-	f[k] = bodyData->accel;
-
-	// compute yTemp in order to compute f2
-	k = 1;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f2 = f[1]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f3
-	k = 2;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][1]*f[1][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f3 = f[2]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f4
-	k = 3;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][1]*f[1][n+3] + a[k][2]*f[2][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f4 = f[3]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f5
-	k = 4;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][1]*f[1][n+3] + a[k][2]*f[2][n+3] + a[k][3]*f[3][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f5 = f[4]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f6
-	k = 5;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][1]*f[1][n+3] + a[k][2]*f[2][n+3] + a[k][3]*f[3][n+3] + a[k][4]*f[4][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f6 = f[5]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f7
-	k = 6;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][1]*f[1][n+3] + a[k][2]*f[2][n+3] + a[k][3]*f[3][n+3] + a[k][4]*f[4][n+3] +
-						  a[k][5]*f[5][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f7 = f[6]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f8
-	k = 7;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][1]*f[1][n+3] + a[k][2]*f[2][n+3] + a[k][3]*f[3][n+3] + a[k][4]*f[4][n+3] +
-						  a[k][5]*f[5][n+3] + a[k][6]*f[6][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f8 = f[7]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	// compute yTemp in order to compute f9
-	k = 8;
-	ttemp = bodyData->time + c[k] * h;
-	for (int i = 0; i < n_total; i++) {
-		int i0 = 6*i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			double var	= a[k][0]*f[0][n+3] + a[k][4]*f[4][n+3] + a[k][5]*f[5][n+3] + a[k][6]*f[6][n+3];
-			// Compute the new position
-			yTemp[n]	= bodyData->y0[n] + c[k]*h*bodyData->y0[n+3] + h2*(var);
-			// Compute the new velocity
-			yTemp[n+3]	= bodyData->y0[n+3] + h*(var);
-		}
-	} // yTemp is computed
-	// f9 = f[8]
-	acceleration->Compute(ttemp, yTemp, f[k]);
-
-	for (int i = 0; i < bodyData->nBodies.total; i++) {
-		int i0 = 6 * i;
-		for (int j = 0; j < 3; j++) {
-			int n = i0 + j;
-			bodyData->y[n] = bodyData->y0[n] + h*bodyData->y0[n+3] + h2*(b[0]*f[0][n+3] + b[4]*f[4][n+3] + b[5]*f[5][n+3] + 
-																	     b[6]*f[6][n+3] + b[7]*f[7][n+3] + b[8]*f[8][n+3]);
-			bodyData->error[n] = h2 * fabs(f[7][n+3] - f[8][n+3]) / 20.0;
-
-			bodyData->y[n+3] = bodyData->y0[n+3] + h*(bdh[0]*f[0][n+3] + bdh[4]*f[4][n+3] + bdh[5]*f[5][n+3] + 
-													  bdh[6]*f[6][n+3] + bdh[7]*f[7][n+3]);
-			bodyData->error[n+3] = 0.0;
-		}
-	}
 
-	// i=0 changed to i=1
-	for (int i = 1; i < 9; i++) {
-		delete[] f[i];
-	}
-	delete[] yTemp;
+	// f2, ..., f9 = f[1], ..., f[8]
+	result = RungeKuttaEngine<DormandPrince76>::StagesNystrom(acceleration, bodyData->time, h, n_total, bodyData->y0, f, yTemp);
+	HANDLE_RESULT(result);
+	nEvaluation += DormandPrince76::nStage - 1;
+
+	_errorMax = RungeKuttaEngine<DormandPrince76>::SolutionNystrom(h, n_total, bodyData->y0, f, bodyData->y, bodyData->error, DormandPrinceError());
 
 	return 0;
 }
@@ -424,3 +226,21 @@ double DormandPrince::GetErrorMax(int n, const double *yerr)
 	}
 	return errorMax;
 }
+
+void DormandPrince::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	Integrator::SaveState(checkpoint, bodyData);
+	checkpoint.Write(nEvaluation);
+	checkpoint.Write(nReusedEvaluation);
+}
+
+/// The derivatives at the end of the last step are not saved, the first step after the restart computes them again.
+int DormandPrince::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	int result = Integrator::LoadState(checkpoint, bodyData);
+	HANDLE_RESULT(result);
+	checkpoint.Read(nEvaluation);
+	checkpoint.Read(nReusedEvaluation);
+
+	return 0;
+}
@@ -6,6 +6,7 @@
 
 class Acceleration;
 class BodyData;
+class Checkpoint;
 class TimeLine;
 
 class DormandPrince : public Integrator
@@ -14,18 +15,27 @@ public:
 	DormandPrince();
 
 	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
-	int 		Step(  BodyData *bodyData, Acceleration *acceleration);
 	int 		Step2( BodyData *bodyData, Acceleration *acceleration);
 	double		GetErrorMax(int n, const double *yerr);
+	void		SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	int			LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+	// The number of the evaluations of the accelerations, and the number of evaluations saved by
+	// starting a step with the last stage of the previous one
+	int			nEvaluation;
+	int			nReusedEvaluation;
 
 private:
 	int		maxIter;
-	int		sizeHeightRKD;
-	double	b[9];
-	double	bh[9];
-	double	bdh[9];
-	double	c[9];
-	double	a[9][8];
+	// The error maximum of the last Step2()
+	double	_errorMax;
+
+	// The time, the phases, the number of bodies and of the workspace allocations at the end of the
+	// last step, f[8] in the workspace holds the accelerations computed there
+	double		_fsalTime;
+	const double *_fsalY;
+	int			_fsalN;
+	int			_fsalAllocation;
 };
 
 #endif
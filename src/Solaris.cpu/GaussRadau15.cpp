@@ -0,0 +1,443 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "GaussRadau15.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Checkpoint.h"
+#include "Error.h"
+#include "TimeLine.h"
+#include "SolarisMacro.h"
+
+GaussRadau15::GaussRadau15()
+{
+	name		= "Gauss-Radau 15 (IAS15)";
+	reference	= "Everhart, E., 1985, ASSL 115, 185; Rein, H. & Spiegel, D. S., 2015, MNRAS 446, 1424";
+	// 39 arrays of 3*nBodies.total elements in pairs, the derivatives and the last phases
+	nWorkspaceArray	= 22;
+
+	nEvaluation		= 0;
+	nNotConverged	= 0;
+	denseOutput		= true;
+
+	_errorMax		= 0.0;
+	_hLastDone		= 0.0;
+	_nLast			= 0;
+
+	hs[0] = 0.0;
+	hs[1] = 0.0562625605369221464656521910318;
+	hs[2] = 0.180240691736892364987579942780;
+	hs[3] = 0.352624717113169637373907769648;
+	hs[4] = 0.547153626330555383001448554766;
+	hs[5] = 0.734210177215410531523210605558;
+	hs[6] = 0.885320946839095768090359771030;
+	hs[7] = 0.977520613561287501891174488626;
+
+	// The jth basis polynomial of the g representation is s*(s - hs[1])*...*(s - hs[j]), the
+	// coefficient of its s^(k+1) term is U[k][j]
+	memset(U, 0, sizeof(U));
+	U[0][0] = 1.0;
+	for (int j = 1; j < 7; j++) {
+		for (int k = 0; k <= j; k++) {
+			U[k][j] = (k > 0 ? U[k-1][j-1] : 0.0) - hs[j]*U[k][j-1];
+		}
+	}
+	// U is unit upper triangular, its inverse is computed by back substitution
+	memset(UInv, 0, sizeof(UInv));
+	for (int j = 0; j < 7; j++) {
+		UInv[j][j] = 1.0;
+		for (int k = j - 1; k >= 0; k--) {
+			double sum = 0.0;
+			for (int m = k + 1; m <= j; m++) {
+				sum += U[k][m]*UInv[m][j];
+			}
+			UInv[k][j] = -sum;
+		}
+	}
+
+	for (int k = 0; k < 7; k++) {
+		_b[k] = _g[k] = _e[k] = _br[k] = _er[k] = 0;
+	}
+	_a0 = _at = _csx = _csv = _f = _yLast = 0;
+}
+
+/**
+ * The phases at time t within the last step from the polynomial of the acceleration found by the step,
+ * which is of the same order as the step itself. The polynomial is defined on the whole step, even if
+ * the Simulator shortened it afterwards to the time of an event.
+ */
+int GaussRadau15::DenseOutput(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine, double t, double *y)
+{
+	int		n3 = 3*bodyData->nBodies.total;
+	double	h = _hLastDone;
+	double	s = h != 0.0 ? (t - (timeLine->time - timeLine->hDid))/h : 1.0;
+	double	hs = h*s;
+
+	const double *yStart = bodyData->y;
+	for (int k = 0; k < n3; k++) {
+		int p = 6*(k/3) + k%3;
+		double dx = hs*yStart[p + 3] + hs*hs*(_a0[k]/2.0 + s*(_br[0][k]/6.0 + s*(_br[1][k]/12.0 + s*(_br[2][k]/20.0 + s*(_br[3][k]/30.0 +
+											  s*(_br[4][k]/42.0 + s*(_br[5][k]/56.0 + s*_br[6][k]/72.0)))))));
+		double dv = hs*(_a0[k] + s*(_br[0][k]/2.0 + s*(_br[1][k]/3.0 + s*(_br[2][k]/4.0 + s*(_br[3][k]/5.0 + s*(_br[4][k]/6.0 +
+											  s*(_br[5][k]/7.0 + s*_br[6][k]/8.0)))))));
+		y[p]	 = yStart[p] + dx;
+		y[p + 3] = yStart[p + 3] + dv;
+	}
+
+	return 0;
+}
+
+// constants for the Gauss-Radau integrator
+// The step is rejected if the new step would be smaller than SAFETY times the last one, and
+// the step can grow by at most 1/SAFETY
+#define SAFETY	 0.25
+// The coefficients are not extrapolated if the step grows by more than this factor
+#define MAXRATIO 20.0
+int GaussRadau15::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
+{
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	int		n3 = 3*nTotal;
+
+	int nAllocation = this->nAllocation;
+	int result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	SetArrays(n3);
+	// The coefficients of the last step are only valid if the phases were not changed since then
+	// (e.g. by a collision or by the removal of a body)
+	if (nTotal != _nLast || nAllocation != this->nAllocation || memcmp(bodyData->y0, _yLast, nVar*sizeof(double)) != 0) {
+		Reset(n3);
+	}
+
+	bodyData->time	= timeLine->time;
+	bodyData->h		= timeLine->hNext;
+
+	// The forces of the nebula are evaluated at every substep, since the polynomial must
+	// approximate the same acceleration in every point of the step
+	acceleration->evaluateGasDrag			= true;
+	acceleration->evaluateTypeIMigration	= true;
+	acceleration->evaluateTypeIIMigration	= true;
+
+	// Calculate the acceleration in the initial point
+	result = acceleration->Compute(timeLine->time, bodyData->y0, _f);
+	HANDLE_RESULT(result);
+	nEvaluation++;
+	for (int k = 0; k < n3; k++) {
+		_a0[k] = _f[6*(k/3) + k%3 + 3];
+	}
+
+	double	hNew = 0.0;
+	while ( 1 ) {
+		if (Step(bodyData, acceleration) == 1) {
+			Error::_errMsg = "An error occurred during Gauss-Radau step!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+
+		double h = bodyData->h;
+		if (_errorMax > 0.0) {
+			hNew = pow(epsilon/_errorMax, 1.0/7.0) * h;
+		}
+		else {
+			hNew = h/SAFETY;
+		}
+		if (fabs(hNew/h) >= SAFETY) {
+			break;
+		}
+		// The step is rejected
+		nRejectedStep++;
+		if (fabs(hNew) < 1.0 / 86400.0) /* = 1 sec */ {
+			Error::_errMsg = "Stepsize-underflow occurred during Gauss-Radau step!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		bodyData->h = hNew;
+		if (_hLastDone != 0.0) {
+			PredictNextStep(n3, hNew/_hLastDone);
+		}
+		else {
+			for (int m = 0; m < 7; m++) {
+				memset(_b[m], 0, n3*sizeof(double));
+			}
+		}
+	}
+
+	double	h = bodyData->h;
+	if (fabs(hNew/h) > 1.0/SAFETY) {
+		hNew = h/SAFETY;
+	}
+
+	// The phases at the end of the step, the round-off errors are accumulated by compensated summation
+	for (int k = 0; k < n3; k++) {
+		int p = 6*(k/3) + k%3;
+		double dx = h*bodyData->y0[p + 3] + h*h*(_a0[k]/2.0 + _b[0][k]/6.0 + _b[1][k]/12.0 + _b[2][k]/20.0 + _b[3][k]/30.0 +
+												 _b[4][k]/42.0 + _b[5][k]/56.0 + _b[6][k]/72.0);
+		double dv = h*(_a0[k] + _b[0][k]/2.0 + _b[1][k]/3.0 + _b[2][k]/4.0 + _b[3][k]/5.0 + _b[4][k]/6.0 + _b[5][k]/7.0 + _b[6][k]/8.0);
+
+		double x = bodyData->y0[p];
+		double y = dx - _csx[k];
+		double t = x + y;
+		_csx[k] = (t - x) - y;
+		bodyData->y[p] = t;
+
+		double v = bodyData->y0[p + 3];
+		y = dv - _csv[k];
+		t = v + y;
+		_csv[k] = (t - v) - y;
+		bodyData->y[p + 3] = t;
+	}
+
+	_hLastDone = h;
+	for (int m = 0; m < 7; m++) {
+		memcpy(_er[m], _e[m], n3*sizeof(double));
+		memcpy(_br[m], _b[m], n3*sizeof(double));
+	}
+	PredictNextStep(n3, hNew/h);
+
+	timeLine->hDid = h;
+	// Update time
+	timeLine->time += timeLine->hDid;
+	bodyData->time = timeLine->time;
+	timeLine->hNext = hNew;
+	bodyData->h = timeLine->hNext;
+	// Update the phases of the system
+	std::swap(bodyData->y0, bodyData->y);
+	memcpy(_yLast, bodyData->y0, nVar*sizeof(double));
+	_nLast = nTotal;
+
+	return 0;
+}
+
+/**
+ * Extrapolates the coefficients of the last accepted step to a step which is ratio times longer.
+ * The difference between the converged and the predicted coefficients of the last step is added
+ * as a correction.
+ */
+void GaussRadau15::PredictNextStep(int n3, double ratio)
+{
+	if (ratio > MAXRATIO) {
+		for (int m = 0; m < 7; m++) {
+			memset(_e[m], 0, n3*sizeof(double));
+			memset(_b[m], 0, n3*sizeof(double));
+		}
+		return;
+	}
+	// binomial[j][m] = (j+1 choose m+1)
+	static const double binomial[7][7] = {
+		{ 1.0,  0.0,  0.0,  0.0,  0.0, 0.0, 0.0},
+		{ 2.0,  1.0,  0.0,  0.0,  0.0, 0.0, 0.0},
+		{ 3.0,  3.0,  1.0,  0.0,  0.0, 0.0, 0.0},
+		{ 4.0,  6.0,  4.0,  1.0,  0.0, 0.0, 0.0},
+		{ 5.0, 10.0, 10.0,  5.0,  1.0, 0.0, 0.0},
+		{ 6.0, 15.0, 20.0, 15.0,  6.0, 1.0, 0.0},
+		{ 7.0, 21.0, 35.0, 35.0, 21.0, 7.0, 1.0}
+	};
+	double q[7];
+	q[0] = ratio;
+	for (int m = 1; m < 7; m++) {
+		q[m] = q[m-1]*ratio;
+	}
+	for (int k = 0; k < n3; k++) {
+		for (int m = 0; m < 7; m++) {
+			double sum = 0.0;
+			for (int j = m; j < 7; j++) {
+				sum += binomial[j][m]*_br[j][k];
+			}
+			_e[m][k] = q[m]*sum;
+			_b[m][k] = _e[m][k] + (_br[m][k] - _er[m][k]);
+		}
+	}
+}
+#undef SAFETY
+#undef MAXRATIO
+
+// The predictor-corrector iteration is stopped if the relative change of the last coefficient
+// is below PCEPSILON, if it does not decrease any more or after PCMAXITER iterations
+#define PCEPSILON	1.0e-16
+#define PCMAXITER	12
+int GaussRadau15::Step(BodyData *bodyData, Acceleration *acceleration)
+{
+	int		n3 = 3*bodyData->nBodies.total;
+	double	h = bodyData->h;
+	double	t = bodyData->time;
+	double	*y0 = bodyData->y0;
+	// The phases at the substeps
+	double	*ySub = bodyData->y;
+
+	for (int k = 0; k < n3; k++) {
+		for (int m = 0; m < 7; m++) {
+			double sum = 0.0;
+			for (int j = m; j < 7; j++) {
+				sum += UInv[m][j]*_b[j][k];
+			}
+			_g[m][k] = sum;
+		}
+	}
+	double	pcError = 2.0;
+	double	pcErrorLast = 3.0;
+	int		iteration = 0;
+	while ( 1 ) {
+		if (pcError < PCEPSILON) {
+			break;
+		}
+		if (iteration > 2 && pcErrorLast <= pcError) {
+			break;
+		}
+		if (iteration >= PCMAXITER) {
+			nNotConverged++;
+			break;
+		}
+		pcErrorLast = pcError;
+		iteration++;
+
+		double	maxDelta = 0.0;
+		double	maxA = 0.0;
+		for (int n = 1; n < 8; n++) {
+			double s = hs[n];
+			for (int k = 0; k < n3; k++) {
+				int p = 6*(k/3) + k%3;
+				double x = s*h*y0[p + 3] + s*s*h*h*(_a0[k]/2.0 + s*(_b[0][k]/6.0 + s*(_b[1][k]/12.0 + s*(_b[2][k]/20.0 +
+							s*(_b[3][k]/30.0 + s*(_b[4][k]/42.0 + s*(_b[5][k]/56.0 + s*_b[6][k]/72.0)))))));
+				double v = s*h*(_a0[k] + s*(_b[0][k]/2.0 + s*(_b[1][k]/3.0 + s*(_b[2][k]/4.0 + s*(_b[3][k]/5.0 +
+							s*(_b[4][k]/6.0 + s*(_b[5][k]/7.0 + s*_b[6][k]/8.0)))))));
+				ySub[p]		= y0[p] + (x - _csx[k]);
+				ySub[p + 3]	= y0[p + 3] + (v - _csv[k]);
+			}
+			int result = acceleration->Compute(t + s*h, ySub, _f);
+			HANDLE_RESULT(result);
+			nEvaluation++;
+
+			for (int k = 0; k < n3; k++) {
+				int p = 6*(k/3) + k%3;
+				_at[k] = _f[p + 3];
+				// The new value of the (n-1)th coefficient from the divided differences
+				double gNew = (_at[k] - _a0[k])/(hs[n] - hs[0]);
+				for (int m = 1; m < n; m++) {
+					gNew = (gNew - _g[m-1][k])/(hs[n] - hs[m]);
+				}
+				double delta = gNew - _g[n-1][k];
+				_g[n-1][k] = gNew;
+				for (int m = 0; m < n; m++) {
+					_b[m][k] += delta*U[m][n-1];
+				}
+				if (n == 7) {
+					maxDelta = std::max(maxDelta, fabs(delta));
+					maxA = std::max(maxA, fabs(_at[k]));
+				}
+			}
+		}
+		pcError = maxA > 0.0 ? maxDelta/maxA : 0.0;
+	}
+
+	// The estimate of the error of the step: the size of the last coefficient relative to the acceleration
+	double	maxB6 = 0.0;
+	double	maxA = 0.0;
+	for (int k = 0; k < n3; k++) {
+		maxB6 = std::max(maxB6, fabs(_b[6][k]));
+		maxA = std::max(maxA, fabs(_at[k]));
+	}
+	_errorMax = maxA > 0.0 ? maxB6/maxA : 0.0;
+
+	return 0;
+}
+#undef PCEPSILON
+#undef PCMAXITER
+
+void GaussRadau15::SetArrays(int n3)
+{
+	double *half[40];
+	for (int i = 0; i < 40; i++) {
+		half[i] = Workspace(i/2) + (i%2)*n3;
+	}
+	for (int m = 0; m < 7; m++) {
+		_b[m]  = half[m];
+		_g[m]  = half[7 + m];
+		_e[m]  = half[14 + m];
+		_br[m] = half[21 + m];
+		_er[m] = half[28 + m];
+	}
+	_a0		= half[35];
+	_at		= half[36];
+	_csx	= half[37];
+	_csv	= half[38];
+	_f		= Workspace(20);
+	_yLast	= Workspace(21);
+}
+
+/// Cold start: there are no coefficients to extrapolate from and no accumulated round-off
+void GaussRadau15::Reset(int n3)
+{
+	for (int m = 0; m < 7; m++) {
+		memset(_b[m],  0, n3*sizeof(double));
+		memset(_e[m],  0, n3*sizeof(double));
+		memset(_br[m], 0, n3*sizeof(double));
+		memset(_er[m], 0, n3*sizeof(double));
+	}
+	memset(_csx, 0, n3*sizeof(double));
+	memset(_csv, 0, n3*sizeof(double));
+	_hLastDone = 0.0;
+}
+
+/**
+ * The coefficients of the last step are saved only if they belong to the current phases, otherwise
+ * the integration restarts without extrapolation as it would without the checkpoint.
+ */
+void GaussRadau15::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	Integrator::SaveState(checkpoint, bodyData);
+	checkpoint.Write(nEvaluation);
+	checkpoint.Write(nNotConverged);
+
+	int		nTotal = bodyData->nBodies.total;
+	int		n3 = 3*nTotal;
+	bool	valid = _yLast != 0 && nTotal == _nLast && memcmp(bodyData->y0, _yLast, bodyData->nBodies.NOfVar()*sizeof(double)) == 0;
+	checkpoint.Write(valid);
+	if (!valid) {
+		return;
+	}
+	checkpoint.Write(_hLastDone);
+	for (int m = 0; m < 7; m++) {
+		checkpoint.WriteArray(_b[m],  n3);
+		checkpoint.WriteArray(_e[m],  n3);
+		checkpoint.WriteArray(_br[m], n3);
+		checkpoint.WriteArray(_er[m], n3);
+	}
+	checkpoint.WriteArray(_csx, n3);
+	checkpoint.WriteArray(_csv, n3);
+}
+
+int GaussRadau15::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	int result = Integrator::LoadState(checkpoint, bodyData);
+	HANDLE_RESULT(result);
+	checkpoint.Read(nEvaluation);
+	checkpoint.Read(nNotConverged);
+
+	bool valid = false;
+	checkpoint.Read(valid);
+	if (!valid || checkpoint.Failed()) {
+		_nLast = 0;
+		return 0;
+	}
+
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	int		n3 = 3*nTotal;
+	result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	SetArrays(n3);
+	checkpoint.Read(_hLastDone);
+	for (int m = 0; m < 7; m++) {
+		checkpoint.ReadArray(_b[m],  n3);
+		checkpoint.ReadArray(_e[m],  n3);
+		checkpoint.ReadArray(_br[m], n3);
+		checkpoint.ReadArray(_er[m], n3);
+	}
+	checkpoint.ReadArray(_csx, n3);
+	checkpoint.ReadArray(_csv, n3);
+	memcpy(_yLast, bodyData->y0, nVar*sizeof(double));
+	_nLast = nTotal;
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef GAUSSRADAU15_H_
+#define GAUSSRADAU15_H_
+
+#include <string>
+#include "Integrator.h"
+
+class Acceleration;
+class BodyData;
+class Checkpoint;
+class TimeLine;
+
+/**
+ * 15th order integrator based on Gauss-Radau spacings (IAS15). The acceleration is approximated
+ * by a 7th order polynomial in time whose coefficients are found by predictor-corrector
+ * iterations. The step size is chosen such that the contribution of the last coefficient
+ * relative to the acceleration is below epsilon. The coefficients of the last step are
+ * extrapolated to warm-start the iterations of the next one.
+ */
+class GaussRadau15 : public Integrator
+{
+public:
+	GaussRadau15();
+
+	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
+	int 		Step(  BodyData *bodyData, Acceleration *acceleration);
+	int			DenseOutput(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine, double t, double *y);
+	void		SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	int			LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+	// The number of the evaluations of the accelerations and of the steps in which the
+	// predictor-corrector iteration did not converge
+	int			nEvaluation;
+	int			nNotConverged;
+
+private:
+	void		SetArrays(int n3);
+	void		Reset(int n3);
+	void		PredictNextStep(int n3, double ratio);
+
+	// The Gauss-Radau spacings of the substeps in [0, 1]
+	double		hs[8];
+	// b = U g, g = UInv b: the conversion between the two representations of the polynomial
+	double		U[7][7];
+	double		UInv[7][7];
+
+	// The relative size of the last coefficient after the last Step()
+	double		_errorMax;
+	// The length of the last accepted step, 0 if there is none to extrapolate from
+	double		_hLastDone;
+	// The number of bodies at the end of the last step
+	int			_nLast;
+
+	// Views of the workspace, the coefficient arrays have 3*nBodies.total elements
+	double		*_b[7];
+	double		*_g[7];
+	double		*_e[7];
+	double		*_br[7];
+	double		*_er[7];
+	double		*_a0;
+	double		*_at;
+	double		*_csx;
+	double		*_csv;
+	// The derivatives at a substep and the phases at the end of the last step (NOfVar() elements)
+	double		*_f;
+	double		*_yLast;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "GravityKernel.h"
+#include "SolarisMacro.h"
+
+#if defined(_MSC_VER)
+// Returns the state of the registers enabled by the operating system (XCR0)
+static unsigned long long EnabledRegisterState()
+{
+	int info[4];
+	__cpuid(info, 1);
+	// OSXSAVE
+	if ((info[2] & (1 << 27)) == 0) {
+		return 0;
+	}
+	return _xgetbv(0);
+}
+#endif
+
+bool GravityKernel::IsSupported(gravity_kernel_t type)
+{
+	switch (type) {
+		case GRAVITY_KERNEL_SCALAR:
+			return true;
+		case GRAVITY_KERNEL_AVX2:
+#if defined(_MSC_VER)
+		{
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return false;
+			}
+			__cpuid(info, 1);
+			bool fma = (info[2] & (1 << 12)) != 0;
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			// The YMM and XMM states must be saved by the OS
+			return fma && avx2 && (EnabledRegisterState() & 0x6) == 0x6;
+		}
+#elif defined(__GNUC__)
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+			return false;
+#endif
+		case GRAVITY_KERNEL_AVX512:
+#if defined(_MSC_VER)
+		{
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			bool avx512f = (info[1] & (1 << 16)) != 0;
+			// The opmask, ZMM and YMM states must be saved by the OS
+			return avx512f && (EnabledRegisterState() & 0xE6) == 0xE6;
+		}
+#elif defined(__GNUC__)
+			return __builtin_cpu_supports("avx512f") != 0;
+#else
+			return false;
+#endif
+		default:
+			return false;
+	}
+}
+
+/// Returns the widest kernel the processor is able to execute.
+gravity_kernel_t GravityKernel::Best()
+{
+	if (IsSupported(GRAVITY_KERNEL_AVX512)) {
+		return GRAVITY_KERNEL_AVX512;
+	}
+	if (IsSupported(GRAVITY_KERNEL_AVX2)) {
+		return GRAVITY_KERNEL_AVX2;
+	}
+	return GRAVITY_KERNEL_SCALAR;
+}
+
+gravity_kernel_func_t GravityKernel::Get(gravity_kernel_t type)
+{
+	switch (type) {
+		case GRAVITY_KERNEL_AVX2:
+			return Avx2;
+		case GRAVITY_KERNEL_AVX512:
+			return Avx512;
+		default:
+			return Scalar;
+	}
+}
+
+gravity_kernel_float_func_t GravityKernel::GetFloat(gravity_kernel_t type)
+{
+	switch (type) {
+		case GRAVITY_KERNEL_AVX2:
+			return Avx2Float;
+		case GRAVITY_KERNEL_AVX512:
+			return Avx512Float;
+		default:
+			return ScalarFloat;
+	}
+}
+
+const char* GravityKernel::Name(gravity_kernel_t type)
+{
+	switch (type) {
+		case GRAVITY_KERNEL_AUTO:
+			return "auto";
+		case GRAVITY_KERNEL_SCALAR:
+			return "scalar";
+		case GRAVITY_KERNEL_AVX2:
+			return "avx2";
+		case GRAVITY_KERNEL_AVX512:
+			return "avx512";
+		default:
+			return "undefined";
+	}
+}
+
+void GravityKernel::Scalar(int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+						   double xi, double yi, double zi, double *a)
+{
+	// The bodies are sorted with increasing mass, therefore to
+	// increase the accuracy the lightest ones are added first
+	for (int j = j1 - 1; j >= j0; j--) {
+		double dxij = x[j] - xi;
+		double dyij = y[j] - yi;
+		double dzij = z[j] - zi;
+		double rij2 = SQR(dxij) + SQR(dyij) + SQR(dzij);
+		double rij  = sqrt(rij2);
+
+		// c = m_j/rij^3
+		double c = m[j] * 1.0/(rij2*rij);
+		a[0] += c*dxij;
+		a[1] += c*dyij;
+		a[2] += c*dzij;
+	}
+}
+
+void GravityKernel::ScalarFloat(int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+								double xi, double yi, double zi, double *a)
+{
+	float ax = 0.0f, ay = 0.0f, az = 0.0f;
+	for (int j = j1 - 1; j >= j0; j--) {
+		float dxij = (float)(x[j] - xi);
+		float dyij = (float)(y[j] - yi);
+		float dzij = (float)(z[j] - zi);
+		float rij2 = dxij*dxij + dyij*dyij + dzij*dzij;
+
+		float c = m[j]/(rij2*sqrtf(rij2));
+		ax += c*dxij;
+		ay += c*dyij;
+		az += c*dzij;
+	}
+	a[0] += ax;
+	a[1] += ay;
+	a[2] += az;
+}
+
+void GravityKernel::SymmetricRow(int i, int n, const double *x, const double *y, const double *z, const double *m,
+								 double *ax, double *ay, double *az)
+{
+	const double xi = x[i];
+	const double yi = y[i];
+	const double zi = z[i];
+	const double mi = m[i];
+
+	double axi = 0.0, ayi = 0.0, azi = 0.0;
+	for (int j = i + 1; j < n; j++) {
+		double dxij = x[j] - xi;
+		double dyij = y[j] - yi;
+		double dzij = z[j] - zi;
+		double rij2 = SQR(dxij) + SQR(dyij) + SQR(dzij);
+		// One square root and one division serve both bodies of the pair
+		double rijm3 = 1.0/(rij2*sqrt(rij2));
+
+		double ci = m[j]*rijm3;
+		axi += ci*dxij;
+		ayi += ci*dyij;
+		azi += ci*dzij;
+		double cj = mi*rijm3;
+		ax[j] -= cj*dxij;
+		ay[j] -= cj*dyij;
+		az[j] -= cj*dzij;
+	}
+	ax[i] += axi;
+	ay[i] += ayi;
+	az[i] += azi;
+}
@@ -0,0 +1,57 @@
+#ifndef GRAVITYKERNEL_H_
+#define GRAVITYKERNEL_H_
+
+#include "SolarisType.h"
+
+/**
+ * Signature of the pairwise gravity kernels. The kernel sums m[j]*(r_j - r_i)/r_ij^3 for
+ * j in [j0, j1) into a[0..2] (the Gaussian gravitational constant is NOT applied). The kernels
+ * contain no branches, the close pairs are searched by the CollisionDetector.
+ * The x, y, z and m arrays are the structure-of-arrays mirror of the positions and masses.
+ */
+typedef void (*gravity_kernel_func_t)(int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+									  double xi, double yi, double zi, double *a);
+
+/**
+ * Mixed precision version of gravity_kernel_func_t: the differences of the coordinates are
+ * computed in double and rounded to float, the rest of the terms are computed and summed in
+ * float, and the sum of a call is added to the double a[0..2]. Twice as many bodies fit into
+ * a register as in the double kernels.
+ */
+typedef void (*gravity_kernel_float_func_t)(int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+											double xi, double yi, double zi, double *a);
+
+class GravityKernel
+{
+public:
+	static bool		IsSupported(gravity_kernel_t type);
+	static gravity_kernel_t	Best();
+	static gravity_kernel_func_t Get(gravity_kernel_t type);
+	static gravity_kernel_float_func_t GetFloat(gravity_kernel_t type);
+	static const char* Name(gravity_kernel_t type);
+
+	// Reference implementation, it visits j in decreasing order, like the original loops
+	static void		Scalar(int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+						   double xi, double yi, double zi, double *a);
+	// 4 source bodies per instruction, compiled with /arch:AVX2 (GravityKernelAVX2.cpp)
+	static void		Avx2(  int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+						   double xi, double yi, double zi, double *a);
+	// 8 source bodies per instruction, compiled with /arch:AVX512 (GravityKernelAVX512.cpp)
+	static void		Avx512(int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+						   double xi, double yi, double zi, double *a);
+
+	// Mixed precision kernels of the test particle forces
+	static void		ScalarFloat(int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+								double xi, double yi, double zi, double *a);
+	static void		Avx2Float(  int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+								double xi, double yi, double zi, double *a);
+	static void		Avx512Float(int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+								double xi, double yi, double zi, double *a);
+
+	// Symmetric (Newton's third law) kernel: it visits the pairs (i, j), j in (i, n) once and
+	// accumulates the acceleration into both bodies. The Gaussian gravitational constant is NOT applied.
+	static void		SymmetricRow(int i, int n, const double *x, const double *y, const double *z, const double *m,
+								 double *ax, double *ay, double *az);
+};
+
+#endif
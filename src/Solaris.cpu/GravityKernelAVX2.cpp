@@ -0,0 +1,100 @@
+// This file must be compiled with AVX2 code generation (/arch:AVX2), the kernel is
+// called only if GravityKernel::IsSupported(GRAVITY_KERNEL_AVX2) returned true.
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2,fma")
+#endif
+
+#include <cmath>
+#include <immintrin.h>
+
+#include "GravityKernel.h"
+
+void GravityKernel::Avx2(int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+						 double xi, double yi, double zi, double *a)
+{
+	const __m256d vxi  = _mm256_set1_pd(xi);
+	const __m256d vyi  = _mm256_set1_pd(yi);
+	const __m256d vzi  = _mm256_set1_pd(zi);
+
+	__m256d ax = _mm256_setzero_pd();
+	__m256d ay = _mm256_setzero_pd();
+	__m256d az = _mm256_setzero_pd();
+
+	int j = j0;
+	for ( ; j + 4 <= j1; j += 4) {
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), vxi);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), vyi);
+		__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + j), vzi);
+		__m256d r2 = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+
+		// c = m_j/rij^3
+		__m256d r = _mm256_sqrt_pd(r2);
+		__m256d c = _mm256_div_pd(_mm256_loadu_pd(m + j), _mm256_mul_pd(r2, r));
+		ax = _mm256_fmadd_pd(c, dx, ax);
+		ay = _mm256_fmadd_pd(c, dy, ay);
+		az = _mm256_fmadd_pd(c, dz, az);
+	}
+
+	double sx[4], sy[4], sz[4];
+	_mm256_storeu_pd(sx, ax);
+	_mm256_storeu_pd(sy, ay);
+	_mm256_storeu_pd(sz, az);
+	a[0] += (sx[0] + sx[1]) + (sx[2] + sx[3]);
+	a[1] += (sy[0] + sy[1]) + (sy[2] + sy[3]);
+	a[2] += (sz[0] + sz[1]) + (sz[2] + sz[3]);
+
+	// The remainder is processed by the reference kernel
+	if (j < j1) {
+		Scalar(j, j1, x, y, z, m, xi, yi, zi, a);
+	}
+}
+
+// Returns (float)(p[0..7] - q)
+static inline __m256 DifferenceToFloat(const double *p, __m256d q)
+{
+	__m128 lo = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(p    ), q));
+	__m128 hi = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(p + 4), q));
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+void GravityKernel::Avx2Float(int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+							  double xi, double yi, double zi, double *a)
+{
+	const __m256d vxi   = _mm256_set1_pd(xi);
+	const __m256d vyi   = _mm256_set1_pd(yi);
+	const __m256d vzi   = _mm256_set1_pd(zi);
+
+	__m256 ax = _mm256_setzero_ps();
+	__m256 ay = _mm256_setzero_ps();
+	__m256 az = _mm256_setzero_ps();
+
+	int j = j0;
+	for ( ; j + 8 <= j1; j += 8) {
+		__m256 dx = DifferenceToFloat(x + j, vxi);
+		__m256 dy = DifferenceToFloat(y + j, vyi);
+		__m256 dz = DifferenceToFloat(z + j, vzi);
+		__m256 r2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+
+
+		__m256 r = _mm256_sqrt_ps(r2);
+		__m256 c = _mm256_div_ps(_mm256_loadu_ps(m + j), _mm256_mul_ps(r2, r));
+		ax = _mm256_fmadd_ps(c, dx, ax);
+		ay = _mm256_fmadd_ps(c, dy, ay);
+		az = _mm256_fmadd_ps(c, dz, az);
+	}
+
+	// The lanes are summed in double precision
+	float sx[8], sy[8], sz[8];
+	_mm256_storeu_ps(sx, ax);
+	_mm256_storeu_ps(sy, ay);
+	_mm256_storeu_ps(sz, az);
+	for (int k = 0; k < 8; k++) {
+		a[0] += sx[k];
+		a[1] += sy[k];
+		a[2] += sz[k];
+	}
+
+	if (j < j1) {
+		ScalarFloat(j, j1, x, y, z, m, xi, yi, zi, a);
+	}
+}
@@ -0,0 +1,96 @@
+// This file must be compiled with AVX-512 code generation (/arch:AVX512), the kernel is
+// called only if GravityKernel::IsSupported(GRAVITY_KERNEL_AVX512) returned true.
+#if defined(__GNUC__) && !defined(__AVX512F__)
+#pragma GCC target("avx512f")
+#endif
+
+#include <cmath>
+#include <immintrin.h>
+
+#include "GravityKernel.h"
+
+void GravityKernel::Avx512(int j0, int j1, const double *x, const double *y, const double *z, const double *m,
+						   double xi, double yi, double zi, double *a)
+{
+	const __m512d vxi   = _mm512_set1_pd(xi);
+	const __m512d vyi   = _mm512_set1_pd(yi);
+	const __m512d vzi   = _mm512_set1_pd(zi);
+
+	__m512d ax = _mm512_setzero_pd();
+	__m512d ay = _mm512_setzero_pd();
+	__m512d az = _mm512_setzero_pd();
+
+	int j = j0;
+	for ( ; j + 8 <= j1; j += 8) {
+		__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), vxi);
+		__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), vyi);
+		__m512d dz = _mm512_sub_pd(_mm512_loadu_pd(z + j), vzi);
+		__m512d r2 = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+
+		// c = m_j/rij^3
+		__m512d r = _mm512_sqrt_pd(r2);
+		__m512d c = _mm512_div_pd(_mm512_loadu_pd(m + j), _mm512_mul_pd(r2, r));
+		ax = _mm512_fmadd_pd(c, dx, ax);
+		ay = _mm512_fmadd_pd(c, dy, ay);
+		az = _mm512_fmadd_pd(c, dz, az);
+	}
+
+	a[0] += _mm512_reduce_add_pd(ax);
+	a[1] += _mm512_reduce_add_pd(ay);
+	a[2] += _mm512_reduce_add_pd(az);
+
+	// The remainder is processed by the reference kernel
+	if (j < j1) {
+		Scalar(j, j1, x, y, z, m, xi, yi, zi, a);
+	}
+}
+
+// Returns (float)(p[0..15] - q)
+static inline __m512 DifferenceToFloat(const double *p, __m512d q)
+{
+	__m256 lo = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_loadu_pd(p    ), q));
+	__m256 hi = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_loadu_pd(p + 8), q));
+	return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+void GravityKernel::Avx512Float(int j0, int j1, const double *x, const double *y, const double *z, const float *m,
+								double xi, double yi, double zi, double *a)
+{
+	const __m512d vxi     = _mm512_set1_pd(xi);
+	const __m512d vyi     = _mm512_set1_pd(yi);
+	const __m512d vzi     = _mm512_set1_pd(zi);
+
+	__m512 ax = _mm512_setzero_ps();
+	__m512 ay = _mm512_setzero_ps();
+	__m512 az = _mm512_setzero_ps();
+
+	int j = j0;
+	for ( ; j + 16 <= j1; j += 16) {
+		__m512 dx = DifferenceToFloat(x + j, vxi);
+		__m512 dy = DifferenceToFloat(y + j, vyi);
+		__m512 dz = DifferenceToFloat(z + j, vzi);
+		__m512 r2 = _mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx)));
+
+
+		__m512 r = _mm512_sqrt_ps(r2);
+		__m512 c = _mm512_div_ps(_mm512_loadu_ps(m + j), _mm512_mul_ps(r2, r));
+		ax = _mm512_fmadd_ps(c, dx, ax);
+		ay = _mm512_fmadd_ps(c, dy, ay);
+		az = _mm512_fmadd_ps(c, dz, az);
+	}
+
+	// The lanes are summed in double precision
+	float sx[16], sy[16], sz[16];
+	_mm512_storeu_ps(sx, ax);
+	_mm512_storeu_ps(sy, ay);
+	_mm512_storeu_ps(sz, az);
+	for (int k = 0; k < 16; k++) {
+		a[0] += sx[k];
+		a[1] += sy[k];
+		a[2] += sz[k];
+	}
+
+	if (j < j1) {
+		ScalarFloat(j, j1, x, y, z, m, xi, yi, zi, a);
+	}
+}
@@ -0,0 +1,545 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "HybridSymplectic.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Checkpoint.h"
+#include "Constants.h"
+#include "Error.h"
+#include "TimeLine.h"
+#include "SolarisMacro.h"
+#include "SolarisType.h"
+
+HybridSymplectic::HybridSymplectic()
+{
+	name			= "Hybrid symplectic";
+	reference		= "Chambers, J. E., 1999, MNRAS 304, 793";
+	// The interactions, the phases at the end of the last step and at the start of the drift
+	nWorkspaceArray	= 3;
+
+	changeoverFactor= 3.0;
+	collisionFactor	= 0.0;
+	nEncounter		= 0;
+	nEncounterStep	= 0;
+
+	_nCrit			= 0;
+	_searchContact	= false;
+	_contactFound	= false;
+	_contactTime	= 0.0;
+	_contact.i		= 0;
+	_contact.j		= 0;
+	_contact.distance = 0.0;
+}
+
+int HybridSymplectic::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
+{
+	if (hFixed == 0.0) {
+		double period = ShortestPeriod(bodyData);
+		if (period <= 0.0) {
+			Error::_errMsg = "The hybrid symplectic integrator needs at least one body on a bound orbit!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		hFixed = period / stepsPerOrbit;
+	}
+	if (bodyData->nBodies.total != _nCrit) {
+		ChangeoverRadii(bodyData);
+	}
+	// The step is shortened only if the Simulator clipped it to reach an output or the end time
+	double	h = timeLine->hNext >= 0.0 ? hFixed : -hFixed;
+	if (fabs(timeLine->hNext) < hFixed) {
+		h = timeLine->hNext;
+	}
+
+	bodyData->time	= timeLine->time;
+	bodyData->h		= h;
+
+	collisions.clear();
+	_searchContact	= collisionFactor > 0.0;
+	_contactFound	= false;
+	if (Step(bodyData, h) == 1) {
+		Error::_errMsg = "An error occurred during hybrid symplectic step!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	// The step is repeated up to the earliest contact, the pair is merged by the Simulator
+	if (_contactFound) {
+		h = _contactTime;
+		_searchContact = false;
+		if (Step(bodyData, h) == 1) {
+			Error::_errMsg = "An error occurred during hybrid symplectic step!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		collisions.push_back(_contact);
+	}
+
+	timeLine->hDid = h;
+	// Update time
+	timeLine->time += timeLine->hDid;
+	bodyData->time = timeLine->time;
+	// The next step is again the fixed one
+	timeLine->hNext = h >= 0.0 ? hFixed : -hFixed;
+	bodyData->h = timeLine->hNext;
+	// Update the phases of the system
+	std::swap(bodyData->y0, bodyData->y);
+
+	return 0;
+}
+
+/**
+ * The changeover radius of a body is changeoverFactor times its Hill radius computed from its
+ * actual distance, the radius of a pair is the larger of the two. The radii are kept fixed between
+ * the changes of the number of bodies, otherwise the split of the Hamiltonian would change too.
+ */
+void HybridSymplectic::ChangeoverRadii(BodyData *bodyData)
+{
+	int		nTotal = bodyData->nBodies.total;
+	double	m0 = bodyData->mass[0];
+
+	_rcrit.resize(nTotal);
+	_rcrit[0] = 0.0;
+	for (int i=1; i<nTotal; i++) {
+		int i0 = 6*i;
+		double r = sqrt(SQR(bodyData->y0[i0 + 0]) + SQR(bodyData->y0[i0 + 1]) + SQR(bodyData->y0[i0 + 2]));
+		_rcrit[i] = bodyData->mass[i] > 0.0 ? changeoverFactor*r*pow(bodyData->mass[i]/(3.0*m0), 1.0/3.0) : 0.0;
+	}
+	_nCrit = nTotal;
+	// The interactions of the last step were computed with the old radii
+	_interactionValid = false;
+}
+
+/**
+ * The changeover function of Chambers (1999): K = 0 within 0.1 rc, K = 1 beyond rc and a quintic
+ * polynomial in between, whose first and second derivatives vanish at both ends.
+ */
+double HybridSymplectic::Changeover(double r, double rc, double &dKdr)
+{
+	double x = (r - 0.1*rc)/(0.9*rc);
+	if (x <= 0.0) {
+		dKdr = 0.0;
+		return 0.0;
+	}
+	if (x >= 1.0) {
+		dKdr = 0.0;
+		return 1.0;
+	}
+	dKdr = 30.0*SQR(x)*SQR(1.0 - x)/(0.9*rc);
+	return CUBE(x)*(10.0 - 15.0*x + 6.0*SQR(x));
+}
+
+/**
+ * The accelerations derived from the K(r) part of the mutual potentials, the central body is
+ * excluded. Beyond the changeover radius this is the full Newtonian interaction.
+ */
+void HybridSymplectic::Interaction(BodyData *bodyData, const double *y, double *a)
+{
+	int nTotal = bodyData->nBodies.total;
+	int nMassive = bodyData->nBodies.NOfMassive();
+	int nSource = nMassive + bodyData->nBodies.superPlanetsimal;
+	bool parallel = nTotal >= Constants::ParallelThreshold;
+
+	a[0] = a[1] = a[2] = 0.0;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
+		double ax = 0.0, ay = 0.0, az = 0.0;
+		int i0 = 6*i;
+		int n = bodyData->type[i] <= BODY_TYPE_PROTOPLANET ? nSource : nMassive;
+		for (int j=1; j<n; j++) {
+			if (j == i)
+				continue;
+			int j0 = 6*j;
+			double xij = y[j0 + 0] - y[i0 + 0];
+			double yij = y[j0 + 1] - y[i0 + 1];
+			double zij = y[j0 + 2] - y[i0 + 2];
+			double rij2 = SQR(xij) + SQR(yij) + SQR(zij);
+			double rij = sqrt(rij2);
+			double rc = std::max(_rcrit[i], _rcrit[j]);
+			double Gmj = Constants::Gauss2*bodyData->mass[j];
+			double w = 0.0;
+			if (rij2 >= SQR(rc)) {
+				w = Gmj/(rij2*rij);
+			}
+			else {
+				double dKdr = 0.0;
+				double K = Changeover(rij, rc, dKdr);
+				w = Gmj*(K/(rij2*rij) - dKdr/rij2);
+			}
+			ax += w*xij;
+			ay += w*yij;
+			az += w*zij;
+		}
+		a[3*i + 0] = ax;
+		a[3*i + 1] = ay;
+		a[3*i + 2] = az;
+	}
+	nInteraction++;
+}
+
+/**
+ * Every body is advanced on its Keplerian orbit, then the pairs which came within their changeover
+ * radius during the step are collected into groups and the members of each group are integrated
+ * again from the start of the drift by the sub-integrator.
+ */
+int HybridSymplectic::Drift(BodyData *bodyData, double h, double *y)
+{
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	double	*yStart = Workspace(2);
+
+	memcpy(yStart, y, nVar*sizeof(double));
+	if (WisdomHolman::Drift(bodyData, h, y) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	FindEncounters(bodyData, h, yStart, y);
+	if (_pair.size() == 0) {
+		return 0;
+	}
+
+	_parent.resize(nTotal);
+	for (int i=0; i<nTotal; i++) {
+		_parent[i] = i;
+	}
+	_involved.clear();
+	for (std::vector<CollisionPair>::const_iterator it = _pair.begin(); it != _pair.end(); it++) {
+		int ri = Root(it->i);
+		int rj = Root(it->j);
+		if (ri != rj) {
+			_parent[std::max(ri, rj)] = std::min(ri, rj);
+		}
+		_involved.push_back(it->i);
+		_involved.push_back(it->j);
+	}
+	std::sort(_involved.begin(), _involved.end());
+	_involved.erase(std::unique(_involved.begin(), _involved.end()), _involved.end());
+
+	for (std::vector<int>::const_iterator it = _involved.begin(); it != _involved.end(); it++) {
+		if (Root(*it) != *it) {
+			continue;
+		}
+		_member.clear();
+		for (std::vector<int>::const_iterator jt = it; jt != _involved.end(); jt++) {
+			if (Root(*jt) == *it) {
+				_member.push_back(*jt);
+			}
+		}
+		for (std::vector<int>::const_iterator jt = _member.begin(); jt != _member.end(); jt++) {
+			memcpy(&y[6*(*jt)], &yStart[6*(*jt)], 6*sizeof(double));
+		}
+		if (IntegrateGroup(bodyData, h, y) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		nEncounter++;
+	}
+
+	return 0;
+}
+
+/**
+ * Collects the interacting pairs whose distance was smaller than their changeover radius at the start
+ * or at the end of the Kepler drift, or at the closest approach of their relative motion if they
+ * approached each other at the start and receded at the end.
+ */
+int HybridSymplectic::FindEncounters(BodyData *bodyData, double h, const double *yStart, const double *y)
+{
+	int nTotal = bodyData->nBodies.total;
+	int nMassive = bodyData->nBodies.NOfMassive();
+	int nSource = nMassive + bodyData->nBodies.superPlanetsimal;
+	bool parallel = nTotal >= Constants::ParallelThreshold;
+
+	_pair.clear();
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+#endif
+	for (int j=2; j<nTotal; j++) {
+		int j0 = 6*j;
+		// The pairs (i, j), i < j, in which i acts on j: the bodies of j are the prefix of the list
+		int n = std::min(j, bodyData->type[j] <= BODY_TYPE_PROTOPLANET ? nSource : nMassive);
+		for (int i=1; i<n; i++) {
+			double rc = std::max(_rcrit[i], _rcrit[j]);
+			int i0 = 6*i;
+			double dx0[3], dv0[3], dx1[3], dv1[3];
+			for (int k=0; k<3; k++) {
+				dx0[k] = yStart[j0 + k] - yStart[i0 + k];
+				dv0[k] = yStart[j0 + 3 + k] - yStart[i0 + 3 + k];
+				dx1[k] = y[j0 + k] - y[i0 + k];
+				dv1[k] = y[j0 + 3 + k] - y[i0 + 3 + k];
+			}
+			double d0 = SQR(dx0[0]) + SQR(dx0[1]) + SQR(dx0[2]);
+			double d1 = SQR(dx1[0]) + SQR(dx1[1]) + SQR(dx1[2]);
+			double dmin = std::min(d0, d1);
+			double rv0 = dx0[0]*dv0[0] + dx0[1]*dv0[1] + dx0[2]*dv0[2];
+			double rv1 = dx1[0]*dv1[0] + dx1[1]*dv1[1] + dx1[2]*dv1[2];
+			if (rv0*h < 0.0 && rv1*h > 0.0) {
+				double v2 = SQR(dv0[0]) + SQR(dv0[1]) + SQR(dv0[2]);
+				dmin = std::min(dmin, d0 - SQR(rv0)/v2);
+			}
+			if (dmin < SQR(rc)) {
+				CollisionPair pair;
+				pair.i = i;
+				pair.j = j;
+				pair.distance = sqrt(std::max(dmin, 0.0));
+#ifdef _OPENMP
+				#pragma omp critical
+#endif
+				_pair.push_back(pair);
+			}
+		}
+	}
+
+	return 0;
+}
+
+int HybridSymplectic::Root(int i)
+{
+	while (_parent[i] != i) {
+		_parent[i] = _parent[_parent[i]];
+		i = _parent[i];
+	}
+	return i;
+}
+
+// constants for the Bulirsch-Stoer sub-integrator
+// The number of the modified midpoint sequences, the kth one takes 2(k + 1) substeps
+#define SEQUENCE	8
+#define SAFETY		0.94
+#define REDUCE		0.65
+#define SHRINK		0.25
+#define GROW		4.0
+/**
+ * Integrates the Keplerian motion and the 1-K part of the mutual interactions of the members of the
+ * group for h by the Bulirsch-Stoer method: the results of the modified midpoint method with
+ * 2, 4, 6, ... substeps are extrapolated to zero step size until two consecutive extrapolations
+ * agree within epsilon. If a contact is searched the integration stops at the first one.
+ */
+int HybridSymplectic::IntegrateGroup(BodyData *bodyData, double h, double *y)
+{
+	int g = (int)_member.size();
+	int m = 6*g;
+
+	_ys.resize(m);
+	_yMid.resize(m);
+	_f0.resize(m);
+	_fm.resize(m);
+	_z0.resize(m);
+	_z1.resize(m);
+	_table.resize(SEQUENCE*m);
+	for (int p=0; p<g; p++) {
+		memcpy(&_ys[6*p], &y[6*_member[p]], 6*sizeof(double));
+	}
+
+	double t = 0.0;
+	// The first trial is a quarter of the step, the later ones follow from the error estimate
+	double H = 0.25*h;
+	while (fabs(t) < fabs(h)) {
+		if (fabs(t + H) > fabs(h)) {
+			H = h - t;
+		}
+		EncounterDerivative(bodyData, &_ys[0], &_f0[0]);
+
+		bool	accepted = false;
+		double	errorMax = 0.0;
+		int		k = 0;
+		for ( ; k<SEQUENCE; k++) {
+			ModifiedMidpoint(bodyData, &_ys[0], &_f0[0], H, 2*(k + 1), &_yMid[0]);
+			// Aitken-Neville extrapolation in H^2: the rows of the table hold the last diagonal
+			for (int c=0; c<m; c++) {
+				double value = _yMid[c];
+				for (int l=1; l<=k; l++) {
+					double old = _table[(l - 1)*m + c];
+					_table[(l - 1)*m + c] = value;
+					double ratio = (double)(k + 1)/(double)(k + 1 - l);
+					value += (value - old)/(SQR(ratio) - 1.0);
+				}
+				_table[k*m + c] = value;
+			}
+			if (k == 0) {
+				continue;
+			}
+			errorMax = 0.0;
+			for (int p=0; p<g; p++) {
+				const double *yp = &_ys[6*p];
+				double rScale = sqrt(SQR(yp[0]) + SQR(yp[1]) + SQR(yp[2]));
+				double vScale = sqrt(SQR(yp[3]) + SQR(yp[4]) + SQR(yp[5]));
+				for (int c=6*p; c<6*p + 6; c++) {
+					double e = fabs(_table[k*m + c] - _table[(k - 1)*m + c])/(c - 6*p < 3 ? rScale : vScale);
+					errorMax = std::max(errorMax, e);
+				}
+			}
+			errorMax /= epsilon;
+			if (errorMax <= 1.0) {
+				accepted = true;
+				break;
+			}
+		}
+		if (!accepted) {
+			H *= SHRINK;
+			if (fabs(H) < 1.0e-12*fabs(h)) {
+				Error::_errMsg = "The step size of the close encounter sub-integrator became too small!";
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			continue;
+		}
+
+		memcpy(&_ys[0], &_table[k*m], m*sizeof(double));
+		t += H;
+		nEncounterStep++;
+
+		CollisionPair pair;
+		if (_searchContact && FindContact(bodyData, &_ys[0], pair)) {
+			if (!_contactFound || fabs(t) < fabs(_contactTime)) {
+				_contactFound = true;
+				_contactTime = t;
+				_contact = pair;
+			}
+			// The step will be repeated up to the contact, the rest of the encounter is not needed
+			return 0;
+		}
+
+		double factor = errorMax > 0.0 ? SAFETY*pow(REDUCE/errorMax, 1.0/(2*k + 1)) : GROW;
+		H *= std::max(SHRINK, std::min(GROW, factor));
+	}
+
+	for (int p=0; p<g; p++) {
+		memcpy(&y[6*_member[p]], &_ys[6*p], 6*sizeof(double));
+	}
+
+	return 0;
+}
+#undef SEQUENCE
+#undef SAFETY
+#undef REDUCE
+#undef SHRINK
+#undef GROW
+
+/// The modified midpoint method with n substeps over H, f0 is the derivative at ys
+void HybridSymplectic::ModifiedMidpoint(BodyData *bodyData, const double *ys, const double *f0, double H, int n, double *yout)
+{
+	int m = 6*(int)_member.size();
+	double hs = H/n;
+	double *z0 = &_z0[0];
+	double *z1 = &_z1[0];
+	double *fm = &_fm[0];
+
+	for (int c=0; c<m; c++) {
+		z0[c] = ys[c];
+		z1[c] = ys[c] + hs*f0[c];
+	}
+	for (int s=1; s<n; s++) {
+		EncounterDerivative(bodyData, z1, fm);
+		for (int c=0; c<m; c++) {
+			double z = z0[c] + 2.0*hs*fm[c];
+			z0[c] = z1[c];
+			z1[c] = z;
+		}
+	}
+	EncounterDerivative(bodyData, z1, fm);
+	for (int c=0; c<m; c++) {
+		yout[c] = 0.5*(z0[c] + z1[c] + hs*fm[c]);
+	}
+}
+
+/**
+ * The derivatives of the members of the group: the velocities, the attraction of the central body
+ * and the accelerations derived from the 1-K part of the mutual potentials within the group.
+ */
+void HybridSymplectic::EncounterDerivative(BodyData *bodyData, const double *ys, double *f)
+{
+	int		g = (int)_member.size();
+	int		nMassive = bodyData->nBodies.NOfMassive();
+	int		nSource = nMassive + bodyData->nBodies.superPlanetsimal;
+	double	mu = Constants::Gauss2*bodyData->mass[0];
+
+	for (int p=0; p<g; p++) {
+		int i = _member[p];
+		const double *yi = &ys[6*p];
+		double r2 = SQR(yi[0]) + SQR(yi[1]) + SQR(yi[2]);
+		double c = -mu/(r2*sqrt(r2));
+		double ax = c*yi[0];
+		double ay = c*yi[1];
+		double az = c*yi[2];
+
+		int n = bodyData->type[i] <= BODY_TYPE_PROTOPLANET ? nSource : nMassive;
+		for (int q=0; q<g; q++) {
+			int j = _member[q];
+			if (q == p || j >= n)
+				continue;
+			const double *yj = &ys[6*q];
+			double xij = yj[0] - yi[0];
+			double yij = yj[1] - yi[1];
+			double zij = yj[2] - yi[2];
+			double rij2 = SQR(xij) + SQR(yij) + SQR(zij);
+			double rc = std::max(_rcrit[i], _rcrit[j]);
+			if (rij2 >= SQR(rc))
+				continue;
+			double rij = sqrt(rij2);
+			double dKdr = 0.0;
+			double K = Changeover(rij, rc, dKdr);
+			double w = Constants::Gauss2*bodyData->mass[j]*((1.0 - K)/(rij2*rij) + dKdr/rij2);
+			ax += w*xij;
+			ay += w*yij;
+			az += w*zij;
+		}
+		f[6*p + 0] = yi[3];
+		f[6*p + 1] = yi[4];
+		f[6*p + 2] = yi[5];
+		f[6*p + 3] = ax;
+		f[6*p + 4] = ay;
+		f[6*p + 5] = az;
+	}
+}
+
+/// True if two members of the group with mass are closer than collisionFactor times the sum of their radii
+bool HybridSymplectic::FindContact(BodyData *bodyData, const double *ys, CollisionPair &pair)
+{
+	int g = (int)_member.size();
+
+	for (int p=0; p<g; p++) {
+		for (int q=p+1; q<g; q++) {
+			int i = _member[p];
+			int j = _member[q];
+			double R = collisionFactor*(bodyData->radius[i] + bodyData->radius[j]);
+			if (R <= 0.0 || (bodyData->mass[i] == 0.0 && bodyData->mass[j] == 0.0))
+				continue;
+			double d = sqrt(SQR(ys[6*q + 0] - ys[6*p + 0]) + SQR(ys[6*q + 1] - ys[6*p + 1]) + SQR(ys[6*q + 2] - ys[6*p + 2]));
+			if (d < R) {
+				pair.i = std::min(i, j);
+				pair.j = std::max(i, j);
+				pair.distance = d;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/// The changeover radii are saved since they were computed from the phases at the start of the integration.
+void HybridSymplectic::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	WisdomHolman::SaveState(checkpoint, bodyData);
+	checkpoint.Write(nEncounter);
+	checkpoint.Write(nEncounterStep);
+	checkpoint.Write(_nCrit);
+	checkpoint.WriteVector(_rcrit);
+}
+
+int HybridSymplectic::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	int result = WisdomHolman::LoadState(checkpoint, bodyData);
+	HANDLE_RESULT(result);
+	checkpoint.Read(nEncounter);
+	checkpoint.Read(nEncounterStep);
+	checkpoint.Read(_nCrit);
+	checkpoint.ReadVector(_rcrit);
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef HYBRIDSYMPLECTIC_H_
+#define HYBRIDSYMPLECTIC_H_
+
+#include <string>
+#include <vector>
+
+#include "CollisionDetector.h"
+#include "WisdomHolman.h"
+
+class Acceleration;
+class BodyData;
+class Checkpoint;
+class TimeLine;
+
+/**
+ * Hybrid symplectic integrator in the spirit of Chambers' Mercury. The mutual interaction of every
+ * pair is split by a smooth changeover function K(r) of their distance: the K part is applied in the
+ * kicks of the Wisdom-Holman map, the 1-K part, which is non-zero only within the changeover radius
+ * (changeoverFactor times the Hill radius), is integrated together with the Keplerian motion by a
+ * Bulirsch-Stoer sub-integrator for the groups of bodies in close encounter. Well separated bodies
+ * are advanced by the Kepler drift alone. If two bodies touch during an encounter the step is
+ * shortened to the time of the contact and the pair is reported in collisions.
+ */
+class HybridSymplectic : public WisdomHolman
+{
+public:
+	HybridSymplectic();
+
+	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
+	void		SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	int			LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+	// The radius of the changeover zone in units of the Hill radius of the bodies
+	double		changeoverFactor;
+	// Two bodies touch if their distance is smaller than collisionFactor times the sum of their radii,
+	// 0 disables the search for contacts
+	double		collisionFactor;
+	// The number of the groups integrated by the sub-integrator and of its accepted steps
+	int			nEncounter;
+	int			nEncounterStep;
+	// The pair which touched at the end of the last step, the Simulator merges and then removes it
+	std::vector<CollisionPair>	collisions;
+
+protected:
+	void		Interaction(BodyData *bodyData, const double *y, double *a);
+	int			Drift(BodyData *bodyData, double h, double *y);
+
+private:
+	static double Changeover(double r, double rc, double &dKdr);
+
+	void		ChangeoverRadii(BodyData *bodyData);
+	int			FindEncounters(BodyData *bodyData, double h, const double *yStart, const double *y);
+	int			Root(int i);
+	int			IntegrateGroup(BodyData *bodyData, double h, double *y);
+	void		EncounterDerivative(BodyData *bodyData, const double *ys, double *f);
+	void		ModifiedMidpoint(BodyData *bodyData, const double *ys, const double *f0, double H, int n, double *yout);
+	bool		FindContact(BodyData *bodyData, const double *ys, CollisionPair &pair);
+
+	// The changeover radius of the bodies, it is recomputed if the number of bodies changes
+	std::vector<double>	_rcrit;
+	int			_nCrit;
+
+	// The pairs in close encounter during the current step and the union-find forest of their bodies
+	std::vector<CollisionPair>	_pair;
+	std::vector<int>	_parent;
+	// The bodies of all pairs in close encounter and of the group which is integrated by the sub-integrator
+	std::vector<int>	_involved;
+	std::vector<int>	_member;
+
+	// The arrays of the sub-integrator, 6 elements per member (the extrapolation table has SEQUENCE rows)
+	std::vector<double>	_ys;
+	std::vector<double>	_yMid;
+	std::vector<double>	_f0;
+	std::vector<double>	_fm;
+	std::vector<double>	_z0;
+	std::vector<double>	_z1;
+	std::vector<double>	_table;
+
+	// True if the contacts are searched during the encounters of the current step
+	bool		_searchContact;
+	// The earliest contact of the current step and its time measured from the start of the step
+	bool		_contactFound;
+	double		_contactTime;
+	CollisionPair	_contact;
+};
+
+#endif
@@ -1,7 +1,191 @@
+#include <cmath>
+
 #include "Integrator.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Checkpoint.h"
+#include "Error.h"
+#include "TimeLine.h"
+#include "Tools.h"
+#include "SolarisMacro.h"
 
 Integrator::Integrator() : 
 	accuracy(-10.0)
 {
 	epsilon	 = pow(10, accuracy);
+
+	nAllocation		= 0;
+	nTrialStep		= 0;
+	nStageByte		= 0.0;
+	nRejectedStep	= 0;
+	stepControl		= STEP_CONTROL_CLASSIC;
+	denseOutput		= false;
+	_fEndTime		= 0.0;
+	_fEndY			= 0;
+	_fEndN			= 0;
+	nWorkspaceArray	= 0;
+	_workspace		= 0;
+	_workspaceStride= 0;
+	_errorOld		= 1.0e-4;
+	_rejected		= false;
+}
+
+Integrator::~Integrator()
+{
+	FreeWorkspace();
+}
+
+/// Makes room for nWorkspaceArray arrays of nVar doubles. The workspace only grows,
+/// therefore the removal of bodies does not cause a reallocation.
+int Integrator::AllocateWorkspace(int nVar)
+{
+	if (nVar <= _workspaceStride || nWorkspaceArray == 0) {
+		return 0;
+	}
+	FreeWorkspace();
+	// Round up to 8 doubles in order to keep every array 64 byte aligned
+	int stride = (nVar + 7) & ~7;
+	_workspace = (double *)Tools::AllocateAligned(nWorkspaceArray*stride*sizeof(double), 64);
+	HANDLE_NULL(_workspace);
+	_workspaceStride = stride;
+	nAllocation++;
+
+	return 0;
+}
+
+// The parameters of the PI controller, see Hairer & Wanner: Solving Ordinary Differential Equations II, Sec. IV.2
+#define PI_SAFETY	0.9
+#define PI_MINSCALE	0.2
+#define PI_MAXSCALE	5.0
+/**
+ * The PI controller scales the step by err^-alpha * errOld^beta, where errOld is the error of the last
+ * accepted step. The integral part alone is the classic controller, the proportional part damps the
+ * oscillation of the step size between accepted and rejected steps. After a rejection the step is not
+ * increased.
+ */
+double Integrator::PIStepFactor(double errorMax, int k)
+{
+	double beta  = 0.4/k;
+	double alpha = 1.0/k - 0.75*beta;
+	double scale = 0.0;
+
+	if (errorMax <= 1.0) {
+		if (errorMax == 0.0) {
+			scale = PI_MAXSCALE;
+		}
+		else {
+			scale = PI_SAFETY*pow(errorMax, -alpha)*pow(_errorOld, beta);
+			scale = scale < PI_MINSCALE ? PI_MINSCALE : (scale > PI_MAXSCALE ? PI_MAXSCALE : scale);
+		}
+		if (_rejected && scale > 1.0) {
+			scale = 1.0;
+		}
+		_errorOld = errorMax > 1.0e-4 ? errorMax : 1.0e-4;
+		_rejected = false;
+	}
+	else {
+		scale = PI_SAFETY*pow(errorMax, -alpha);
+		scale = scale < PI_MINSCALE ? PI_MINSCALE : scale;
+		_rejected = true;
+	}
+
+	return scale;
+}
+#undef PI_SAFETY
+#undef PI_MINSCALE
+#undef PI_MAXSCALE
+
+void Integrator::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	checkpoint.Write(epsilon);
+	checkpoint.Write(nTrialStep);
+	checkpoint.Write(nStageByte);
+	checkpoint.Write(nRejectedStep);
+	checkpoint.Write(_errorOld);
+	checkpoint.Write(_rejected);
+}
+
+int Integrator::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	checkpoint.Read(epsilon);
+	checkpoint.Read(nTrialStep);
+	checkpoint.Read(nStageByte);
+	checkpoint.Read(nRejectedStep);
+	checkpoint.Read(_errorOld);
+	checkpoint.Read(_rejected);
+
+	return 0;
+}
+
+/**
+ * The phases at time t within the last step (timeLine->time - timeLine->hDid, timeLine->time) by quintic Hermite interpolation of the positions,
+ * velocities and accelerations at its ends (the error of the positions is O(h^6)). It is valid for
+ * the integrators which leave the phases of the start of the step in bodyData->y and the
+ * derivatives there in bodyData->accel, the derivatives at the end are computed here once per step.
+ */
+int Integrator::DenseOutput(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine, double t, double *y)
+{
+	if (!denseOutput) {
+		Error::_errMsg = "The " + name + " integrator does not provide dense output!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	int		nTotal = bodyData->nBodies.total;
+	double	h = timeLine->hDid;
+	if (_fEndTime != timeLine->time || _fEndY != bodyData->y0 || _fEndN != nTotal || _fEnd.empty()) {
+		_fEnd.resize(bodyData->nBodies.NOfVar());
+		acceleration->evaluateGasDrag			= true;
+		acceleration->evaluateTypeIMigration	= true;
+		acceleration->evaluateTypeIIMigration	= true;
+		int result = acceleration->Compute(timeLine->time, bodyData->y0, &_fEnd[0]);
+		HANDLE_RESULT(result);
+		_fEndTime = timeLine->time;
+		_fEndY = bodyData->y0;
+		_fEndN = nTotal;
+	}
+
+	double s = h != 0.0 ? 1.0 - (timeLine->time - t)/h : 1.0;
+	Hermite(nTotal, h, s, bodyData->y, bodyData->accel, bodyData->y0, &_fEnd[0], y);
+
+	return 0;
+}
+
+/**
+ * The quintic Hermite interpolant of the phases of nBody bodies at the fraction s of the interval of
+ * length h between the phases yStart and yEnd with the derivatives fStart and fEnd.
+ */
+void Integrator::Hermite(int nBody, double h, double s, const double *yStart, const double *fStart, const double *yEnd, const double *fEnd, double *y)
+{
+	double s2 = s*s;
+	double s3 = s2*s;
+
+	// The Hermite basis functions of the changes of the positions and their derivatives by s
+	double H1 = s - 6.0*s3 + 8.0*s3*s - 3.0*s3*s2;
+	double H2 = (s2 - 3.0*s3 + 3.0*s3*s - s3*s2)/2.0;
+	double H3 = (s3 - 2.0*s3*s + s3*s2)/2.0;
+	double H4 = -4.0*s3 + 7.0*s3*s - 3.0*s3*s2;
+	double H5 = 10.0*s3 - 15.0*s3*s + 6.0*s3*s2;
+	double D1 = 1.0 - 18.0*s2 + 32.0*s3 - 15.0*s3*s;
+	double D2 = (2.0*s - 9.0*s2 + 12.0*s3 - 5.0*s3*s)/2.0;
+	double D3 = (3.0*s2 - 8.0*s3 + 5.0*s3*s)/2.0;
+	double D4 = -12.0*s2 + 28.0*s3 - 15.0*s3*s;
+	double D5 = 30.0*s2 - 60.0*s3 + 30.0*s3*s;
+
+	for (int i=0; i<nBody; i++) {
+		int i0 = 6*i;
+		for (int k=0; k<3; k++) {
+			int n = i0 + k;
+			double dx = yEnd[n] - yStart[n];
+			y[n]	 = yStart[n] + H5*dx + h*(H1*yStart[n + 3] + H4*yEnd[n + 3]) + h*h*(H2*fStart[n + 3] + H3*fEnd[n + 3]);
+			y[n + 3] = (h != 0.0 ? D5*dx/h : 0.0) + D1*yStart[n + 3] + D4*yEnd[n + 3] + h*(D2*fStart[n + 3] + D3*fEnd[n + 3]);
+		}
+	}
+}
+
+void Integrator::FreeWorkspace()
+{
+	Tools::FreeAligned(_workspace);
+	_workspace = 0;
+	_workspaceStride = 0;
 }
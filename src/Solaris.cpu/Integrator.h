@@ -2,22 +2,77 @@
 #define INTEGRATOR_H_
 
 #include <string>
+#include <vector>
+
+#include "SolarisType.h"
 
 class BodyData;
 class Acceleration;
+class Checkpoint;
 class TimeLine;
 
 class Integrator
 {
 public:
 	Integrator();
+	virtual ~Integrator();
 
 	std::string	name;
 	std::string	reference;
 	double		accuracy;
 	double		epsilon;
+	// The number of times the workspace was (re)allocated
+	int			nAllocation;
+	// The number of trial steps and the bytes streamed by their stage combination loops
+	int			nTrialStep;
+	double		nStageByte;
+	// The number of rejected trial steps
+	int			nRejectedStep;
+
+	// The step size control of the embedded Runge-Kutta methods: the classic one, or the PI controller of Gustafsson
+	step_control_t	stepControl;
+
+	// True if the phases within the last step can be computed by DenseOutput()
+	bool		denseOutput;
 
 	virtual int Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine) = 0;
+	virtual int DenseOutput(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine, double t, double *y);
+	static void	Hermite(int nBody, double h, double s, const double *yStart, const double *fStart, const double *yEnd, const double *fEnd, double *y);
+
+	int			AllocateWorkspace(int nVar);
+	void		FreeWorkspace();
+
+	// Write the state needed to continue the integration into a checkpoint and read it back. The
+	// phases in bodyData are restored before LoadState() is called.
+	virtual void SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	virtual int	LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+protected:
+	// The kth array of the workspace, the arrays start on 64 byte boundaries
+	double*		Workspace(int k)	{ return _workspace + k*_workspaceStride; }
+
+	// The number of nVar long arrays needed by the Step() of the integrator
+	int			nWorkspaceArray;
+
+	// The factor of the step size after a trial step with the scaled error errorMax (accepted if not
+	// greater than 1) given by the PI controller for an error estimate of O(h^k)
+	double		PIStepFactor(double errorMax, int k);
+
+private:
+	double		*_workspace;
+	// The capacity of one array of the workspace
+	int			_workspaceStride;
+
+	// The scaled error of the last accepted step and whether the last trial step was rejected
+	double		_errorOld;
+	bool		_rejected;
+
+	// The derivatives at the end of the last step used by DenseOutput(), and the time, phases and
+	// number of bodies they were computed for
+	std::vector<double>	_fEnd;
+	double				_fEndTime;
+	const double		*_fEndY;
+	int					_fEndN;
 };
 
 #endif
@@ -112,6 +112,68 @@ int NBodies::UpdateAfterRemove(body_type_t bodyType)
 	return 0;
 }
 
+int NBodies::UpdateAfterInsert(body_type_t bodyType, int n)
+{
+	switch (bodyType) {
+		case BODY_TYPE_STAR:
+			centralBody += n;
+			break;
+		case BODY_TYPE_GIANTPLANET:
+			giantPlanet += n;
+			break;
+		case BODY_TYPE_ROCKYPLANET:
+			rockyPlanet += n;
+			break;
+		case BODY_TYPE_PROTOPLANET:
+			protoPlanet += n;
+			break;
+		case BODY_TYPE_SUPERPLANETESIMAL:
+			superPlanetsimal += n;
+			break;
+		case BODY_TYPE_PLANETESIMAL:
+			planetsimal += n;
+			break;
+		case BODY_TYPE_TESTPARTICLE:
+			testParticle += n;
+			break;
+		default:
+			Error::_errMsg = "Unknown or undefined Body Type!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+	}
+	total += n;
+
+	return 0;
+}
+
+/// The index after the last body of the given type, since the bodies are sorted by their type
+int NBodies::IndexAfter(body_type_t bodyType)
+{
+	int index = 0;
+	// Each case falls through to add the bodies of the preceding types
+	switch (bodyType) {
+		case BODY_TYPE_TESTPARTICLE:
+			index += testParticle;
+		case BODY_TYPE_PLANETESIMAL:
+			index += planetsimal;
+		case BODY_TYPE_SUPERPLANETESIMAL:
+			index += superPlanetsimal;
+		case BODY_TYPE_PROTOPLANET:
+			index += protoPlanet;
+		case BODY_TYPE_ROCKYPLANET:
+			index += rockyPlanet;
+		case BODY_TYPE_GIANTPLANET:
+			index += giantPlanet;
+		case BODY_TYPE_STAR:
+			index += centralBody;
+			break;
+		default:
+			break;
+	}
+
+	return index;
+}
+
 std::ostream& operator<<(std::ostream& output, NBodies nBodies)
 {
 	output << "     centralBody: " << nBodies.centralBody << std::endl;
@@ -13,6 +13,8 @@ public:
 
 	int Count(std::list<Body *> &list);
 	int UpdateAfterRemove(body_type_t bodyType);
+	int UpdateAfterInsert(body_type_t bodyType, int n);
+	int IndexAfter(body_type_t bodyType);
 
 	int NOfMassive();
 	int NOfPlAndSpl();
@@ -0,0 +1,196 @@
+#include <cmath>
+
+#include "Octree.h"
+#include "SolarisMacro.h"
+
+Octree::Octree()
+{
+}
+
+/// Builds the tree from the bodies [first, last) of the interleaved y (x, y, z, vx, vy, vz) array.
+int Octree::Build(int first, int last, const double *y, const double *mass)
+{
+	int n = last - first;
+	_nodes.clear();
+	_index.resize(n > 0 ? n : 0);
+	if (n <= 0) {
+		return 0;
+	}
+	_work.resize(n);
+	_sorted.resize(n);
+
+	double min[3] = { y[6*first + 0], y[6*first + 1], y[6*first + 2] };
+	double max[3] = { min[0], min[1], min[2] };
+	for (int k = 0; k < n; k++) {
+		int i0 = 6*(first + k);
+		for (int d = 0; d < 3; d++) {
+			if (y[i0 + d] < min[d]) min[d] = y[i0 + d];
+			if (y[i0 + d] > max[d]) max[d] = y[i0 + d];
+		}
+		_index[k] = first + k;
+	}
+
+	OctreeNode root;
+	root.halfSize = 0.0;
+	for (int d = 0; d < 3; d++) {
+		root.center[d] = 0.5*(min[d] + max[d]);
+		if (0.5*(max[d] - min[d]) > root.halfSize) {
+			root.halfSize = 0.5*(max[d] - min[d]);
+		}
+	}
+	// Enlarge the cube a little in order to have every body strictly inside it
+	root.halfSize = root.halfSize > 0.0 ? 1.000001*root.halfSize : 1.0;
+	_nodes.push_back(root);
+	BuildNode(y, mass, 0, 0, n, 0);
+
+	// Copy the bodies in tree order, the leaves are traversed with unit stride
+	_x.resize(n);
+	_y.resize(n);
+	_z.resize(n);
+	_m.resize(n);
+	for (int k = 0; k < n; k++) {
+		int i0 = 6*_index[k];
+		_x[k] = y[i0 + 0];
+		_y[k] = y[i0 + 1];
+		_z[k] = y[i0 + 2];
+		_m[k] = mass[_index[k]];
+	}
+
+	return 0;
+}
+
+void Octree::BuildNode(const double *y, const double *mass, int node, int begin, int end, int depth)
+{
+	// The elements of _nodes may be relocated by the recursive calls, therefore
+	// they are referenced by index
+	double m = 0.0;
+	double com[3] = { 0.0, 0.0, 0.0 };
+	for (int k = begin; k < end; k++) {
+		int i = _index[k];
+		m      += mass[i];
+		com[0] += mass[i]*y[6*i + 0];
+		com[1] += mass[i]*y[6*i + 1];
+		com[2] += mass[i]*y[6*i + 2];
+	}
+	for (int d = 0; d < 3; d++) {
+		_nodes[node].com[d] = m > 0.0 ? com[d]/m : _nodes[node].center[d];
+	}
+	_nodes[node].mass  = m;
+	_nodes[node].first = begin;
+	_nodes[node].count = end - begin;
+	_nodes[node].child = -1;
+
+	if (end - begin <= LeafSize || depth >= MaxDepth) {
+		return;
+	}
+
+	// Sort the bodies of the cell into the octants: bit 0, 1 and 2 is set if x, y and z
+	// is on the upper side of the center, respectively
+	double center[3] = { _nodes[node].center[0], _nodes[node].center[1], _nodes[node].center[2] };
+	double halfSize = _nodes[node].halfSize;
+	int count[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	for (int k = begin; k < end; k++) {
+		int i0 = 6*_index[k];
+		int o = (y[i0 + 0] >= center[0] ? 1 : 0) | (y[i0 + 1] >= center[1] ? 2 : 0) | (y[i0 + 2] >= center[2] ? 4 : 0);
+		_work[k] = o;
+		count[o]++;
+	}
+	int offset[8];
+	offset[0] = begin;
+	for (int o = 1; o < 8; o++) {
+		offset[o] = offset[o - 1] + count[o - 1];
+	}
+	{
+		int next[8];
+		for (int o = 0; o < 8; o++) {
+			next[o] = offset[o];
+		}
+		for (int k = begin; k < end; k++) {
+			_sorted[next[_work[k]]++] = _index[k];
+		}
+		for (int k = begin; k < end; k++) {
+			_index[k] = _sorted[k];
+		}
+	}
+
+	int firstChild = (int)_nodes.size();
+	_nodes.resize(firstChild + 8);
+	_nodes[node].child = firstChild;
+	for (int o = 0; o < 8; o++) {
+		OctreeNode &c = _nodes[firstChild + o];
+		c.halfSize  = 0.5*halfSize;
+		c.center[0] = center[0] + ((o & 1) ? c.halfSize : -c.halfSize);
+		c.center[1] = center[1] + ((o & 2) ? c.halfSize : -c.halfSize);
+		c.center[2] = center[2] + ((o & 4) ? c.halfSize : -c.halfSize);
+		c.com[0] = c.com[1] = c.com[2] = 0.0;
+		c.mass  = 0.0;
+		c.child = -1;
+		c.first = offset[o];
+		c.count = 0;
+	}
+	for (int o = 0; o < 8; o++) {
+		if (count[o] > 0) {
+			BuildNode(y, mass, firstChild + o, offset[o], offset[o] + count[o], depth + 1);
+		}
+	}
+}
+
+/**
+ * Adds sum m_j*(r_j - r_i)/r_ij^3 of the bodies of the tree to a[0..2]. The body with index
+ * self is skipped. The Gaussian gravitational constant is NOT applied.
+ */
+void Octree::Evaluate(double xi, double yi, double zi, int self, double theta, double *a) const
+{
+	if (_nodes.empty()) {
+		return;
+	}
+
+	int stack[8*(MaxDepth + 1)];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const OctreeNode &node = _nodes[stack[--top]];
+		if (node.count == 0) {
+			continue;
+		}
+		if (node.child >= 0) {
+			double dx = node.com[0] - xi;
+			double dy = node.com[1] - yi;
+			double dz = node.com[2] - zi;
+			double r2 = SQR(dx) + SQR(dy) + SQR(dz);
+			// The cell is accepted if r > s/theta + delta, where s is the size of the cell and delta is
+			// the offset of the center of mass from the geometric center (Barnes 1994). A cell
+			// containing the body itself is always opened.
+			bool inside = fabs(xi - node.center[0]) <= node.halfSize &&
+						  fabs(yi - node.center[1]) <= node.halfSize &&
+						  fabs(zi - node.center[2]) <= node.halfSize;
+			double delta = sqrt(SQR(node.com[0] - node.center[0]) + SQR(node.com[1] - node.center[1]) + SQR(node.com[2] - node.center[2]));
+			double rOpen = 2.0*node.halfSize/theta + delta;
+			if (!inside && SQR(rOpen) < r2) {
+				double c = node.mass/(r2*sqrt(r2));
+				a[0] += c*dx;
+				a[1] += c*dy;
+				a[2] += c*dz;
+			}
+			else {
+				for (int o = 0; o < 8; o++) {
+					stack[top++] = node.child + o;
+				}
+			}
+			continue;
+		}
+		for (int k = node.first; k < node.first + node.count; k++) {
+			if (_index[k] == self) {
+				continue;
+			}
+			double dx = _x[k] - xi;
+			double dy = _y[k] - yi;
+			double dz = _z[k] - zi;
+			double r2 = SQR(dx) + SQR(dy) + SQR(dz);
+			double c = _m[k]/(r2*sqrt(r2));
+			a[0] += c*dx;
+			a[1] += c*dy;
+			a[2] += c*dz;
+		}
+	}
+}
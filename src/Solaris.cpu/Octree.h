@@ -0,0 +1,60 @@
+#ifndef OCTREE_H_
+#define OCTREE_H_
+
+#include <vector>
+
+/**
+ * A node of the octree. The children of a node are stored contiguously, child is the
+ * index of the first one or -1 for a leaf. The bodies of the node are the elements
+ * [first, first + count) of the tree ordered arrays.
+ */
+struct OctreeNode
+{
+	double	center[3];
+	double	halfSize;
+	// The center of mass and the total mass of the bodies in the cell
+	double	com[3];
+	double	mass;
+	int		child;
+	int		first;
+	int		count;
+};
+
+/**
+ * Barnes-Hut tree of a contiguous range of bodies. The cells are approximated by their
+ * center of mass (monopole) if they are seen under an angle smaller than the opening angle.
+ */
+class Octree
+{
+public:
+	Octree();
+
+	int		Build(int first, int last, const double *y, const double *mass);
+
+	void	Evaluate(double xi, double yi, double zi, int self, double theta, double *a) const;
+
+	int		NOfBodies() const	{ return (int)_index.size(); }
+	int		NOfNodes() const	{ return (int)_nodes.size(); }
+
+	// The maximum number of bodies in a leaf
+	static const int LeafSize = 8;
+	// Coincident bodies are not separated below this depth
+	static const int MaxDepth = 32;
+
+private:
+	void	BuildNode(const double *y, const double *mass, int node, int begin, int end, int depth);
+
+	std::vector<OctreeNode>	_nodes;
+
+	// Positions, masses and original indices of the bodies in tree order
+	std::vector<double>		_x;
+	std::vector<double>		_y;
+	std::vector<double>		_z;
+	std::vector<double>		_m;
+	std::vector<int>		_index;
+	// Work arrays of the build: the octant of the bodies and the sorted indices
+	std::vector<int>		_work;
+	std::vector<int>		_sorted;
+};
+
+#endif
@@ -11,8 +11,10 @@ Output::Output() {
     compositionProperties	= "CompositionProperties.dat";
     twoBodyAffair			= "TwoBodyAffair.dat";
     log						= "Log.txt";
+    checkpoint				= "Checkpoint.dat";
 
 	outputType = OUTPUT_TYPE_TEXT;
+	append = false;
 }
 
 std::string Output::GetPath(const std::string fileName)
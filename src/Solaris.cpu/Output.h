@@ -16,6 +16,8 @@ public:
 	static char directorySeparator;
 
 	output_type_t outputType;
+	// If true, the output files of an interrupted run are continued instead of being overwritten
+	bool append;
 
 	std::string phases;
 	std::string integrals;
@@ -24,6 +26,7 @@ public:
 	std::string compositionProperties;
 	std::string twoBodyAffair;
 	std::string log;
+	std::string checkpoint;
 };
 
 #endif
\ No newline at end of file
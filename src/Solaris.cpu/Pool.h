@@ -0,0 +1,59 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <new>
+#include <vector>
+
+/**
+ * Storage for many small objects of type T which live until the end of the run. The objects are
+ * constructed in place in blocks of blockSize consecutive objects, so creating them costs one
+ * allocation per block and the objects created one after the other lie next to each other in memory.
+ * The addresses never change, the objects are destroyed together by Clear() or by the destructor.
+ */
+template<class T> class Pool
+{
+public:
+	Pool(int blockSize = 4096) : _blockSize(blockSize), _nUsed(blockSize)	{ }
+	~Pool()											{ Clear(); }
+
+	T*		New()									{ return new (Next()) T(); }
+	template<class A> T*	New(const A &a)			{ return new (Next()) T(a); }
+
+	void	Clear()
+	{
+		for (size_t b = 0; b < _block.size(); b++) {
+			T *item = reinterpret_cast<T *>(_block[b]);
+			int n = b + 1 < _block.size() ? _blockSize : _nUsed;
+			for (int i = 0; i < n; i++) {
+				item[i].~T();
+			}
+			::operator delete(_block[b]);
+		}
+		_block.clear();
+		_nUsed = _blockSize;
+	}
+
+	// The number of the objects in the pool
+	int		Count() const							{ return _block.empty() ? 0 : ((int)_block.size() - 1)*_blockSize + _nUsed; }
+
+private:
+	Pool(const Pool &);
+	Pool& operator=(const Pool &);
+
+	// The memory of the next object, a new block is allocated when the last one is full
+	void*	Next()
+	{
+		if (_nUsed == _blockSize) {
+			_block.push_back(static_cast<char *>(::operator new(_blockSize*sizeof(T))));
+			_nUsed = 0;
+		}
+		return _block.back() + (_nUsed++)*sizeof(T);
+	}
+
+	int					_blockSize;
+	// The number of the objects in the last block
+	int					_nUsed;
+	std::vector<char *>	_block;
+};
+
+#endif
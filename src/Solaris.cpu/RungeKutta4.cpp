@@ -6,11 +6,31 @@
 #include "Acceleration.h"
 #include "BodyData.h"
 #include "Error.h"
+#include "RungeKuttaEngine.h"
 #include "TimeLine.h"
+#include "SolarisMacro.h"
+
+// The Butcher tableau of the classical method
+struct RungeKutta4Tableau { enum { nStage = 4 }; };
+
+BUTCHER_NODE(RungeKutta4Tableau, 1, 1.0/2.0)
+BUTCHER_NODE(RungeKutta4Tableau, 2, 1.0/2.0)
+BUTCHER_NODE(RungeKutta4Tableau, 3, 1.0)
+
+BUTCHER(RungeKutta4Tableau, 1, 0, 1.0/2.0)
+BUTCHER(RungeKutta4Tableau, 2, 1, 1.0/2.0)
+BUTCHER(RungeKutta4Tableau, 3, 2, 1.0)
+
+BUTCHER(RungeKutta4Tableau, BUTCHER_B, 0, 1.0/6.0)
+BUTCHER(RungeKutta4Tableau, BUTCHER_B, 1, 1.0/3.0)
+BUTCHER(RungeKutta4Tableau, BUTCHER_B, 2, 1.0/3.0)
+BUTCHER(RungeKutta4Tableau, BUTCHER_B, 3, 1.0/6.0)
 
 RungeKutta4::RungeKutta4()
 {
 	reference	= "";//"http\://en.wikipedia.org/wiki/Runge-kutta#Explicit_Runge.E2.80.93Kutta_methods";
+	// fk[1], fk[2], fk[3] and yTemp
+	nWorkspaceArray	= 4;
 }
 
 int RungeKutta4::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
@@ -53,39 +73,22 @@ int RungeKutta4::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine
 
 int RungeKutta4::Step(BodyData *bodyData, Acceleration *acceleration)
 {
-	static double	a21 = 1.0/2.0;
-	static double	a32 = 1.0/2.0;
-	static double	a43 = 1.0;
-	static double	b1 = 1.0/6.0;
-	static double	b2 = 1.0/3.0;
-	static double	b3 = 1.0/3.0;
-	static double	b4 = 1.0/6.0;
-	static double	c1 = 0.0;
-	static double	c2 = 1.0/2.0;
-	static double	c3 = 1.0/2.0;
-	static double	c4 = 1.0;
-
 	// These arrays will contain the accelerations computed along the trajectory of the current step
 	double	*fk[4] = {0, 0, 0, 0};
 	// Contains the approximation of the solution
 	double	*yTemp = 0;
 	int		nVar = bodyData->nBodies.NOfVar();
 
-	// i=0 changed to i=1
-	for (int i = 1; i < 4; i++) {
-		fk[i] = new double[nVar];
-		if (fk[i] == 0) {
-			Error::_errMsg = "host memory allocation";
-			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
-			return 1;
-		}
-	}
-	yTemp = new double[nVar];
-	if (yTemp == 0) {
-		Error::_errMsg = "host memory allocation";
+	// The workspace is sized by Simulator::BodyListToBodyData(), this call does not allocate
+	if (AllocateWorkspace(nVar) == 1) {
 		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 		return 1;
 	}
+	// i=0 changed to i=1
+	for (int i = 1; i < 4; i++) {
+		fk[i] = Workspace(i - 1);
+	}
+	yTemp = Workspace(3);
 
 	double	h = bodyData->h;
 	double	t = bodyData->time;
@@ -93,34 +96,12 @@ int RungeKutta4::Step(BodyData *bodyData, Acceleration *acceleration)
 	// k1:
 	fk[0] = bodyData->accel;
 
-	// k2:
-	for (int i = 0; i < nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(a21*fk[0][i]);
-	}
-	acceleration->Compute(t + c2*h, yTemp, fk[1]);
-
-	// k3:
-	for (int i = 0; i < nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(a32*fk[1][i]);
-	}
-	acceleration->Compute(t + c3*h, yTemp, fk[2]);
-
-	// k4:
-	for (int i = 0; i < nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(a43*fk[2][i]);
-	}
-	acceleration->Compute(t + c4*h, yTemp, fk[3]);
+	// k2, k3, k4:
+	int result = RungeKuttaEngine<RungeKutta4Tableau>::Stages(acceleration, t, h, nVar, bodyData->y0, fk, yTemp);
+	HANDLE_RESULT(result);
 
 	// The result of the step
-	for (int i = 0; i < nVar; i++) {
-		bodyData->y[i] = bodyData->y0[i] + h*(b1*fk[0][i] + b2*fk[1][i] + b3*fk[2][i] + b4*fk[3][i]);
-	}
-
-	// i=0 changed to i=1
-	for (int i = 1; i < 4; i++) {
-		delete[] fk[i];
-	}
-	delete[] yTemp;
+	RungeKuttaEngine<RungeKutta4Tableau>::Solution(h, nVar, bodyData->y0, fk, bodyData->y);
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+
+#include "RungeKutta56.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Error.h"
+#include "RungeKuttaEngine.h"
+#include "TimeLine.h"
+#include "SolarisMacro.h"
+
+// The Butcher tableau of the method
+struct Verner65 { enum { nStage = 8 }; };
+
+BUTCHER_NODE(Verner65, 1, 1.0/6.0)
+BUTCHER_NODE(Verner65, 2, 4.0/15.0)
+BUTCHER_NODE(Verner65, 3, 2.0/3.0)
+BUTCHER_NODE(Verner65, 4, 5.0/6.0)
+BUTCHER_NODE(Verner65, 5, 1.0)
+BUTCHER_NODE(Verner65, 6, 1.0/15.0)
+BUTCHER_NODE(Verner65, 7, 1.0)
+
+BUTCHER(Verner65, 1, 0, 1.0/6.0)
+BUTCHER(Verner65, 2, 0, 4.0/75.0)
+BUTCHER(Verner65, 2, 1, 16.0/75.0)
+BUTCHER(Verner65, 3, 0, 5.0/6.0)
+BUTCHER(Verner65, 3, 1,-8.0/3.0)
+BUTCHER(Verner65, 3, 2, 5.0/2.0)
+BUTCHER(Verner65, 4, 0,-165.0/64.0)
+BUTCHER(Verner65, 4, 1, 55.0/6.0)
+BUTCHER(Verner65, 4, 2,-425.0/64.0)
+BUTCHER(Verner65, 4, 3, 85.0/96.0)
+BUTCHER(Verner65, 5, 0, 12.0/5.0)
+BUTCHER(Verner65, 5, 1,-8.0)
+BUTCHER(Verner65, 5, 2, 4015.0/612.0)
+BUTCHER(Verner65, 5, 3,-11.0/36.0)
+BUTCHER(Verner65, 5, 4, 88.0/255.0)
+BUTCHER(Verner65, 6, 0,-8263.0/15000.0)
+BUTCHER(Verner65, 6, 1, 124.0/75.0)
+BUTCHER(Verner65, 6, 2,-643.0/680.0)
+BUTCHER(Verner65, 6, 3,-81.0/250.0)
+BUTCHER(Verner65, 6, 4, 2484.0/10625.0)
+BUTCHER(Verner65, 7, 0, 3501.0/1720.0)
+BUTCHER(Verner65, 7, 1,-300.0/43.0)
+BUTCHER(Verner65, 7, 2, 297275.0/52632.0)
+BUTCHER(Verner65, 7, 3,-319.0/2322.0)
+BUTCHER(Verner65, 7, 4, 24068.0/84065.0)
+BUTCHER(Verner65, 7, 6, 3850.0/26703.0)
+
+BUTCHER(Verner65, BUTCHER_B, 0, 3.0/40.0)
+BUTCHER(Verner65, BUTCHER_B, 2, 875.0/2244.0)
+BUTCHER(Verner65, BUTCHER_B, 3, 23.0/72.0)
+BUTCHER(Verner65, BUTCHER_B, 4, 264.0/1955.0)
+BUTCHER(Verner65, BUTCHER_B, 6, 125.0/11592.0)
+BUTCHER(Verner65, BUTCHER_B, 7, 43.0/616.0)
+
+// The difference of the 6th and 5th order solutions
+BUTCHER(Verner65, BUTCHER_E, 0,-1.0/160.0)
+BUTCHER(Verner65, BUTCHER_E, 2,-125.0/17952.0)
+BUTCHER(Verner65, BUTCHER_E, 3, 1.0/144.0)
+BUTCHER(Verner65, BUTCHER_E, 4,-12.0/1955.0)
+BUTCHER(Verner65, BUTCHER_E, 5,-3.0/44.0)
+BUTCHER(Verner65, BUTCHER_E, 6, 125.0/11592.0)
+BUTCHER(Verner65, BUTCHER_E, 7, 43.0/616.0)
+
+RungeKutta56::RungeKutta56()
+{
+	name = "Runge-Kutta 6(5)";
+	reference = "J. H. Verner, Explicit Runge-Kutta methods with estimates of the local truncation error, SIAM J. Numer. Anal., Vol. 15(1978), 772-790.";
+	// fk[1], ..., fk[7] and yTemp
+	nWorkspaceArray = 8;
+	// The step leaves the phases and the derivatives at its start in bodyData->y and bodyData->accel
+	denseOutput = true;
+	_errorMax = 0.0;
+}
+
+// constants for the Runge-Kutta 6(5) integrator, the exponents belong to the 5th order error estimate
+#define SAFETY	 0.9
+#define PGROW	-1.0/6.0
+#define PSHRNK	-0.2
+#define ERRCON	 3.4e-5
+int RungeKutta56::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
+{
+	int	result = 0;
+
+	bodyData->time	= timeLine->time;
+	bodyData->h		= timeLine->hNext;
+
+	acceleration->evaluateGasDrag			= true;
+	acceleration->evaluateTypeIMigration	= true;
+	acceleration->evaluateTypeIIMigration	= true;
+
+	// Calculate the acceleration in the initial point
+	result = acceleration->Compute(timeLine->time, bodyData->y0, bodyData->accel);
+	HANDLE_RESULT(result);
+
+	acceleration->evaluateGasDrag			= false;
+	acceleration->evaluateTypeIMigration	= false;
+	acceleration->evaluateTypeIIMigration	= false;
+
+	double	errorMax = 0.0;
+	while ( 1 ) {
+		if (Step(bodyData, acceleration) == 1) {
+			Error::_errMsg = "An error occurred during Runge-Kutta6(5) step!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			result = 1;
+			break;
+		}
+
+		// The scaled error maximum was computed by the Step() together with the solution
+		errorMax = _errorMax;
+		if (errorMax < 1.0) {
+			timeLine->hDid = bodyData->h;
+			result = 0;
+			break; 		/* step succeeded, exit from the infinite loop */
+		}
+		nRejectedStep++;
+		if (stepControl == STEP_CONTROL_PI) {
+			bodyData->h *= PIStepFactor(errorMax, 6);
+		}
+		else {
+			double hTemp = SAFETY * bodyData->h * pow(errorMax, PSHRNK);
+			bodyData->h = fabs(hTemp) > fabs(0.1*bodyData->h) ? hTemp : 0.1*bodyData->h;
+		}
+
+		double tNew = timeLine->time + bodyData->h;
+		if (fabs(tNew - timeLine->time) < 1.0 / 86400.0 ) /* = 1 sec */
+		{
+			errorMax = 0.99;
+			fprintf(stderr, "Warning: Stepsize-underflow occurred during Runge-Kutta6(5) step!\n");
+			result = 0;
+			break;
+		}
+	} /*  while( 1 ) */
+	if (result == 0) {
+		// Update time
+		timeLine->time += timeLine->hDid;
+		bodyData->time = timeLine->time;
+		// Calculate the next stepsize
+		if (stepControl == STEP_CONTROL_PI) {
+			timeLine->hNext = PIStepFactor(errorMax, 6) * bodyData->h;
+		}
+		else {
+			timeLine->hNext = errorMax > ERRCON ? (SAFETY * bodyData->h * pow(errorMax, PGROW)) : (5.0 * bodyData->h);
+		}
+		bodyData->h = timeLine->hNext;
+		// Update the phases of the system
+		std::swap(bodyData->y0, bodyData->y);
+	}
+
+	return result;
+}
+#undef SAFETY
+#undef PGROW
+#undef PSHRNK
+#undef ERRCON
+
+int RungeKutta56::Step(BodyData *bodyData, Acceleration *acceleration)
+{
+	// These arrays will contain the accelerations computed along the trajectory of the current step
+	double	*fk[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	// Contains the approximation of the solution
+	double	*yTemp = 0;
+	int		nVar = bodyData->nBodies.NOfVar();
+
+	// The workspace is sized by Simulator::BodyListToBodyData(), this call does not allocate
+	int result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	for (int i = 1; i < 8; i++) {
+		fk[i] = Workspace(i - 1);
+	}
+	yTemp = Workspace(7);
+
+	fk[0] = bodyData->accel;
+	double	h = bodyData->h;
+	double	t = bodyData->time;
+
+	result = RungeKuttaEngine<Verner65>::Stages(acceleration, t, h, nVar, bodyData->y0, fk, yTemp);
+	HANDLE_RESULT(result);
+
+	// The result of the step, the scaling, the error estimation and the scaled error maximum
+	// are computed in a single pass
+	RungeKuttaScaledError scale = { bodyData->y0, fk[0], h, bodyData->yscale };
+	_errorMax = RungeKuttaEngine<Verner65>::Solution(h, nVar, bodyData->y0, fk, bodyData->y, bodyData->error, scale) / epsilon;
+
+	// The final pass reads y0 and 8 fk arrays and writes y, error and yscale
+	nStageByte += (RungeKuttaEngine<Verner65>::nStageArray + 9 + 3) * (double)nVar * sizeof(double);
+	nTrialStep++;
+
+	return 0;
+}
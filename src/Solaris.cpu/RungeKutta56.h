@@ -1,16 +1,28 @@
 #ifndef RUNGEKUTTA56_H_
 #define RUNGEKUTTA56_H_
 
+#include <string>
 #include "Integrator.h"
 
+class Acceleration;
+class BodyData;
+class TimeLine;
+
+/**
+ * The 6(5) pair of Verner with eight stages. The step advances the 6th order solution, its size is
+ * controlled by the difference of the 6th and 5th order solutions.
+ */
 class RungeKutta56 : public Integrator
 {
 public:
 	RungeKutta56();
 
-private:
-
+	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
+	int 		Step(  BodyData *bodyData, Acceleration *acceleration);
 
+private:
+	// The scaled error maximum of the last Step()
+	double	_errorMax;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+#ifndef RUNGEKUTTAENGINE_H_
+#define RUNGEKUTTAENGINE_H_
+
+#include <cmath>
+
+#include "Acceleration.h"
+#include "Constants.h"
+#include "Error.h"
+#include "SolarisMacro.h"
+
+// The rows of Butcher<> after the stages: the weights of the solution, the weights of the velocities
+// of the Nystrom form and the weights of the error estimate (the difference of the two solutions)
+#define BUTCHER_B		100
+#define BUTCHER_BDOT	101
+#define BUTCHER_E		102
+
+/**
+ * The coefficients of an explicit Runge-Kutta(-Nystrom) method known at compile time. A method is an
+ * empty tag class with enum { nStage = s }, its nonzero coefficients are declared by specializing
+ * Butcher<> and ButcherNode<> with the BUTCHER() and BUTCHER_NODE() macros. The coefficients which
+ * are not declared are zero, the terms multiplied by them are dropped by the compiler.
+ */
+template<class T, int row, int l> struct Butcher
+{
+	enum { nonzero = 0 };
+	static double Value()	{ return 0.0; }
+};
+
+template<class T, int k> struct ButcherNode
+{
+	static double Value()	{ return 0.0; }
+};
+
+#define BUTCHER(T, row, l, value) \
+	template<> struct Butcher<T, row, l> { enum { nonzero = 1 }; static double Value() { return (value); } };
+
+#define BUTCHER_NODE(T, k, value) \
+	template<> struct ButcherNode<T, k> { static double Value() { return (value); } };
+
+// sum += a*f[i], or nothing if the coefficient is zero
+template<bool nonzero> struct ButcherTerm
+{
+	static void Add(double &sum, double a, const double *f, int i)	{ sum += a*f[i]; }
+};
+
+template<> struct ButcherTerm<false>
+{
+	static void Add(double &, double, const double *, int)			{ }
+};
+
+// sum += c(row, l)*f[l][i] + ... + c(row, n - 1)*f[n - 1][i] in this order, and the number of the nonzero terms
+template<class T, int row, int l, int n> struct ButcherSum
+{
+	enum { nTerm = Butcher<T, row, l>::nonzero + ButcherSum<T, row, l + 1, n>::nTerm };
+
+	static void Add(double &sum, const double * const *f, int i)
+	{
+		ButcherTerm<Butcher<T, row, l>::nonzero != 0>::Add(sum, Butcher<T, row, l>::Value(), f[l], i);
+		ButcherSum<T, row, l + 1, n>::Add(sum, f, i);
+	}
+};
+
+template<class T, int row, int n> struct ButcherSum<T, row, n, n>
+{
+	enum { nTerm = 0 };
+
+	static void Add(double &, const double * const *, int)			{ }
+};
+
+/**
+ * The kth, ..., (s-1)th stages of a step of length h from the phases y0 at time t. The kth stage computes
+ * the intermediate phases yTemp from y0 and f[0], ..., f[k-1] and evaluates f[k] there, f[0] must hold
+ * the derivatives at the initial point. Each stage combination is a single loop over the variables in
+ * which only the nonzero coefficients appear.
+ * RungeKuttaStage integrates the first order form y' = f(t, y) of all variables.
+ * RungeKuttaNystromStage integrates the second order form x'' = a(t, x) of the positions, the velocities
+ * of the stages are combined with the same coefficients since the accelerations do not depend on them.
+ */
+template<class T, int k, int s> struct RungeKuttaStage
+{
+	enum { nArray = 1 + ButcherSum<T, k, 0, k>::nTerm + 1 + RungeKuttaStage<T, k + 1, s>::nArray };
+
+	static int Compute(Acceleration *acceleration, double t, double h, int nVar, const double *y0, double * const *f, double *yTemp)
+	{
+		const double* __restrict y = y0;
+		double* __restrict yt = yTemp;
+		// The stage loops are only distributed among threads if they exceed the last level cache
+		bool parallel = nVar >= Constants::ParallelVarThreshold;
+
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static) if (parallel)
+#endif
+		for (int i = 0; i < nVar; i++) {
+			double sum = 0.0;
+			ButcherSum<T, k, 0, k>::Add(sum, f, i);
+			yt[i] = y[i] + h*sum;
+		}
+		int result = acceleration->Compute(t + ButcherNode<T, k>::Value()*h, yTemp, f[k]);
+		HANDLE_RESULT(result);
+
+		return RungeKuttaStage<T, k + 1, s>::Compute(acceleration, t, h, nVar, y0, f, yTemp);
+	}
+};
+
+template<class T, int s> struct RungeKuttaStage<T, s, s>
+{
+	enum { nArray = 0 };
+
+	static int Compute(Acceleration *, double, double, int, const double *, double * const *, double *)	{ return 0; }
+};
+
+template<class T, int k, int s> struct RungeKuttaNystromStage
+{
+	enum { nArray = 1 + ButcherSum<T, k, 0, k>::nTerm + 1 + RungeKuttaNystromStage<T, k + 1, s>::nArray };
+
+	static int Compute(Acceleration *acceleration, double t, double h, int nBody, const double *y0, double * const *f, double *yTemp)
+	{
+		const double* __restrict y = y0;
+		double* __restrict yt = yTemp;
+		double	h2 = h*h;
+		bool parallel = 6*nBody >= Constants::ParallelVarThreshold;
+
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static) if (parallel)
+#endif
+		for (int i = 0; i < nBody; i++) {
+			int i0 = 6*i;
+			for (int j = 0; j < 3; j++) {
+				int n = i0 + j;
+				double var = 0.0;
+				ButcherSum<T, k, 0, k>::Add(var, f, n + 3);
+				// Compute the new position
+				yt[n]	= y[n] + ButcherNode<T, k>::Value()*h*y[n + 3] + h2*(var);
+				// Compute the new velocity
+				yt[n + 3] = y[n + 3] + h*(var);
+			}
+		}
+		int result = acceleration->Compute(t + ButcherNode<T, k>::Value()*h, yTemp, f[k]);
+		HANDLE_RESULT(result);
+
+		return RungeKuttaNystromStage<T, k + 1, s>::Compute(acceleration, t, h, nBody, y0, f, yTemp);
+	}
+};
+
+template<class T, int s> struct RungeKuttaNystromStage<T, s, s>
+{
+	enum { nArray = 0 };
+
+	static int Compute(Acceleration *, double, double, int, const double *, double * const *, double *)	{ return 0; }
+};
+
+/**
+ * The norm of the step size control of the first order form: the error of the variables relative to
+ * their magnitude and to their change during the step, the scales are stored in yscale.
+ */
+struct RungeKuttaScaledError
+{
+	const double	*y0;
+	const double	*f0;
+	double			h;
+	double			*yscale;
+
+	double operator()(int i, double error) const
+	{
+		// The tiny constant avoids the division by zero
+		yscale[i] = fabs(y0[i]) + fabs(h*f0[i]) + 1.0e-30;
+		return error/yscale[i];
+	}
+};
+
+/**
+ * A step of the method T, the integrators call these after computing f[0] at the initial point. The
+ * variants with an error estimate take a norm with double operator()(int i, double error) const, which
+ * returns the error of the ith variable measured as the step control of the integrator needs it, and
+ * return the maximum of the norm computed in the same pass as the solution.
+ */
+template<class T> struct RungeKuttaEngine
+{
+	// The number of nVar long arrays read or written by the stage combinations of a step
+	enum { nStageArray = RungeKuttaStage<T, 1, T::nStage>::nArray };
+
+	static int Stages(Acceleration *acceleration, double t, double h, int nVar, const double *y0, double * const *f, double *yTemp)
+	{
+		return RungeKuttaStage<T, 1, T::nStage>::Compute(acceleration, t, h, nVar, y0, f, yTemp);
+	}
+
+	// y = y0 + h*sum b_k f_k
+	static void Solution(double h, int nVar, const double *y0, const double * const *f, double *y)
+	{
+		const double* __restrict yStart = y0;
+		double* __restrict yEnd = y;
+		bool parallel = nVar >= Constants::ParallelVarThreshold;
+
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static) if (parallel)
+#endif
+		for (int i = 0; i < nVar; i++) {
+			double sum = 0.0;
+			ButcherSum<T, BUTCHER_B, 0, T::nStage>::Add(sum, f, i);
+			yEnd[i] = yStart[i] + h*sum;
+		}
+	}
+
+	// y = y0 + h*sum b_k f_k and error = |h*sum e_k f_k|
+	template<class Norm>
+	static double Solution(double h, int nVar, const double *y0, const double * const *f, double *y, double *error, const Norm &norm)
+	{
+		const double* __restrict yStart = y0;
+		double* __restrict yEnd = y;
+		double* __restrict yErr = error;
+		bool parallel = nVar >= Constants::ParallelVarThreshold;
+		double errMax = 0.0;
+
+#ifdef _OPENMP
+		#pragma omp parallel if (parallel)
+#endif
+		{
+			double errMaxLocal = 0.0;
+#ifdef _OPENMP
+			#pragma omp for schedule(static)
+#endif
+			for (int i = 0; i < nVar; i++) {
+				double sum = 0.0;
+				double err = 0.0;
+				ButcherSum<T, BUTCHER_B, 0, T::nStage>::Add(sum, f, i);
+				ButcherSum<T, BUTCHER_E, 0, T::nStage>::Add(err, f, i);
+				yEnd[i] = yStart[i] + h*sum;
+				yErr[i] = fabs(h*err);
+				err = norm(i, yErr[i]);
+				errMaxLocal = err > errMaxLocal ? err : errMaxLocal;
+			}
+#ifdef _OPENMP
+			#pragma omp critical
+#endif
+			{
+				if (errMaxLocal > errMax)
+					errMax = errMaxLocal;
+			}
+		}
+		return errMax;
+	}
+
+	static int StagesNystrom(Acceleration *acceleration, double t, double h, int nBody, const double *y0, double * const *f, double *yTemp)
+	{
+		return RungeKuttaNystromStage<T, 1, T::nStage>::Compute(acceleration, t, h, nBody, y0, f, yTemp);
+	}
+
+	// x = x0 + h*v0 + h^2*sum b_k a_k, v = v0 + h*sum bdot_k a_k and the error of the positions
+	// |h^2*sum e_k a_k|, the error of the velocities is set to zero
+	template<class Norm>
+	static double SolutionNystrom(double h, int nBody, const double *y0, const double * const *f, double *y, double *error, const Norm &norm)
+	{
+		const double* __restrict yStart = y0;
+		double* __restrict yEnd = y;
+		double* __restrict yErr = error;
+		double	h2 = h*h;
+		bool parallel = 6*nBody >= Constants::ParallelVarThreshold;
+		double errMax = 0.0;
+
+#ifdef _OPENMP
+		#pragma omp parallel if (parallel)
+#endif
+		{
+			double errMaxLocal = 0.0;
+#ifdef _OPENMP
+			#pragma omp for schedule(static)
+#endif
+			for (int i = 0; i < nBody; i++) {
+				int i0 = 6*i;
+				for (int j = 0; j < 3; j++) {
+					int n = i0 + j;
+					double sum_b = 0.0;
+					double sum_bdot = 0.0;
+					double err = 0.0;
+					ButcherSum<T, BUTCHER_B, 0, T::nStage>::Add(sum_b, f, n + 3);
+					ButcherSum<T, BUTCHER_BDOT, 0, T::nStage>::Add(sum_bdot, f, n + 3);
+					ButcherSum<T, BUTCHER_E, 0, T::nStage>::Add(err, f, n + 3);
+					yEnd[n]		= yStart[n] + h*yStart[n + 3] + h2*(sum_b);
+					yEnd[n + 3]	= yStart[n + 3] + h*(sum_bdot);
+					yErr[n]		= h2*fabs(err);
+					yErr[n + 3]	= 0.0;
+					err = norm(n, yErr[n]);
+					errMaxLocal = err > errMaxLocal ? err : errMaxLocal;
+				}
+			}
+#ifdef _OPENMP
+			#pragma omp critical
+#endif
+			{
+				if (errMaxLocal > errMax)
+					errMax = errMaxLocal;
+			}
+		}
+		return errMax;
+	}
+};
+
+#endif
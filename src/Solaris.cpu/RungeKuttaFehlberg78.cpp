@@ -13,33 +13,108 @@
 #include "Acceleration.h"
 #include "BinaryFileAdapter.h"
 #include "BodyData.h"
+#include "Constants.h"
 #include "Error.h"
 #include "Output.h"
+#include "RungeKuttaEngine.h"
 #include "TimeLine.h"
 #include "SolarisMacro.h"
 #include "StopWatch.h"
 
+// The Butcher tableau of the method, the step advances the 7th order solution
+struct Fehlberg78 { enum { nStage = 13 }; };
+
+BUTCHER_NODE(Fehlberg78, 1, 2.0/27.0)
+BUTCHER_NODE(Fehlberg78, 2, 1.0/9.0)
+BUTCHER_NODE(Fehlberg78, 3, 1.0/6.0)
+BUTCHER_NODE(Fehlberg78, 4, 5.0/12.0)
+BUTCHER_NODE(Fehlberg78, 5, 1.0/2.0)
+BUTCHER_NODE(Fehlberg78, 6, 5.0/6.0)
+BUTCHER_NODE(Fehlberg78, 7, 1.0/6.0)
+BUTCHER_NODE(Fehlberg78, 8, 2.0/3.0)
+BUTCHER_NODE(Fehlberg78, 9, 1.0/3.0)
+BUTCHER_NODE(Fehlberg78,10, 1.0)
+BUTCHER_NODE(Fehlberg78,12, 1.0)
+
+BUTCHER(Fehlberg78, 1, 0, 2.0/27.0)
+BUTCHER(Fehlberg78, 2, 0, 1.0/36.0)
+BUTCHER(Fehlberg78, 2, 1, 1.0/12.0)
+BUTCHER(Fehlberg78, 3, 0, 1.0/24.0)
+BUTCHER(Fehlberg78, 3, 2, 1.0/8.0)
+BUTCHER(Fehlberg78, 4, 0, 5.0/12.0)
+BUTCHER(Fehlberg78, 4, 2,-25.0/16.0)
+BUTCHER(Fehlberg78, 4, 3, 25.0/16.0)
+BUTCHER(Fehlberg78, 5, 0, 1.0/20.0)
+BUTCHER(Fehlberg78, 5, 3, 1.0/4.0)
+BUTCHER(Fehlberg78, 5, 4, 1.0/5.0)
+BUTCHER(Fehlberg78, 6, 0,-25.0/108.0)
+BUTCHER(Fehlberg78, 6, 3, 125.0/108.0)
+BUTCHER(Fehlberg78, 6, 4,-65.0/27.0)
+BUTCHER(Fehlberg78, 6, 5, 125.0/54.0)
+BUTCHER(Fehlberg78, 7, 0, 31.0/300.0)
+BUTCHER(Fehlberg78, 7, 4, 61.0/225.0)
+BUTCHER(Fehlberg78, 7, 5,-2.0/9.0)
+BUTCHER(Fehlberg78, 7, 6, 13.0/900.0)
+BUTCHER(Fehlberg78, 8, 0, 2.0)
+BUTCHER(Fehlberg78, 8, 3,-53.0/6.0)
+BUTCHER(Fehlberg78, 8, 4, 704.0/45.0)
+BUTCHER(Fehlberg78, 8, 5,-107.0/9.0)
+BUTCHER(Fehlberg78, 8, 6, 67.0/90.0)
+BUTCHER(Fehlberg78, 8, 7, 3.0)
+BUTCHER(Fehlberg78, 9, 0,-91.0/108.0)
+BUTCHER(Fehlberg78, 9, 3, 23.0/108.0)
+BUTCHER(Fehlberg78, 9, 4,-976.0/135.0)
+BUTCHER(Fehlberg78, 9, 5, 311.0/54.0)
+BUTCHER(Fehlberg78, 9, 6,-19.0/60.0)
+BUTCHER(Fehlberg78, 9, 7, 17.0/6.0)
+BUTCHER(Fehlberg78, 9, 8,-1.0/12.0)
+BUTCHER(Fehlberg78,10, 0, 2383.0/4100.0)
+BUTCHER(Fehlberg78,10, 3,-341.0/164.0)
+BUTCHER(Fehlberg78,10, 4, 4496.0/1025.0)
+BUTCHER(Fehlberg78,10, 5,-301.0/82.0)
+BUTCHER(Fehlberg78,10, 6, 2133.0/4100.0)
+BUTCHER(Fehlberg78,10, 7, 45.0/82.0)
+BUTCHER(Fehlberg78,10, 8, 45.0/164.0)
+BUTCHER(Fehlberg78,10, 9, 18.0/41.0)
+BUTCHER(Fehlberg78,11, 0, 3.0/205.0)
+BUTCHER(Fehlberg78,11, 5,-6.0/41.0)
+BUTCHER(Fehlberg78,11, 6,-3.0/205.0)
+BUTCHER(Fehlberg78,11, 7,-3.0/41.0)
+BUTCHER(Fehlberg78,11, 8, 3.0/41.0)
+BUTCHER(Fehlberg78,11, 9, 6.0/41.0)
+BUTCHER(Fehlberg78,12, 0,-1777.0/4100.0)
+BUTCHER(Fehlberg78,12, 3,-341.0/164.0)
+BUTCHER(Fehlberg78,12, 4, 4496.0/1025.0)
+BUTCHER(Fehlberg78,12, 5,-289.0/82.0)
+BUTCHER(Fehlberg78,12, 6, 2193.0/4100.0)
+BUTCHER(Fehlberg78,12, 7, 51.0/82.0)
+BUTCHER(Fehlberg78,12, 8, 33.0/164.0)
+BUTCHER(Fehlberg78,12, 9, 12.0/41.0)
+BUTCHER(Fehlberg78,12,11, 1.0)
+
+BUTCHER(Fehlberg78, BUTCHER_B, 0, 41.0/840.0)
+BUTCHER(Fehlberg78, BUTCHER_B, 5, 34.0/105.0)
+BUTCHER(Fehlberg78, BUTCHER_B, 6, 9.0/35.0)
+BUTCHER(Fehlberg78, BUTCHER_B, 7, 9.0/35.0)
+BUTCHER(Fehlberg78, BUTCHER_B, 8, 9.0/280.0)
+BUTCHER(Fehlberg78, BUTCHER_B, 9, 9.0/280.0)
+BUTCHER(Fehlberg78, BUTCHER_B,10, 41.0/840.0)
+
+// The difference of the 7th and 8th order solutions
+BUTCHER(Fehlberg78, BUTCHER_E, 0, 41.0/840.0)
+BUTCHER(Fehlberg78, BUTCHER_E,10, 41.0/840.0)
+BUTCHER(Fehlberg78, BUTCHER_E,11,-41.0/840.0)
+BUTCHER(Fehlberg78, BUTCHER_E,12,-41.0/840.0)
+
 RungeKuttaFehlberg78::RungeKuttaFehlberg78()
 {
 	name = "Runge-Kutta 7(8)";
 	reference = "NASA Technical Reports R-287, by Erwin Fehlberg, 1968.";
-
-	D1_0 = 41.0/840.0, D1_1 = 0.0, D1_2 = 0.0, D1_3 = 0.0, D1_4 = 0.0, D1_5 = 34.0/105.0;
-	D1_6 = 9.0/35.0, D1_7 = 9.0/35.0, D1_8 = 9.0/280.0, D1_9 = 9.0/280.0, D1_10 = 41.0/840.0;
-	D1_11 = 0.0, D1_12 = 0.0;
-	D_1_0 = 2.0/27.0, D_2_0 = 1.0/36.0, D_3_0 = 1.0/24.0, D_4_0 = 5.0/12.0;
-	D_5_0 = 1.0/20.0, D_6_0 = -25.0/108.0, D_7_0 = 31.0/300.0, D_8_0 = 2.0;
-	D_9_0 = -91.0/108.0, D_10_0 = 2383.0/4100.0, D_11_0 = 3.0/205.0, D_12_0 = -1777.0/4100.0;
-	D_2_1 = 1.0/12.0;
-	D_3_2 = 1.0/8.0, D_4_2 = -25.0/16.0;
-	D_4_3 = 25.0/16.0, D_5_3 = 1.0/4.0, D_6_3 = 125.0/108.0, D_8_3 = -53.0/6.0, D_9_3 = 23.0/108.0, D_10_3 = -341.0/164.0, D_12_3 = -341.0/164.0;
-	D_5_4 = 1.0/5.0, D_6_4 = -65.0/27.0, D_7_4 = 61.0/225.0, D_8_4 = 704.0/45.0, D_9_4 = -976.0/135.0, D_10_4 = 4496.0/1025.0, D_12_4 = 4496.0/1025.0;
-	D_6_5 = 125.0/54.0, D_7_5 = -2.0/9.0, D_8_5 = -107.0/9.0, D_9_5 = 311.0/54.0, D_10_5 = -301.0/82.0, D_11_5 = -6.0/41.0, D_12_5 = -289.0/82.0;
-	D_7_6 = 13.0/900.0, D_8_6 = 67.0/90.0, D_9_6 = -19.0/60.0, D_10_6 = 2133.0/4100.0, D_11_6 = -3.0/205.0, D_12_6 = 2193.0/4100.0;
-	D_8_7 = 3.0, D_9_7 = 17.0/6.0, D_10_7 = 45.0/82.0, D_11_7 = -3.0/41.0, D_12_7 = 51.0/82.0;
-	D_9_8 = -1.0/12.0, D_10_8 = 45.0/164.0, D_11_8 = 3.0/41.0, D_12_8 = 33.0/164.0;
-	D_10_9 = 18.0/41.0, D_11_9 = 6.0/41.0, D_12_9 = 12.0/41.0;
-	D_12_11 = 1.0;
+	// fk[1], ..., fk[12] and yTemp
+	nWorkspaceArray = 13;
+	// The step leaves the phases and the derivatives at its start in bodyData->y and bodyData->accel
+	denseOutput = true;
+	_errorMax = 0.0;
 }
 
 // constants for the Runge-Kutta-Fehlberg7(8) integrator
@@ -47,15 +122,12 @@ RungeKuttaFehlberg78::RungeKuttaFehlberg78()
 #define PGROW	-0.2
 #define PSHRNK	-0.25
 #define ERRCON	 1.89e-4
-// For the scaling used to monitor accuracy
-#define TINY	1.0e-30
 int RungeKuttaFehlberg78::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
 {
 #ifdef _DEBUG
 //	fprintf(stderr, "File: %40s, Function: %40s, Line: %10d\n", __FILE__, __FUNCTION__, __LINE__);
 #endif
 	int	result = 0;
-	int	nVar = bodyData->nBodies.NOfVar();
 
 	bodyData->time	= timeLine->time;
 	bodyData->h		= timeLine->hNext;
@@ -79,10 +151,6 @@ int RungeKuttaFehlberg78::Driver(BodyData *bodyData, Acceleration *acceleration,
 
 	double	errorMax = 0.0;
 	while ( 1 ) {
-		for (int i=0; i<nVar; i++) {
-			bodyData->yscale[i] = fabs(bodyData->y0[i]) + fabs(bodyData->h * bodyData->accel[i]) + TINY;
-		}
-
 	//	StopWatch timer;
 	//	timer.start();
 		if (Step(bodyData, acceleration) == 1) {
@@ -103,14 +171,21 @@ int RungeKuttaFehlberg78::Driver(BodyData *bodyData, Acceleration *acceleration,
 	//	binary.SaveElapsedTimes(timeLine->time, timer, output.outputType);
 	//	binary.SaveElapsedTimes(timeLine->time, stimer, output.outputType);
 
-		errorMax = GetErrorMax(nVar, bodyData->error, bodyData->yscale);
+		// The scaled error maximum was computed by the Step() together with the solution
+		errorMax = _errorMax;
 		if (errorMax < 1.0) {
 			timeLine->hDid = bodyData->h;
 			result = 0;
 			break; 		/* step succeeded, exit from the infinite loop */
 		}
-		double hTemp = SAFETY * bodyData->h * pow(errorMax, PSHRNK);
-		bodyData->h = fabs(hTemp) > fabs(0.1*bodyData->h) ? hTemp : 0.1*bodyData->h;
+		nRejectedStep++;
+		if (stepControl == STEP_CONTROL_PI) {
+			bodyData->h *= PIStepFactor(errorMax, 8);
+		}
+		else {
+			double hTemp = SAFETY * bodyData->h * pow(errorMax, PSHRNK);
+			bodyData->h = fabs(hTemp) > fabs(0.1*bodyData->h) ? hTemp : 0.1*bodyData->h;
+		}
 
 		double tNew = timeLine->time + bodyData->h;
 		//if (tNew == timeLine->time)
@@ -129,7 +204,12 @@ int RungeKuttaFehlberg78::Driver(BodyData *bodyData, Acceleration *acceleration,
 		timeLine->time += timeLine->hDid;
 		bodyData->time = timeLine->time;
 		// Calculate the next stepsize
-		timeLine->hNext = errorMax > ERRCON ? (SAFETY * bodyData->h * pow(errorMax, PGROW)) : (5.0 * bodyData->h);
+		if (stepControl == STEP_CONTROL_PI) {
+			timeLine->hNext = PIStepFactor(errorMax, 8) * bodyData->h;
+		}
+		else {
+			timeLine->hNext = errorMax > ERRCON ? (SAFETY * bodyData->h * pow(errorMax, PGROW)) : (5.0 * bodyData->h);
+		}
 		bodyData->h = timeLine->hNext;
 		// Update the phases of the system
 		std::swap(bodyData->y0, bodyData->y);
@@ -146,7 +226,6 @@ int RungeKuttaFehlberg78::Driver(BodyData *bodyData, Acceleration *acceleration,
 #undef PGROW
 #undef PSHRNK
 #undef ERRCON
-#undef TINY
 
 int RungeKuttaFehlberg78::Step(BodyData *bodyData, Acceleration *acceleration)
 {
@@ -156,267 +235,34 @@ int RungeKuttaFehlberg78::Step(BodyData *bodyData, Acceleration *acceleration)
 	double	*yTemp = 0;
 	int		nVar = bodyData->nBodies.NOfVar();
 
+	// The workspace is sized by Simulator::BodyListToBodyData(), this call does not allocate
+	int result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
 	// i=0 changed to i=1
 	for (int i=1; i<13; i++) {
-		fk[i] = new double[nVar];
-		HANDLE_NULL(fk[i]);
+		fk[i] = Workspace(i - 1);
 	}
-	yTemp = new double[nVar];
-	HANDLE_NULL(yTemp);
+	yTemp = Workspace(12);
 
-	// Copy the initial acceleration into fk[0]
-	// NOTE: this copy can be avoided if a is used instead of fk[0], than we do not need to allocate/free fk[0]
-	//memcpy(fk[0], accel, nVar*sizeof(double));
 	fk[0] = bodyData->accel;
 	double	h = bodyData->h;
 	double	t = bodyData->time;
-//1. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_1_0*fk[0][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[1]);
-//2. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_2_0*fk[0][i] + D_2_1*fk[1][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[2]);
-//3. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_3_0*fk[0][i] + D_3_2*fk[2][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[3]);
-//4. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_4_0*fk[0][i] + D_4_2*fk[2][i] + D_4_3*fk[3][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[4]);
-//5. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_5_0*fk[0][i] + D_5_3*fk[3][i] + D_5_4*fk[4][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[5]);
-//6. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_6_0*fk[0][i] + D_6_3*fk[3][i] + D_6_4*fk[4][i] + D_6_5*fk[5][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[6]);
-//7. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_7_0*fk[0][i] + D_7_4*fk[4][i] + D_7_5*fk[5][i] + D_7_6*fk[6][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[7]);
-//8. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_8_0*fk[0][i] + D_8_3*fk[3][i] + D_8_4*fk[4][i] +
-						  D_8_5*fk[5][i] + D_8_6*fk[6][i] + D_8_7*fk[7][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[8]);
-//9. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_9_0*fk[0][i] + D_9_3*fk[3][i] + D_9_4*fk[4][i] +
-						  D_9_5*fk[5][i] + D_9_6*fk[6][i] + D_9_7*fk[7][i] + D_9_8*fk[8][i]);
-	}
 
-	acceleration->Compute(t, yTemp, fk[9]);
-//10. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_10_0*fk[0][i] + D_10_3*fk[3][i] + D_10_4*fk[4][i] + D_10_5*fk[5][i] +
-						  D_10_6*fk[6][i] + D_10_7*fk[7][i] + D_10_8*fk[8][i] + D_10_9*fk[9][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[10]);
-//11. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_11_0*fk[0][i] + D_11_5*fk[5][i] + D_11_6*fk[6][i] +
-						  D_11_7*fk[7][i] + D_11_8*fk[8][i] + D_11_9*fk[9][i]);
-	}
+	result = RungeKuttaEngine<Fehlberg78>::Stages(acceleration, t, h, nVar, bodyData->y0, fk, yTemp);
+	HANDLE_RESULT(result);
 
-	acceleration->Compute(t, yTemp, fk[11]);
-//12. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_12_0*fk[0][i] + D_12_3*fk[3][i] + D_12_4*fk[4][i] + D_12_5*fk[5][i] +
-						  D_12_6*fk[6][i] + D_12_7*fk[7][i] + D_12_8*fk[8][i] + D_12_9*fk[9][i] +
-						  D_12_11*fk[11][i]);
-	}
-
-	acceleration->Compute(t, yTemp, fk[12]);
-	// The result of the step
-	for (int i=0; i<nVar; i++) {
-		bodyData->y[i] = bodyData->y0[i] + h*(D1_0*fk[0][i] + D1_5*fk[5][i] + D1_6*(fk[6][i] + fk[7][i]) +
-							D1_8*(fk[8][i] + fk[9][i]) + D1_10*fk[10][i]);
-	}
-
-	// Error estimation
-	double s = 41.0/840.0 * fabs(h);
-	for (int i=0; i<nVar; i++) {
-		bodyData->error[i] = s * fabs(fk[0][i] + fk[10][i] - fk[11][i] - fk[12][i]);
-	}
+	// The result of the step, the scaling, the error estimation and the scaled error maximum
+	// are computed in a single pass
+	RungeKuttaScaledError scale = { bodyData->y0, fk[0], h, bodyData->yscale };
+	_errorMax = RungeKuttaEngine<Fehlberg78>::Solution(h, nVar, bodyData->y0, fk, bodyData->y, bodyData->error, scale) / epsilon;
 
-	// i=0 changed to i=1
-	for (int i=1; i<13; i++) {
-		delete[] fk[i];
-	}
-	delete[] yTemp;
+	// The final pass reads y0 and 9 fk arrays and writes y, error and yscale
+	nStageByte += (RungeKuttaEngine<Fehlberg78>::nStageArray + 10 + 3) * (double)nVar * sizeof(double);
+	nTrialStep++;
 
 	return 0;
 }
 
-/*
-int RungeKuttaFehlberg78::Step(BodyData *bodyData, Acceleration *acceleration, StopWatch *stimer)
-{
-	// These arrays will contain the accelerations computed along the trajectory of the current step
-	double	*fk[13] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-	// Contains the approximation of the solution
-	double	*yTemp = 0;
-	int		nVar = bodyData->nBodies.NOfVar();
-
-	// i=0 changed to i=1
-	for (int i=1; i<13; i++) {
-		fk[i] = new double[nVar];
-		HANDLE_NULL(fk[i]);
-	}
-	yTemp = new double[nVar];
-	HANDLE_NULL(yTemp);
-
-	// Copy the initial acceleration into fk[0]
-	// NOTE: this copy can be avoided if a is used instead of fk[0], than we do not need to allocate/free fk[0]
-	//memcpy(fk[0], accel, nVar*sizeof(double));
-	fk[0] = bodyData->accel;
-	double	h = bodyData->h;
-	double	t = bodyData->time;
-//1. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_1_0*fk[0][i]);
-	}
-
-	stimer[1].start();
-	acceleration->Compute(t, yTemp, fk[1]);
-	stimer[1].stop();
-//2. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_2_0*fk[0][i] + D_2_1*fk[1][i]);
-	}
-
-	stimer[2].start();
-	acceleration->Compute(t, yTemp, fk[2]);
-	stimer[2].stop();
-//3. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_3_0*fk[0][i] + D_3_2*fk[2][i]);
-	}
-
-	stimer[3].start();
-	acceleration->Compute(t, yTemp, fk[3]);
-	stimer[3].stop();
-//4. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_4_0*fk[0][i] + D_4_2*fk[2][i] + D_4_3*fk[3][i]);
-	}
-
-	stimer[4].start();
-	acceleration->Compute(t, yTemp, fk[4]);
-	stimer[4].stop();
-//5. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_5_0*fk[0][i] + D_5_3*fk[3][i] + D_5_4*fk[4][i]);
-	}
-
-	stimer[5].start();
-	acceleration->Compute(t, yTemp, fk[5]);
-	stimer[5].stop();
-//6. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_6_0*fk[0][i] + D_6_3*fk[3][i] + D_6_4*fk[4][i] + D_6_5*fk[5][i]);
-	}
-
-	stimer[6].start();
-	acceleration->Compute(t, yTemp, fk[6]);
-	stimer[6].stop();
-//7. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_7_0*fk[0][i] + D_7_4*fk[4][i] + D_7_5*fk[5][i] + D_7_6*fk[6][i]);
-	}
-
-	stimer[7].start();
-	acceleration->Compute(t, yTemp, fk[7]);
-	stimer[7].stop();
-//8. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_8_0*fk[0][i] + D_8_3*fk[3][i] + D_8_4*fk[4][i] +
-						  D_8_5*fk[5][i] + D_8_6*fk[6][i] + D_8_7*fk[7][i]);
-	}
-
-	stimer[8].start();
-	acceleration->Compute(t, yTemp, fk[8]);
-	stimer[8].stop();
-//9. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_9_0*fk[0][i] + D_9_3*fk[3][i] + D_9_4*fk[4][i] +
-						  D_9_5*fk[5][i] + D_9_6*fk[6][i] + D_9_7*fk[7][i] + D_9_8*fk[8][i]);
-	}
-
-	stimer[9].start();
-	acceleration->Compute(t, yTemp, fk[9]);
-	stimer[9].stop();
-//10. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_10_0*fk[0][i] + D_10_3*fk[3][i] + D_10_4*fk[4][i] + D_10_5*fk[5][i] +
-						  D_10_6*fk[6][i] + D_10_7*fk[7][i] + D_10_8*fk[8][i] + D_10_9*fk[9][i]);
-	}
-
-	stimer[10].start();
-	acceleration->Compute(t, yTemp, fk[10]);
-	stimer[10].stop();
-//11. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_11_0*fk[0][i] + D_11_5*fk[5][i] + D_11_6*fk[6][i] +
-						  D_11_7*fk[7][i] + D_11_8*fk[8][i] + D_11_9*fk[9][i]);
-	}
-
-	stimer[11].start();
-	acceleration->Compute(t, yTemp, fk[11]);
-	stimer[11].stop();
-//12. substep
-	for (int i=0; i<nVar; i++) {
-		yTemp[i] = bodyData->y0[i] + h*(D_12_0*fk[0][i] + D_12_3*fk[3][i] + D_12_4*fk[4][i] + D_12_5*fk[5][i] +
-						  D_12_6*fk[6][i] + D_12_7*fk[7][i] + D_12_8*fk[8][i] + D_12_9*fk[9][i] +
-						  D_12_11*fk[11][i]);
-	}
-
-	stimer[12].start();
-	acceleration->Compute(t, yTemp, fk[12]);
-	stimer[12].stop();
-	// The result of the step
-	for (int i=0; i<nVar; i++) {
-		bodyData->y[i] = bodyData->y0[i] + h*(D1_0*fk[0][i] + D1_5*fk[5][i] + D1_6*(fk[6][i] + fk[7][i]) +
-							D1_8*(fk[8][i] + fk[9][i]) + D1_10*fk[10][i]);
-	}
-
-	// Error estimation
-	double s = 41.0/840.0 * fabs(h);
-	for (int i=0; i<nVar; i++) {
-		bodyData->error[i] = s * fabs(fk[0][i] + fk[10][i] - fk[11][i] - fk[12][i]);
-	}
-
-	// i=0 changed to i=1
-	for (int i=1; i<13; i++) {
-		delete[] fk[i];
-	}
-	delete[] yTemp;
-
-	return 0;
-}
-*/
-
-
 double RungeKuttaFehlberg78::GetErrorMax(const int n, const double *yerr, const double *yscale)
 {
 	double errorMax = 0.0;
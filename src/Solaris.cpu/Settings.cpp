@@ -6,6 +6,14 @@
 Settings::Settings() :
 	frame_center(FRAME_CENTER_ASTRO),
 	enableDistinctStartTimes(false),
+	threadCount(0),
+	gravityKernel(GRAVITY_KERNEL_AUTO),
+	symmetricGravity(false),
+	treeGravity(false),
+	openingAngle(0.5),
+	mixedPrecision(false),
+	restrictedProblem(false),
+	checkpointInterval(60.0),
 	integrator(0),
 	intgr_type(INTEGRATOR_TYPE_UNDEFINED),
 	timeLine(0),
@@ -15,6 +15,21 @@ public:
 
 	bool				enableDistinctStartTimes;
 	frame_center_t		frame_center;
+	// The number of threads used to compute the accelerations, 0 means the OpenMP default
+	int					threadCount;
+	gravity_kernel_t	gravityKernel;
+	// If true, Newton's third law is exploited: each pair of massive bodies is computed once
+	bool				symmetricGravity;
+	// If true, the Barnes-Hut tree is used for the bodies lighter than the giant planets
+	bool				treeGravity;
+	double				openingAngle;
+	// If true, the perturbations of the test particles are computed in single precision
+	bool				mixedPrecision;
+	// If true, the test particles are integrated in chunks with their own step size against the
+	// trajectory of the other bodies computed first
+	bool				restrictedProblem;
+	// The wall clock time between two checkpoints of the main integration in minutes, 0 means no periodic checkpoint
+	double				checkpointInterval;
 	Integrator			*integrator;
 	integrator_type_t	intgr_type;
 
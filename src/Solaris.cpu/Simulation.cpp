@@ -140,7 +140,7 @@ int Simulation::SetPhasesRadiiDensity()
 	}
 
 	for (std::list<BodyGroup>::iterator bgIt = this->bodyGroupList.items.begin(); bgIt != this->bodyGroupList.items.end(); bgIt++) {
-		for (std::list<Body>::iterator bIt = bgIt->items.begin(); bIt != bgIt->items.end(); bIt++) {
+		for (std::vector<Body>::iterator bIt = bgIt->items.begin(); bIt != bgIt->items.end(); bIt++) {
 
 			body_type_t type = bIt->type;
 			if (type != BODY_TYPE_STAR && bIt->phase == 0) {
@@ -153,7 +153,7 @@ int Simulation::SetPhasesRadiiDensity()
 					Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 					return 1;
 				}
-				bIt->phase = new Phase(phase);
+				bIt->phase = Body::phasePool.New(phase);
 			}
 
 			if (type == BODY_TYPE_SUPERPLANETESIMAL || type == BODY_TYPE_TESTPARTICLE ) {
@@ -245,12 +245,29 @@ int Simulation::CheckStartTimes()
 /// Returns the body with the specified id.
 Body* Simulation::FindBy(int id)
 {
-	for (std::list<Body *>::iterator it = bodyList.begin(); it != bodyList.end(); it++) {
-		if ((*it)->GetId() == id) {
-			return *it;
-		}
+	std::unordered_map<int, std::list<Body *>::iterator>::iterator it = _bodyListIndex.find(id);
+	if (it == _bodyListIndex.end()) {
+		return 0;
+	}
+	return *(it->second);
+}
+
+/// Inserts the bodies into the bodyList before position and registers them for FindBy().
+void Simulation::InsertBodies(std::list<Body *>::iterator position, std::list<Body *> &bodies)
+{
+	for (std::list<Body *>::iterator it = bodies.begin(); it != bodies.end(); it++) {
+		_bodyListIndex[(*it)->GetId()] = bodyList.insert(position, *it);
+	}
+}
+
+/// Removes the body with the specified id from the bodyList, the Body itself is kept by its BodyGroup.
+void Simulation::RemoveBody(int bodyId)
+{
+	std::unordered_map<int, std::list<Body *>::iterator>::iterator it = _bodyListIndex.find(bodyId);
+	if (it != _bodyListIndex.end()) {
+		bodyList.erase(it->second);
+		_bodyListIndex.erase(it);
 	}
-	return 0;
 }
 
 /// Returns the body with CentralBody type.
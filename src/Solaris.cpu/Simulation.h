@@ -1,7 +1,10 @@
 #ifndef SIMULATION_H_
 #define SIMULATION_H_
 
+#include <list>
 #include <string>
+#include <unordered_map>
+
 #include "BodyData.h"
 #include "BodyGroupList.h"
 #include "Settings.h"
@@ -32,6 +35,9 @@ public:
 	Body* FindBy(int bodyId);
 	Body* FindCentralBody();
 
+	void InsertBodies(std::list<Body *>::iterator position, std::list<Body *> &bodies);
+	void RemoveBody(int bodyId);
+
 	BodyGroupList		bodyGroupList;
 	std::list<Body *>	bodyList;
 	BodyData			bodyData;
@@ -45,6 +51,10 @@ public:
 	std::string			description;
 	std::string			referenceFrame;
     std::string         runType;
+
+private:
+	// The position of the bodies in the bodyList by their id, maintained by InsertBodies() and RemoveBody()
+	std::unordered_map<int, std::list<Body *>::iterator>	_bodyListIndex;
 };
 
 #endif
@@ -1,20 +1,32 @@
+#include <algorithm>
+#include <csignal>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <sstream>
+#include <unordered_map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "Acceleration.h"
 #include "BinaryFileAdapter.h"
+#include "BlockHermite.h"
 #include "Body.h"
 #include "BodyGroupList.h"
+#include "BulirschStoer.h"
 #include "Calculate.h"
+#include "Checkpoint.h"
 #include "Constants.h"
 #include "Counter.h"
 #include "DormandPrince.h"
 #include "Error.h"
 #include "EventCondition.h"
+#include "GaussRadau15.h"
+#include "HybridSymplectic.h"
 #include "Integrator.h"
 #include "RungeKutta4.h"
+#include "RungeKutta56.h"
 #include "RungeKuttaFehlberg78.h"
 #include "Settings.h"
 #include "Simulation.h"
@@ -24,6 +36,8 @@
 #include "StopWatch.h"
 #include "TimeLine.h"
 #include "Tools.h"
+#include "TwoBodyAffair.h"
+#include "WisdomHolman.h"
 
 
  /**
@@ -35,6 +49,14 @@ enum StepSums {
 	LAST_NSTEP		/**< the sum of the last NSTEP steps, only for debugging purposes */
 };
 
+// Set by SIGTERM or SIGINT during the main integration, which then stops after writing a checkpoint
+static volatile sig_atomic_t terminateRequested = 0;
+
+static void RequestTermination(int)
+{
+	terminateRequested = 1;
+}
+
 Simulator::Simulator(Simulation *simulation)
 {
 	_simulation			= simulation;
@@ -46,23 +68,60 @@ Simulator::Simulator(Simulation *simulation)
 	rungeKutta4			= 0;
 	dormandPrince		= 0;
 
+	_othersAcceleration	= 0;
+	_nChunk				= 0;
+	_nChunkStep			= 0.0;
+	_nChunkRejectedStep	= 0.0;
+
+	_resumed			= false;
+	_terminated			= false;
+	_checkpointTime		= (time_t)0;
+
 	integratorType		= simulation->settings.intgr_type;
 
 	detectcollision = false;
 
 }
 
+/**
+ * Continues the main integration of an interrupted run from the checkpoint in the output directory. The
+ * output files are cut back to their state at the checkpoint, so that they become identical to those of
+ * an uninterrupted run.
+ */
 int Simulator::Continue()
 {
+	if (SetUp() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	_simulation->binary->Log("The main-integration phase of the simulation continues from the checkpoint", false);
+	_startTime = time(0);
+	if (LoadCheckpoint(_simulation->settings.timeLine) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	_resumed = true;
+	if (MainIntegration() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	_simulation->binary->LogTimeSpan("The main-integration phase of the simulation took ", _startTime);
 
+	LogStatistics();
 
-    return 0;
+	return 0;
 }
 
 int Simulator::Run()
 {
-	_acceleration = new Acceleration(integratorType, _simulation->settings.frame_center, &bodyData, _simulation->nebula);
-	
+	if (SetUp() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	// The checkpoint of an earlier run in the output directory must not be continued
+	remove(_simulation->settings.output.GetPath(_simulation->settings.output.checkpoint).c_str());
+
 	if (_simulation->bodyGroupList.nOfDistinctStartTimes > 1) {
 		_simulation->binary->Log("The synchronization phase of the simulation begins", false);
 		_startTime = time(0);
@@ -97,24 +156,227 @@ int Simulator::Run()
 		_simulation->binary->LogTimeSpan("The main-integration phase of the simulation took ", _startTime);
 	}
 
+	LogStatistics();
+
+	return 0;
+}
+
+/// Creates the acceleration of the bodies and checks the integrator against the settings
+int Simulator::SetUp()
+{
+	_acceleration = new Acceleration(integratorType, _simulation->settings.frame_center, &bodyData, _simulation->nebula);
+
+#ifdef _OPENMP
+	if (_simulation->settings.threadCount > 0) {
+		omp_set_num_threads(_simulation->settings.threadCount);
+	}
+	std::ostringstream stream;
+	stream << "The accelerations are computed by " << omp_get_max_threads() << " thread(s)";
+	_simulation->binary->Log(stream.str(), true);
+#else
+	if (_simulation->settings.threadCount > 1) {
+		_simulation->binary->Log("OpenMP support was not compiled in, thread_count is ignored", true);
+	}
+#endif
+
+	if (integratorType == INTEGRATOR_TYPE_WISDOM_HOLMAN || integratorType == INTEGRATOR_TYPE_HYBRID_SYMPLECTIC) {
+		if (_simulation->settings.frame_center != FRAME_CENTER_ASTRO || _simulation->nebula != 0) {
+			Error::_errMsg = "The " + _simulation->settings.integrator->name + " integrator can be used only in the astrocentric frame and without a nebula!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		std::ostringstream msg;
+		msg << "The " << _simulation->settings.integrator->name << " integrator takes " << ((WisdomHolman *)_simulation->settings.integrator)->stepsPerOrbit << " steps per the shortest orbital period";
+		_simulation->binary->Log(msg.str(), true);
+	}
+	if (integratorType == INTEGRATOR_TYPE_HYBRID_SYMPLECTIC) {
+		HybridSymplectic *hybrid = (HybridSymplectic *)_simulation->settings.integrator;
+		if (_simulation->settings.closeEncounter != 0) {
+			hybrid->changeoverFactor = _simulation->settings.closeEncounter->factor;
+		}
+		if (_simulation->settings.collision != 0) {
+			hybrid->collisionFactor = _simulation->settings.collision->factor;
+		}
+		std::ostringstream msg;
+		msg << "The close encounters within " << hybrid->changeoverFactor << " Hill radii are integrated by the Bulirsch-Stoer method";
+		_simulation->binary->Log(msg.str(), true);
+	}
+	if (integratorType == INTEGRATOR_TYPE_BLOCK_HERMITE) {
+		if (_simulation->settings.frame_center != FRAME_CENTER_BARY || _simulation->nebula != 0) {
+			Error::_errMsg = "The " + _simulation->settings.integrator->name + " integrator can be used only in the barycentric frame and without a nebula!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		std::ostringstream msg;
+		msg << "The " << _simulation->settings.integrator->name << " integrator uses the accuracy parameter eta = " << ((BlockHermite *)_simulation->settings.integrator)->eta;
+		_simulation->binary->Log(msg.str(), true);
+	}
+	if (_simulation->settings.restrictedProblem) {
+		if (_simulation->nebula != 0 || (integratorType != INTEGRATOR_TYPE_RUNGE_KUTTA4 && integratorType != INTEGRATOR_TYPE_RUNGE_KUTTA56 &&
+			integratorType != INTEGRATOR_TYPE_RUNGE_KUTTA_FEHLBERG78 && integratorType != INTEGRATOR_TYPE_DORMAND_PRINCE &&
+			integratorType != INTEGRATOR_TYPE_BULIRSCH_STOER && integratorType != INTEGRATOR_TYPE_GAUSS_RADAU15)) {
+			Error::_errMsg = "The restricted problem mode can be used only with the rk4, rk56, rk78, rkn76, bs and ias15 integrators and without a nebula!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		std::ostringstream msg;
+		msg << "The test particles are integrated in chunks of " << Constants::RestrictedChunkSize << " against the trajectory of the other bodies";
+		_simulation->binary->Log(msg.str(), true);
+	}
+
+	if (_acceleration->SetGravityKernel(_simulation->settings.gravityKernel) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	_acceleration->symmetricGravity = _simulation->settings.symmetricGravity;
+	_acceleration->treeGravity = _simulation->settings.treeGravity;
+	_acceleration->openingAngle = _simulation->settings.openingAngle;
+	_acceleration->mixedPrecision = _simulation->settings.mixedPrecision;
+	if (_acceleration->mixedPrecision) {
+		if (_simulation->settings.frame_center == FRAME_CENTER_BARY && !_acceleration->treeGravity) {
+			_simulation->binary->Log("The perturbations of the test particles are computed in single precision", true);
+		}
+		else {
+			_simulation->binary->Log("The single precision test particle forces are available only in the barycentric frame without the tree, mixed_precision is ignored", true);
+		}
+	}
+	if (_acceleration->treeGravity) {
+		std::ostringstream msg;
+		msg << "The gravity of the bodies lighter than the giant planets is computed by the Barnes-Hut tree (opening angle: " << _acceleration->openingAngle << ")";
+		_simulation->binary->Log(msg.str(), true);
+	}
+	else if (_acceleration->symmetricGravity) {
+		_simulation->binary->Log("The mutual interactions of the massive bodies are computed by the symmetric kernel", true);
+	}
+	else {
+		_simulation->binary->Log("The " + std::string(GravityKernel::Name(_acceleration->gravityKernel)) + " gravity kernel is used", true);
+	}
+
 	return 0;
 }
 
+void Simulator::LogStatistics()
+{
+	if (_acceleration->testParticleTime > 0.0) {
+		std::ostringstream msg;
+		msg << "The test particle kernel computed " << _acceleration->nTestParticleInteraction << " interactions in "
+			<< _acceleration->testParticleTime << " s (" << _acceleration->nTestParticleInteraction/_acceleration->testParticleTime << " interactions/s)";
+		_simulation->binary->Log(msg.str(), true);
+	}
+	if (integratorType == INTEGRATOR_TYPE_WISDOM_HOLMAN) {
+		WisdomHolman *wh = (WisdomHolman *)_simulation->settings.integrator;
+		std::ostringstream msg;
+		msg << "The Wisdom-Holman integrator used a step of " << wh->hFixed << " d and evaluated the mutual interactions " << wh->nInteraction << " times";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (integratorType == INTEGRATOR_TYPE_HYBRID_SYMPLECTIC) {
+		HybridSymplectic *hybrid = (HybridSymplectic *)_simulation->settings.integrator;
+		std::ostringstream msg;
+		msg << "The hybrid symplectic integrator used a step of " << hybrid->hFixed << " d, integrated " << hybrid->nEncounter
+			<< " close encounter(s) in " << hybrid->nEncounterStep << " Bulirsch-Stoer step(s)";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (integratorType == INTEGRATOR_TYPE_BLOCK_HERMITE) {
+		BlockHermite *hermite = (BlockHermite *)_simulation->settings.integrator;
+		std::ostringstream msg;
+		msg << "The block Hermite integrator took " << hermite->nBlockStep << " block step(s) with " << hermite->nForce << " force evaluation(s) of individual bodies ("
+			<< hermite->nSharedForce << " with a shared step), the deepest level was " << hermite->levelMax;
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (integratorType == INTEGRATOR_TYPE_BULIRSCH_STOER) {
+		BulirschStoer *bs = (BulirschStoer *)_simulation->settings.integrator;
+		std::ostringstream msg;
+		msg << "The Bulirsch-Stoer integrator rejected " << bs->nRejectedStep << " step(s) and evaluated the accelerations " << bs->nEvaluation << " times";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (integratorType == INTEGRATOR_TYPE_DORMAND_PRINCE) {
+		DormandPrince *dp = (DormandPrince *)_simulation->settings.integrator;
+		std::ostringstream msg;
+		msg << "The Dormand-Prince integrator rejected " << dp->nRejectedStep << " step(s) and evaluated the accelerations " << dp->nEvaluation
+			<< " times, " << dp->nReusedEvaluation << " step(s) started with the last stage of the previous one";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (integratorType == INTEGRATOR_TYPE_GAUSS_RADAU15) {
+		GaussRadau15 *radau = (GaussRadau15 *)_simulation->settings.integrator;
+		std::ostringstream msg;
+		msg << "The Gauss-Radau integrator rejected " << radau->nRejectedStep << " step(s) and evaluated the accelerations " << radau->nEvaluation
+			<< " times, the predictor-corrector iteration did not converge in " << radau->nNotConverged << " step(s)";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (counter.failedStep > 0) {
+		std::ostringstream msg;
+		msg << "The integrator accepted " << counter.succededStep << " and rejected " << counter.failedStep << " step(s) with the "
+			<< (_simulation->settings.integrator->stepControl == STEP_CONTROL_PI ? "PI" : "classic") << " step size control";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (_nChunk > 0) {
+		std::ostringstream msg;
+		msg << "The test particles were integrated in at most " << _nChunk << " chunk(s) with " << _nChunkStep << " step(s), "
+			<< _nChunkRejectedStep << " trial step(s) of them were rejected";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (_simulation->settings.integrator->nTrialStep > 0) {
+		std::ostringstream msg;
+		msg << "The stage combinations of the integrator streamed " << _simulation->settings.integrator->nStageByte/_simulation->settings.integrator->nTrialStep
+			<< " bytes per trial step (" << _simulation->settings.integrator->nTrialStep << " trial steps)";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (_simulation->settings.integrator->nAllocation > 0) {
+		std::ostringstream msg;
+		msg << "The workspace of the integrator was allocated " << _simulation->settings.integrator->nAllocation << " time(s)";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (counter.locatedEvent > 0) {
+		std::ostringstream msg;
+		msg << "The steps were shortened " << counter.locatedEvent << " time(s) to the time of an event located within them";
+		_simulation->binary->Log(msg.str(), false);
+	}
+	if (_acceleration->nMixedPrecisionCheck > 0) {
+		std::ostringstream msg;
+		msg << "The largest relative error of the single precision test particle forces was " << _acceleration->maxMixedPrecisionError
+			<< " (" << _acceleration->nMixedPrecisionCheck << " checks)";
+		_simulation->binary->Log(msg.str(), true);
+	}
+}
+
 int Simulator::Integrate(TimeLine* timeLine)
 {
-	if (BodyListToBodyData() == 1) {
+	// bodyData is built from the bodyList only at the first call, the body groups included later by
+	// Synchronization() are inserted into it by Insert()
+	if (bodyData.nBodies.total == 0 && BodyListToBodyData() == 1) {
 		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 		return 1;
 	}
-	_simulation->binary->SavePhases(timeLine->time, bodyData.nBodies.total, bodyData.y0, bodyData.id, _simulation->settings.output.outputType, bodyData.nBodies.removed);
+	// The stage arrays of the integrator are allocated here and not in the step loop
+	if (_simulation->settings.integrator->AllocateWorkspace(bodyData.nBodies.NOfVar()) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	// The continued integration starts from the phases of the checkpoint, whose output was already written
+	if (!_resumed) {
+		ShiftToBaryCenter();
+		_simulation->binary->SavePhases(timeLine->time, bodyData.nBodies.total, bodyData.y0, bodyData.id, _simulation->settings.output.outputType, bodyData.nBodies.removed);
 
-	Calculate::Integrals(&bodyData);
-	_simulation->binary->SaveIntegrals(timeLine->time, 16, bodyData.integrals, _simulation->settings.output.outputType);
+		Calculate::Integrals(&bodyData);
+		_simulation->binary->SaveIntegrals(timeLine->time, 16, bodyData.integrals, _simulation->settings.output.outputType);
+	}
 
 	bool stop = false;
+	int nMixedPrecisionCheck = _acceleration->nMixedPrecisionCheck;
+	int nAllocation = _simulation->settings.integrator->nAllocation;
+	int nRejectedStep = _simulation->settings.integrator->nRejectedStep;
 //	StopWatch timer1, timer2;
 
-	while ( 1 ) {
+	// In the restricted problem mode the step loop below is replaced by the two passes over the output intervals
+	if (_simulation->settings.restrictedProblem && bodyData.nBodies.testParticle > 0) {
+		if (IntegrateRestricted(timeLine) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		stop = true;
+	}
+
+	while (!stop) {
 		
 //		timer1.start();
 //		timer2.start();
@@ -124,6 +386,16 @@ int Simulator::Integrate(TimeLine* timeLine)
 		}
 //		timer1.stop();
 		counter.succededStep++;
+		// The trial steps rejected by the step size control of the Driver() call
+		counter.failedStep += _simulation->settings.integrator->nRejectedStep - nRejectedStep;
+		nRejectedStep = _simulation->settings.integrator->nRejectedStep;
+
+		if (_acceleration->nMixedPrecisionCheck > nMixedPrecisionCheck) {
+			nMixedPrecisionCheck = _acceleration->nMixedPrecisionCheck;
+			std::ostringstream msg;
+			msg << "t: " << timeLine->time << " [d] relative error of the single precision test particle forces: " << _acceleration->mixedPrecisionError;
+			_simulation->binary->Log(msg.str(), false);
+		}
 
 		if (DecisionMaking(timeLine, stop) == 1) {
 			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
@@ -142,9 +414,29 @@ int Simulator::Integrate(TimeLine* timeLine)
 		if (stop)
 			break;
 
+		if (CheckpointDue(timeLine)) {
+			if (SaveCheckpoint(timeLine) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			if (terminateRequested) {
+				_terminated = true;
+				break;
+			}
+		}
+
 		//timer2.stop();
 		//_simulation->binary->SaveElapsedTimes(timeLine->time, counter, timer1, timer2, _simulation->settings.output.outputType);
 	}
+	if (_simulation->settings.integrator->nAllocation > nAllocation) {
+		std::ostringstream msg;
+		msg << "The workspace of the integrator was reallocated " << _simulation->settings.integrator->nAllocation - nAllocation << " time(s) during the step loop";
+		_simulation->binary->Log(msg.str(), true);
+	}
+	if (_terminated) {
+		_simulation->binary->Log("The integration was interrupted, it can be continued from the checkpoint by the -c option", true);
+		return 0;
+	}
 
 	_simulation->binary->SavePhases(timeLine->time, bodyData.nBodies.total, bodyData.y0, bodyData.id, _simulation->settings.output.outputType, bodyData.nBodies.removed);
 	Calculate::Integrals(&bodyData);
@@ -153,9 +445,289 @@ int Simulator::Integrate(TimeLine* timeLine)
 	return 0;
 }
 
+/**
+ * The step loop of the restricted problem mode, in which the test particles do not act on the other
+ * bodies. Over each output interval first the other bodies are integrated alone and their trajectory is
+ * stored, then the chunks of the test particles are integrated in parallel against it, each with its own
+ * step size. The ejections and centrum hits of the test particles are checked at the steps of their
+ * chunk, the events of the other bodies at the ends of the output intervals.
+ */
+int Simulator::IntegrateRestricted(TimeLine *timeLine)
+{
+	Integrator *integrator = _simulation->settings.integrator;
+	int nRejectedStep = integrator->nRejectedStep;
+
+	// The chunks of a continued integration are restored from the checkpoint
+	if (_chunks.empty() && CreateChunks(timeLine) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	bool stop = false;
+	while (!stop) {
+		// The end of the output interval, or of the integration if it is earlier
+		double actualTime = 1000.0*Constants::YearToDay*timeLine->millenium + timeLine->time;
+		double hInterval = timeLine->output - timeLine->lastSave;
+		double hRest = timeLine->length - (actualTime - timeLine->start);
+		bool last = fabs(hInterval) >= fabs(hRest);
+		double tEnd = timeLine->time + (last ? hRest : hInterval);
+
+		// The first pass: the other bodies and their trajectory
+		_trajectory.KeepLast();
+		while (timeLine->time != tEnd) {
+			if (StepTo(integrator, &_others, _othersAcceleration, timeLine, tEnd) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			counter.succededStep++;
+			counter.failedStep += integrator->nRejectedStep - nRejectedStep;
+			nRejectedStep = integrator->nRejectedStep;
+			timeLine->elapsedTime	+= timeLine->hDid;
+			timeLine->lastSave		+= timeLine->hDid;
+
+			int result = _othersAcceleration->Compute(timeLine->time, _others.y0, &_fKnot[0]);
+			HANDLE_RESULT(result);
+			_trajectory.Append(timeLine->time, _others.y0, &_fKnot[0]);
+		}
+
+		// The second pass: the chunks of the test particles
+		int nChunk = (int)_chunks.size();
+		int failed = 0;
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int c=0; c<nChunk; c++) {
+			if (IntegrateChunk(_chunks[c], tEnd) == 1) {
+#ifdef _OPENMP
+				#pragma omp critical
+#endif
+				failed = 1;
+			}
+		}
+		if (failed == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+
+		// The test particles removed by their chunks are removed before CheckEvent() scans the phases
+		if (CollectChunks() == 1 || HandleEjectionAndHitCentrum() == 1 || RemoveQueuedBodies() == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		bodyData.time = tEnd;
+		if (CheckEvent(tEnd) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+
+		if (last) {
+			UpdateBodyListAfterIntegration();
+			stop = true;
+		}
+		else if (bodyData.nBodies.total <= 1) {
+			_simulation->binary->Log("The total number of bodies reduced to 1!", true);
+			UpdateBodyListAfterIntegration();
+			stop = true;
+		}
+		else {
+			_simulation->binary->SavePhases(timeLine->time, bodyData.nBodies.total, bodyData.y0, bodyData.id, _simulation->settings.output.outputType, bodyData.nBodies.removed);
+			Calculate::Integrals(&bodyData);
+			_simulation->binary->SaveIntegrals(timeLine->time, 16, bodyData.integrals, _simulation->settings.output.outputType);
+			timeLine->lastSave = 0.0;
+
+			// CheckEvent() removed an other body or a test particle which was not removed by its chunk
+			int nChunkTotal = _others.nBodies.total;
+			for (int c=0; c<nChunk; c++) {
+				nChunkTotal += _chunks[c]->bodyData.nBodies.testParticle;
+			}
+			if (nChunkTotal != bodyData.nBodies.total && CreateChunks(timeLine) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+
+			// The chunks keep their step sizes over the output intervals, they are saved at the ends of them
+			if (CheckpointDue(timeLine)) {
+				if (SaveCheckpoint(timeLine) == 1) {
+					Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+					return 1;
+				}
+				if (terminateRequested) {
+					_terminated = true;
+					stop = true;
+				}
+			}
+		}
+	}
+	FreeChunks();
+
+	return 0;
+}
+
+/**
+ * Integrates the test particles of the chunk to tEnd. After each step the phases of the other bodies are
+ * set from the trajectory, and the test particles which were ejected or hit the central body are removed
+ * from the chunk.
+ */
+int Simulator::IntegrateChunk(RestrictedChunk *chunk, double tEnd)
+{
+	BodyData	*data = &chunk->bodyData;
+	TimeLine	*timeLine = &chunk->timeLine;
+	int			nOther = _trajectory.nBody;
+	std::vector<int> removed;
+
+	while (timeLine->time != tEnd) {
+		if (StepTo(chunk->integrator, data, chunk->acceleration, timeLine, tEnd) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		chunk->nStep++;
+		if (_trajectory.Phase(timeLine->time, data->y0, chunk->segment) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+
+		// The test particles are removed after all events of the step are found, since the interpolant
+		// of the integrator refers to the indices of the step
+		removed.clear();
+		for (int i=nOther; i<data->nBodies.total; i++) {
+			bool found = false;
+			ChunkEvent e;
+			if (FindChunkEvent(chunk, i, found, e) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			if (found) {
+				chunk->events.push_back(e);
+				removed.push_back(i);
+			}
+		}
+		if (data->Remove(removed) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Checks whether the ith test particle of the chunk was ejected or hit the central body during the last
+ * step. If the integrator can interpolate within its step, the time of the event is located as in
+ * LocateEvents(), otherwise, or if the particle was already beyond the limit at the start of the step,
+ * the end of the step is taken.
+ */
+int Simulator::FindChunkEvent(RestrictedChunk *chunk, int i, bool &found, ChunkEvent &event) const
+{
+	BodyData	*data = &chunk->bodyData;
+	TimeLine	*timeLine = &chunk->timeLine;
+	double		ejection = _simulation->settings.ejection;
+	double		hitCentrum = _simulation->settings.hitCentrum;
+	double		t0 = timeLine->time - timeLine->hDid;
+	int			i0 = 6*i;
+
+	found = false;
+	if (chunk->integrator->denseOutput) {
+		const double *yStart = data->y;
+		const double *yEnd = data->y0;
+		double r0 = sqrt(SQR(yStart[i0] - yStart[0]) + SQR(yStart[i0 + 1] - yStart[1]) + SQR(yStart[i0 + 2] - yStart[2]));
+		double r1 = sqrt(SQR(yEnd[i0] - yEnd[0]) + SQR(yEnd[i0 + 1] - yEnd[1]) + SQR(yEnd[i0 + 2] - yEnd[2]));
+		double v = 0.0;
+		for (int k=0; k<2; k++) {
+			const double *y = k == 0 ? yStart : yEnd;
+			double vi = sqrt(SQR(y[i0 + 3]) + SQR(y[i0 + 4]) + SQR(y[i0 + 5]));
+			double vc = sqrt(SQR(y[3]) + SQR(y[4]) + SQR(y[5]));
+			v = vi + vc > v ? vi + vc : v;
+		}
+		double reach = fabs(timeLine->hDid)*v;
+
+		EventFunction e[2] = { { 0, i, SQR(hitCentrum), 1.0 }, { 0, i, SQR(ejection), -1.0 } };
+		bool candidate[2] = {
+			hitCentrum > 0 && r0 > hitCentrum && (r0 < r1 ? r0 : r1) - reach < hitCentrum,
+			ejection > 0 && r0 < ejection && (r0 > r1 ? r0 : r1) + reach > ejection
+		};
+		for (int k=0; k<2; k++) {
+			bool	located = false;
+			double	tEvent = 0.0;
+			if (candidate[k] && FindEventTime(chunk->integrator, data, chunk->acceleration, timeLine, e[k], chunk->yDense, located, tEvent) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			if (located && (!found || fabs(tEvent - t0) < fabs(event.time - t0))) {
+				found = true;
+				event.type = k == 0 ? HitCentrum : Ejection;
+				event.time = tEvent;
+			}
+		}
+	}
+
+	const double *y = data->y0;
+	if (found) {
+		chunk->yDense.resize(data->nBodies.NOfVar());
+		if (chunk->integrator->DenseOutput(data, chunk->acceleration, timeLine, event.time, &chunk->yDense[0]) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		y = &chunk->yDense[0];
+	}
+	else {
+		double r2 = SQR(y[i0] - y[0]) + SQR(y[i0 + 1] - y[1]) + SQR(y[i0 + 2] - y[2]);
+		if (ejection > 0 && r2 > SQR(ejection)) {
+			found = true;
+			event.type = Ejection;
+		}
+		else if (hitCentrum > 0 && r2 < SQR(hitCentrum)) {
+			found = true;
+			event.type = HitCentrum;
+		}
+		if (!found) {
+			return 0;
+		}
+		event.time = timeLine->time;
+	}
+	event.id = data->id[i];
+	memcpy(event.centralPhase, y, 6*sizeof(double));
+	memcpy(event.phase, &y[i0], 6*sizeof(double));
+
+	return 0;
+}
+
+/**
+ * A step of the integrator which does not pass tEnd. If the step was clipped at tEnd and accepted, the time
+ * is set to tEnd exactly, and the next step is not shorter than the one proposed before the clipping.
+ */
+int Simulator::StepTo(Integrator *integrator, BodyData *data, Acceleration *acceleration, TimeLine *timeLine, double tEnd)
+{
+	double hLeft = tEnd - timeLine->time;
+	double hProposed = timeLine->hNext;
+	bool clipped = fabs(hProposed) >= fabs(hLeft);
+	if (clipped) {
+		timeLine->hNext = hLeft;
+	}
+	if (integrator->Driver(data, acceleration, timeLine) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	if (clipped && timeLine->hDid == hLeft) {
+		timeLine->time = tEnd;
+		data->time = tEnd;
+		if (fabs(timeLine->hNext) < fabs(hProposed)) {
+			timeLine->hNext = hProposed;
+		}
+	}
+
+	return 0;
+}
+
 #define NSTEP 50
 int	Simulator::DecisionMaking(TimeLine* timeLine, bool& stop)
 {
+	// If the integrator can interpolate within its step the events are located within it, and the step
+	// is shortened to the earliest one
+	if (_simulation->settings.integrator->denseOutput && LocateEvents(timeLine) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
 	timeLine->elapsedTime	+= timeLine->hDid;
 	timeLine->lastSave		+= timeLine->hDid;
 	timeLine->lastNSteps	+= timeLine->hDid;
@@ -171,6 +743,28 @@ int	Simulator::DecisionMaking(TimeLine* timeLine, bool& stop)
 #endif
 
 	double actualTime = 1000.0*Constants::YearToDay*timeLine->millenium + timeLine->time;
+
+	// If the integrator can interpolate within its step the output times passed by the step are not
+	// reached by clipping the step size but sampled by the interpolant. This precedes the events of
+	// the step, since they could change the bodies.
+	bool dense = _simulation->settings.integrator->denseOutput;
+	while (dense && fabs(timeLine->lastSave) > fabs(timeLine->output)) {
+		timeLine->lastSave -= timeLine->output;
+		double t = timeLine->time - timeLine->lastSave;
+		_yDense.resize(bodyData.nBodies.NOfVar());
+		if (_simulation->settings.integrator->DenseOutput(&bodyData, _acceleration, timeLine, t, &_yDense[0]) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		_simulation->binary->SavePhases(t, bodyData.nBodies.total, &_yDense[0], bodyData.id, _simulation->settings.output.outputType, bodyData.nBodies.removed);
+		// The integrals are computed from the interpolated phases
+		double *y0 = bodyData.y0;
+		bodyData.y0 = &_yDense[0];
+		Calculate::Integrals(&bodyData);
+		bodyData.y0 = y0;
+		_simulation->binary->SaveIntegrals(t, 16, bodyData.integrals, _simulation->settings.output.outputType);
+	}
+
 // NOTE: az alábbi lehetöségek sorrendje fontos. Elöször ez eseményeket ellenörzöm, aztán
 // pedig, hogy elértük-e az integrálás végét, az adatokat el kell-e menteni.
 	if (CheckEvent(timeLine->time) == 1) {
@@ -225,7 +819,7 @@ int	Simulator::DecisionMaking(TimeLine* timeLine, bool& stop)
 		timeLine->lastSave = 0.0;
 	}
 
-	if (fabs(timeLine->lastSave + timeLine->hNext) > fabs(timeLine->output)) {
+	if (!dense && fabs(timeLine->lastSave + timeLine->hNext) > fabs(timeLine->output)) {
 		timeLine->hNext = timeLine->output - timeLine->lastSave;
 	}
 
@@ -411,22 +1005,34 @@ int Simulator::PreIntegration()
 
 int Simulator::MainIntegration()
 {
-	// If neither synchronization nor pre-integration was performed, than the bodyList is empty,
-	// so it must be populated before the call to Integrate()
-	if (_simulation->bodyList.size() == 0) {
-		if (PopulateBodyList(_simulation->settings.timeLine->time) == 1) {
-			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
-			return 1;
+	// The continued integration takes the bodies and the step size from the checkpoint
+	if (!_resumed) {
+		// If neither synchronization nor pre-integration was performed, than the bodyList is empty,
+		// so it must be populated before the call to Integrate()
+		if (_simulation->bodyList.size() == 0) {
+			if (PopulateBodyList(_simulation->settings.timeLine->time) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
 		}
-	}
 
-	_simulation->settings.timeLine->hDid = 0.0;
-	_simulation->settings.timeLine->hNext = _simulation->settings.timeLine->Forward() ? ShortestPeriod() / 50000.0 : -ShortestPeriod() / 50000.0;
-	if (fabs(_simulation->settings.timeLine->hNext) > fabs(_simulation->settings.timeLine->length)) {
-		_simulation->settings.timeLine->hNext = _simulation->settings.timeLine->length;
+		_simulation->settings.timeLine->hDid = 0.0;
+		_simulation->settings.timeLine->hNext = _simulation->settings.timeLine->Forward() ? ShortestPeriod() / 50000.0 : -ShortestPeriod() / 50000.0;
+		if (fabs(_simulation->settings.timeLine->hNext) > fabs(_simulation->settings.timeLine->length)) {
+			_simulation->settings.timeLine->hNext = _simulation->settings.timeLine->length;
+		}
 	}
 
-	if (Integrate(_simulation->settings.timeLine) == 1) {
+	// Only the main integration writes checkpoints, a termination signal stops it after the next one
+	terminateRequested = 0;
+	signal(SIGTERM, RequestTermination);
+	signal(SIGINT, RequestTermination);
+	_checkpointTime = time(0);
+
+	int result = Integrate(_simulation->settings.timeLine);
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+	if (result == 1) {
 		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 		return 1;
 	}
@@ -446,7 +1052,11 @@ int Simulator::Insert(double time, std::list<BodyGroup>::iterator &bgIt)
 		if (bodyListByType.size() > 0) {
 			_simulation->binary->SaveBodyProperties(time, bodyListByType, _simulation->settings.output.outputType);
 			SetIteratorAfter((body_type_t)i, bodyListIt);
-			_simulation->bodyList.insert(bodyListIt, bodyListByType.begin(), bodyListByType.end());
+			_simulation->InsertBodies(bodyListIt, bodyListByType);
+			if (InsertIntoBodyData(bodyListByType, (body_type_t)i) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
 		}
 	}
 
@@ -464,7 +1074,11 @@ int Simulator::Insert(double time, std::list<BodyGroup *>::iterator &bgIt)
 		if (bodyListByType.size() > 0) {
 			_simulation->binary->SaveBodyProperties(time, bodyListByType, _simulation->settings.output.outputType);
 			SetIteratorAfter((body_type_t)i, bodyListIt);
-			_simulation->bodyList.insert(bodyListIt, bodyListByType.begin(), bodyListByType.end());
+			_simulation->InsertBodies(bodyListIt, bodyListByType);
+			if (InsertIntoBodyData(bodyListByType, (body_type_t)i) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
 		}
 	}
 
@@ -523,64 +1137,103 @@ int Simulator::BodyListToBodyData()
 
 	int i = 0;
 	for (std::list<Body *>::iterator it = _simulation->bodyList.begin(); it != _simulation->bodyList.end(); it++) {
-		bodyData.id[i]          = (*it)->GetId();
-		bodyData.type[i]        = (*it)->type;
-		bodyData.migStopAt[i]   = (*it)->migrationStopAt;
-		bodyData.migType[i]     = (*it)->migrationType;
-
-		if ((*it)->type != BODY_TYPE_TESTPARTICLE) {
-			bodyData.mass[i]    = (*it)->characteristics->mass;
-			bodyData.radius[i]  = (*it)->characteristics->radius;
-			bodyData.density[i] = (*it)->characteristics->density;
-            bodyData.cD[i]      = (*it)->characteristics->stokes;
-
-			if (bodyData.radius[i] > 0 ) { // && (*it)->characteristics->stokes > 0) {
-				bodyData.gammaEpstein[i] = (*it)->characteristics->GammaEpstein();
-                if ((*it)->characteristics->stokes > 0) {
-                    bodyData.gammaStokes[i] = (*it)->characteristics->GammaStokes();
-                } else {
-    				bodyData.gammaStokes[i] = 0.0;
-                }
-			}
-			else {
-				bodyData.gammaEpstein[i]    = 0.0;
-    			bodyData.gammaStokes[i]     = 0.0;
-			}
-		}
-		else {
-			bodyData.mass[i]        = 0.0;
-			bodyData.radius[i]      = 0.0;
-			bodyData.density[i]     = 0.0;
-			bodyData.cD[i]          = 0.0;
-			bodyData.gammaStokes[i] = 0.0;
-			bodyData.gammaEpstein[i]= 0.0;
-		}
-
-		int i0 = 6*i;
-		bodyData.y0[i0 + 0] = (*it)->phase->position.x;
-		bodyData.y0[i0 + 1] = (*it)->phase->position.y;
-		bodyData.y0[i0 + 2] = (*it)->phase->position.z;
-		bodyData.y0[i0 + 3] = (*it)->phase->velocity.x;
-		bodyData.y0[i0 + 4] = (*it)->phase->velocity.y;
-		bodyData.y0[i0 + 5] = (*it)->phase->velocity.z;
+		CopyBody(*it, i);
 		i++;
 	}
-
-	if (_simulation->settings.frame_center == FRAME_CENTER_BARY) {
-		Calculate::PhaseOfBC(&bodyData, bodyData.bc);
-		Tools::ToPhase(bodyData.bc, &(bodyData.phaseOfBC));
-
-		Calculate::PhaseWithRespectToBC(&bodyData, bodyData.bc);
-
-		Calculate::AngularMomentum(&bodyData, &(bodyData.angularMomentum[0]));
-		Calculate::KineticEnergy(&bodyData, bodyData.kineticEnergy[0]);
-		Calculate::PotentialEnergy(&bodyData, bodyData.potentialEnergy[0]);
-		bodyData.totalEnergy[0] = bodyData.kineticEnergy[0] - bodyData.potentialEnergy[0];
-	}
+	bodyData.BuildIdIndex(0, bodyData.nBodies.total);
 
 	return 0;
 }
 
+/**
+ * Inserts the bodies, which are of the given type, into bodyData after the bodies of their type, where
+ * Insert() puts them into the bodyList. Until bodyData is built by BodyListToBodyData() nothing is done.
+ */
+int Simulator::InsertIntoBodyData(std::list<Body *> &bodies, body_type_t type)
+{
+	if (bodyData.nBodies.total == 0) {
+		return 0;
+	}
+
+	int index = bodyData.nBodies.IndexAfter(type);
+	int n = (int)bodies.size();
+	if (bodyData.Insert(index, n, type) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	int i = index;
+	for (std::list<Body *>::iterator it = bodies.begin(); it != bodies.end(); it++) {
+		CopyBody(*it, i);
+		i++;
+	}
+	bodyData.BuildIdIndex(index, n);
+
+	return 0;
+}
+
+/// Copies the properties and the phase of the body into the ith element of bodyData
+void Simulator::CopyBody(Body *body, int i)
+{
+	bodyData.id[i]          = body->GetId();
+	bodyData.type[i]        = body->type;
+	bodyData.migStopAt[i]   = body->migrationStopAt;
+	bodyData.migType[i]     = body->migrationType;
+	bodyData.indexOfNN[i]   = -1;
+	bodyData.distanceOfNN[i]= 0.0;
+
+	if (body->type != BODY_TYPE_TESTPARTICLE) {
+		bodyData.mass[i]    = body->characteristics->mass;
+		bodyData.radius[i]  = body->characteristics->radius;
+		bodyData.density[i] = body->characteristics->density;
+        bodyData.cD[i]      = body->characteristics->stokes;
+
+		if (bodyData.radius[i] > 0 ) { // && body->characteristics->stokes > 0) {
+			bodyData.gammaEpstein[i] = body->characteristics->GammaEpstein();
+            if (body->characteristics->stokes > 0) {
+                bodyData.gammaStokes[i] = body->characteristics->GammaStokes();
+            } else {
+				bodyData.gammaStokes[i] = 0.0;
+            }
+		}
+		else {
+			bodyData.gammaEpstein[i]    = 0.0;
+			bodyData.gammaStokes[i]     = 0.0;
+		}
+	}
+	else {
+		bodyData.mass[i]        = 0.0;
+		bodyData.radius[i]      = 0.0;
+		bodyData.density[i]     = 0.0;
+		bodyData.cD[i]          = 0.0;
+		bodyData.gammaStokes[i] = 0.0;
+		bodyData.gammaEpstein[i]= 0.0;
+	}
+
+	int i0 = 6*i;
+	bodyData.y0[i0 + 0] = body->phase->position.x;
+	bodyData.y0[i0 + 1] = body->phase->position.y;
+	bodyData.y0[i0 + 2] = body->phase->position.z;
+	bodyData.y0[i0 + 3] = body->phase->velocity.x;
+	bodyData.y0[i0 + 4] = body->phase->velocity.y;
+	bodyData.y0[i0 + 5] = body->phase->velocity.z;
+}
+
+/// In the barycentric frame shifts the phases to the barycentre and computes the initial integrals
+void Simulator::ShiftToBaryCenter()
+{
+	if (_simulation->settings.frame_center == FRAME_CENTER_BARY) {
+		Calculate::PhaseOfBC(&bodyData, bodyData.bc);
+		Tools::ToPhase(bodyData.bc, &(bodyData.phaseOfBC));
+
+		Calculate::PhaseWithRespectToBC(&bodyData, bodyData.bc);
+
+		Calculate::AngularMomentum(&bodyData, &(bodyData.angularMomentum[0]));
+		Calculate::KineticEnergy(&bodyData, bodyData.kineticEnergy[0]);
+		Calculate::PotentialEnergy(&bodyData, bodyData.potentialEnergy[0]);
+		bodyData.totalEnergy[0] = bodyData.kineticEnergy[0] - bodyData.potentialEnergy[0];
+	}
+}
+
 void Simulator::UpdateBodyListAfterIntegration()
 {
 #ifdef _DEBUG
@@ -607,6 +1260,590 @@ void Simulator::UpdateBodyListAfterIntegration()
 	}
 }
 
+/// True if the main integration has to write a checkpoint: the interval of the checkpoints has elapsed or the termination was requested
+bool Simulator::CheckpointDue(TimeLine *timeLine) const
+{
+	if (timeLine != _simulation->settings.timeLine) {
+		return false;
+	}
+	if (terminateRequested) {
+		return true;
+	}
+	double interval = _simulation->settings.checkpointInterval;
+
+	return interval > 0.0 && difftime(time(0), _checkpointTime) >= 60.0*interval;
+}
+
+/**
+ * Writes the state of the main integration into the checkpoint of the output directory: the time line,
+ * the counters, the bodies, the state of the output files and of the integrator, and in the restricted
+ * problem mode the chunks of the test particles.
+ */
+int Simulator::SaveCheckpoint(TimeLine *timeLine)
+{
+	std::string path = _simulation->settings.output.GetPath(_simulation->settings.output.checkpoint);
+	Checkpoint checkpoint;
+	if (checkpoint.Create(path) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	bool restricted = _othersAcceleration != 0;
+	checkpoint.Write((int)integratorType);
+	checkpoint.Write(restricted);
+	checkpoint.Write(*timeLine);
+	checkpoint.Write(counter);
+	checkpoint.Write(_ejectionEvent.N);
+	checkpoint.Write(_hitCentrumEvent.N);
+	checkpoint.Write(_closeEncounterEvent.N);
+	checkpoint.Write(_collisionEvent.N);
+	checkpoint.Write(_weakCaptureEvent.N);
+	checkpoint.Write(TwoBodyAffair::_eventId);
+	checkpoint.Write(_nChunk);
+	checkpoint.Write(_nChunkStep);
+	checkpoint.Write(_nChunkRejectedStep);
+	_simulation->binary->SaveState(checkpoint);
+	bodyData.SaveState(checkpoint);
+
+	Integrator *integrator = _simulation->settings.integrator;
+	if (restricted) {
+		std::vector<int> chunkSize;
+		for (std::vector<RestrictedChunk *>::iterator it = _chunks.begin(); it != _chunks.end(); it++) {
+			chunkSize.push_back((*it)->bodyData.nBodies.testParticle);
+		}
+		checkpoint.WriteVector(chunkSize);
+		for (std::vector<RestrictedChunk *>::iterator it = _chunks.begin(); it != _chunks.end(); it++) {
+			BodyData *data = &(*it)->bodyData;
+			checkpoint.WriteArray(data->y0, data->nBodies.NOfVar());
+			checkpoint.Write((*it)->timeLine);
+			checkpoint.Write((*it)->nStep);
+			(*it)->integrator->SaveState(checkpoint, data);
+		}
+		integrator->SaveState(checkpoint, &_others);
+	}
+	else {
+		integrator->SaveState(checkpoint, &bodyData);
+	}
+
+	if (checkpoint.Commit() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	_checkpointTime = time(0);
+
+	std::ostringstream msg;
+	msg << "t: " << timeLine->time << " [d] the checkpoint was written";
+	_simulation->binary->Log(msg.str(), false);
+
+	return 0;
+}
+
+/**
+ * Restores the state of the main integration from the checkpoint of the output directory. The bodyList
+ * is built from the bodies of the input in the order of bodyData, the bodies which were removed before
+ * the checkpoint are left out.
+ */
+int Simulator::LoadCheckpoint(TimeLine *timeLine)
+{
+	std::string path = _simulation->settings.output.GetPath(_simulation->settings.output.checkpoint);
+	Checkpoint checkpoint;
+	if (checkpoint.Open(path) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	int		type = 0;
+	bool	restricted = false;
+	checkpoint.Read(type);
+	checkpoint.Read(restricted);
+	if (type != (int)integratorType || (restricted && !_simulation->settings.restrictedProblem)) {
+		Error::_errMsg = "The checkpoint '" + path + "' was written with a different integrator!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	checkpoint.Read(*timeLine);
+	checkpoint.Read(counter);
+	checkpoint.Read(_ejectionEvent.N);
+	checkpoint.Read(_hitCentrumEvent.N);
+	checkpoint.Read(_closeEncounterEvent.N);
+	checkpoint.Read(_collisionEvent.N);
+	checkpoint.Read(_weakCaptureEvent.N);
+	checkpoint.Read(TwoBodyAffair::_eventId);
+	checkpoint.Read(_nChunk);
+	checkpoint.Read(_nChunkStep);
+	checkpoint.Read(_nChunkRejectedStep);
+	if (_simulation->binary->LoadState(checkpoint) == 1 || bodyData.LoadState(checkpoint) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	Integrator *integrator = _simulation->settings.integrator;
+	int result = 0;
+	if (restricted) {
+		std::vector<int> chunkSize;
+		checkpoint.ReadVector(chunkSize);
+		int nTestParticle = 0;
+		for (std::vector<int>::iterator it = chunkSize.begin(); it != chunkSize.end(); it++) {
+			nTestParticle += *it;
+		}
+		if (checkpoint.Failed() || nTestParticle != bodyData.nBodies.testParticle) {
+			Error::_errMsg = "The chunks of the checkpoint '" + path + "' do not match its bodies!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (CreateChunks(timeLine, &chunkSize) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		for (std::vector<RestrictedChunk *>::iterator it = _chunks.begin(); it != _chunks.end() && result == 0; it++) {
+			BodyData *data = &(*it)->bodyData;
+			checkpoint.ReadArray(data->y0, data->nBodies.NOfVar());
+			checkpoint.Read((*it)->timeLine);
+			checkpoint.Read((*it)->nStep);
+			result = (*it)->integrator->LoadState(checkpoint, data);
+		}
+		result = result == 0 ? integrator->LoadState(checkpoint, &_others) : result;
+	}
+	else {
+		result = integrator->LoadState(checkpoint, &bodyData);
+	}
+	HANDLE_RESULT(result);
+	if (checkpoint.Failed()) {
+		Error::_errMsg = "The checkpoint '" + path + "' could not be read!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	checkpoint.Close();
+
+	std::unordered_map<int, Body *> bodies;
+	for (std::list<BodyGroup>::iterator bgIt = _simulation->bodyGroupList.items.begin(); bgIt != _simulation->bodyGroupList.items.end(); bgIt++) {
+		for (std::vector<Body>::iterator it = bgIt->items.begin(); it != bgIt->items.end(); it++) {
+			bodies[it->GetId()] = &(*it);
+		}
+		bgIt->inserted = true;
+	}
+	std::list<Body *> bodyList;
+	for (int i=0; i<bodyData.nBodies.total; i++) {
+		std::unordered_map<int, Body *>::iterator it = bodies.find(bodyData.id[i]);
+		if (it == bodies.end()) {
+			Error::_errMsg = "A body of the checkpoint '" + path + "' is not defined by the input!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		bodyList.push_back(it->second);
+	}
+	_simulation->InsertBodies(_simulation->bodyList.end(), bodyList);
+	UpdateBodyListAfterIntegration();
+
+	std::ostringstream msg;
+	msg << "The integration continues from the checkpoint at t: " << timeLine->time << " [d] with " << bodyData.nBodies.total << " bodies";
+	_simulation->binary->Log(msg.str(), true);
+
+	return 0;
+}
+
+/**
+ * Creates the bodies other than the test particles with their acceleration and the first knot of their
+ * trajectory, and the chunks of the test particles from bodyData. The chunks start with the step size of
+ * timeLine. If chunkSize is given, the chunks contain the given numbers of test particles, otherwise
+ * RestrictedChunkSize ones.
+ */
+int Simulator::CreateChunks(TimeLine *timeLine, const std::vector<int> *chunkSize)
+{
+	FreeChunks();
+
+	int nOther = bodyData.nBodies.total - bodyData.nBodies.testParticle;
+	if (CopyBodies(nOther, nOther, 0, &_others) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	_othersAcceleration = CreateAcceleration(&_others);
+	HANDLE_NULL(_othersAcceleration);
+	if (_simulation->settings.integrator->AllocateWorkspace(_others.nBodies.NOfVar()) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	_fKnot.resize(_others.nBodies.NOfVar());
+	int result = _othersAcceleration->Compute(timeLine->time, _others.y0, &_fKnot[0]);
+	HANDLE_RESULT(result);
+	_trajectory.Clear(nOther);
+	_trajectory.Append(timeLine->time, _others.y0, &_fKnot[0]);
+
+	int nTestParticle = bodyData.nBodies.total - nOther;
+	int nChunk = chunkSize != 0 ? (int)chunkSize->size() : (nTestParticle + Constants::RestrictedChunkSize - 1)/Constants::RestrictedChunkSize;
+	for (int c=0, first=nOther; c<nChunk; c++) {
+		int n = bodyData.nBodies.total - first < Constants::RestrictedChunkSize ? bodyData.nBodies.total - first : Constants::RestrictedChunkSize;
+		if (chunkSize != 0) {
+			n = (*chunkSize)[c];
+		}
+		RestrictedChunk *chunk = new RestrictedChunk;
+		HANDLE_NULL(chunk);
+		chunk->acceleration = 0;
+		chunk->integrator = 0;
+		chunk->timeLine = *timeLine;
+		chunk->segment = 0;
+		chunk->nStep = 0;
+		_chunks.push_back(chunk);
+
+		if (CopyBodies(nOther, first, n, &chunk->bodyData) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		chunk->acceleration = CreateAcceleration(&chunk->bodyData);
+		HANDLE_NULL(chunk->acceleration);
+		chunk->acceleration->trajectory = &_trajectory;
+		chunk->integrator = CreateIntegrator();
+		if (chunk->integrator == 0) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (chunk->integrator->AllocateWorkspace(chunk->bodyData.nBodies.NOfVar()) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		first += n;
+	}
+	_nChunk = (int)_chunks.size() > _nChunk ? (int)_chunks.size() : _nChunk;
+
+	return 0;
+}
+
+/**
+ * Copies the phases of the other bodies and of the test particles at the end of the output interval into
+ * bodyData, and queues the events of the chunks for HandleEjectionAndHitCentrum(). The test particles
+ * removed by the chunks are still present in bodyData.
+ */
+int Simulator::CollectChunks()
+{
+	int nOther = _others.nBodies.total;
+	memcpy(bodyData.y0, _others.y0, 6*nOther*sizeof(double));
+
+	for (std::vector<RestrictedChunk *>::iterator it = _chunks.begin(); it != _chunks.end(); it++) {
+		BodyData *data = &(*it)->bodyData;
+		for (int i=nOther; i<data->nBodies.total; i++) {
+			int j = bodyData.IndexOf(data->id[i]);
+			if (j < 0) {
+				Error::_errMsg = "The test particle of the chunk was not found!";
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			memcpy(&bodyData.y0[6*j], &data->y0[6*i], 6*sizeof(double));
+		}
+		for (std::vector<ChunkEvent>::iterator e = (*it)->events.begin(); e != (*it)->events.end(); e++) {
+			int k = bodyData.IndexOf(e->id);
+			if (k < 0) {
+				Error::_errMsg = "The test particle of the event was not found!";
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			TwoBodyAffair affair(e->type, e->time, 0, k, bodyData.id[0], e->id, e->centralPhase, e->phase);
+			Event &event = e->type == Ejection ? _ejectionEvent : _hitCentrumEvent;
+			event.items.push_back(affair);
+			event.N++;
+		}
+		(*it)->events.clear();
+	}
+
+	return 0;
+}
+
+void Simulator::FreeChunks()
+{
+	for (std::vector<RestrictedChunk *>::iterator it = _chunks.begin(); it != _chunks.end(); it++) {
+		_nChunkStep += (*it)->nStep;
+		if ((*it)->integrator != 0) {
+			_nChunkRejectedStep += (*it)->integrator->nRejectedStep;
+		}
+		delete (*it)->acceleration;
+		delete (*it)->integrator;
+		delete *it;
+	}
+	_chunks.clear();
+	delete _othersAcceleration;
+	_othersAcceleration = 0;
+}
+
+/**
+ * Copies the first nOther bodies of bodyData and the n test particles from index first into part.
+ */
+int Simulator::CopyBodies(int nOther, int first, int n, BodyData *part)
+{
+	part->Free();
+	part->nBodies = bodyData.nBodies;
+	part->nBodies.testParticle = n;
+	part->nBodies.total = nOther + n;
+	if (part->Allocate() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	for (int i=0; i<part->nBodies.total; i++) {
+		int j = i < nOther ? i : first + i - nOther;
+		part->id[i]				= bodyData.id[j];
+		part->type[i]			= bodyData.type[j];
+		part->migType[i]		= bodyData.migType[j];
+		part->migStopAt[i]		= bodyData.migStopAt[j];
+		part->indexOfNN[i]		= -1;
+		part->distanceOfNN[i]	= 0.0;
+		part->mass[i]			= bodyData.mass[j];
+		part->radius[i]			= bodyData.radius[j];
+		part->density[i]		= bodyData.density[j];
+		part->cD[i]				= bodyData.cD[j];
+		part->gammaStokes[i]	= bodyData.gammaStokes[j];
+		part->gammaEpstein[i]	= bodyData.gammaEpstein[j];
+		memcpy(&part->y0[6*i], &bodyData.y0[6*j], 6*sizeof(double));
+	}
+	part->BuildIdIndex(0, part->nBodies.total);
+	part->time = bodyData.time;
+
+	return 0;
+}
+
+/// An acceleration of the bodies in data with the same gravity computation as that of the simulation
+Acceleration* Simulator::CreateAcceleration(BodyData *data)
+{
+	Acceleration *acceleration = new Acceleration(integratorType, _simulation->settings.frame_center, data, 0);
+	if (acceleration == 0) {
+		return 0;
+	}
+	acceleration->SetGravityKernel(_acceleration->gravityKernel);
+	acceleration->symmetricGravity	= _acceleration->symmetricGravity;
+	acceleration->treeGravity		= _acceleration->treeGravity;
+	acceleration->openingAngle		= _acceleration->openingAngle;
+	acceleration->mixedPrecision	= _acceleration->mixedPrecision;
+
+	return acceleration;
+}
+
+/// A new integrator of the type and with the accuracy of the integrator of the simulation
+Integrator* Simulator::CreateIntegrator()
+{
+	Integrator *integrator = 0;
+	switch (integratorType) {
+		case INTEGRATOR_TYPE_RUNGE_KUTTA4:
+			integrator = new RungeKutta4();
+			break;
+		case INTEGRATOR_TYPE_RUNGE_KUTTA56:
+			integrator = new RungeKutta56();
+			break;
+		case INTEGRATOR_TYPE_RUNGE_KUTTA_FEHLBERG78:
+			integrator = new RungeKuttaFehlberg78();
+			break;
+		case INTEGRATOR_TYPE_DORMAND_PRINCE:
+			integrator = new DormandPrince();
+			break;
+		case INTEGRATOR_TYPE_BULIRSCH_STOER:
+			integrator = new BulirschStoer();
+			break;
+		case INTEGRATOR_TYPE_GAUSS_RADAU15:
+			integrator = new GaussRadau15();
+			break;
+		default:
+			Error::_errMsg = "The integrator cannot be used in the restricted problem mode!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 0;
+	}
+	integrator->accuracy	= _simulation->settings.integrator->accuracy;
+	integrator->epsilon		= _simulation->settings.integrator->epsilon;
+	integrator->stepControl	= _simulation->settings.integrator->stepControl;
+
+	return integrator;
+}
+
+// The relative accuracy of the event times within a step
+#define EVENT_TOLERANCE	1.0e-10
+/**
+ * Finds the earliest ejection, centrum hit and collision within the last step by the interpolant of the
+ * integrator, and shortens the step to its time, so that CheckEvent() finds it at the end of the step.
+ * The candidates are selected by bounding the displacement of the bodies within the step with their
+ * speeds at its ends.
+ */
+int Simulator::LocateEvents(TimeLine *timeLine)
+{
+	double ejection = _simulation->settings.ejection;
+	double hitCentrum = _simulation->settings.hitCentrum;
+	double factor = _simulation->settings.collision != 0 ? _simulation->settings.collision->factor : 0.0;
+	if (ejection <= 0.0 && hitCentrum <= 0.0 && factor <= 0.0) {
+		return 0;
+	}
+
+	int		nTotal = bodyData.nBodies.total;
+	int		nVar = bodyData.nBodies.NOfVar();
+	double	h = fabs(timeLine->hDid);
+	const double *yStart = bodyData.y;
+	const double *yEnd = bodyData.y0;
+
+	// The speeds of the bodies are kept in _sweptRadius until the radii are computed
+	_sweptRadius.resize(nTotal);
+	double vMax = 0.0;
+	for (int i=0; i<nTotal; i++) {
+		int i0 = 6*i;
+		double v0 = sqrt(SQR(yStart[i0 + 3]) + SQR(yStart[i0 + 4]) + SQR(yStart[i0 + 5]));
+		double v1 = sqrt(SQR(yEnd[i0 + 3]) + SQR(yEnd[i0 + 4]) + SQR(yEnd[i0 + 5]));
+		_sweptRadius[i] = v0 > v1 ? v0 : v1;
+		vMax = _sweptRadius[i] > vMax ? _sweptRadius[i] : vMax;
+	}
+
+	_eventFunctions.clear();
+	for (int i=1; i<nTotal; i++) {
+		int i0 = 6*i;
+		double r0 = sqrt(SQR(yStart[i0] - yStart[0]) + SQR(yStart[i0 + 1] - yStart[1]) + SQR(yStart[i0 + 2] - yStart[2]));
+		double r1 = sqrt(SQR(yEnd[i0] - yEnd[0]) + SQR(yEnd[i0 + 1] - yEnd[1]) + SQR(yEnd[i0 + 2] - yEnd[2]));
+		double reach = h*(_sweptRadius[i] + _sweptRadius[0]);
+		if (hitCentrum > 0 && r0 > hitCentrum && (r0 < r1 ? r0 : r1) - reach < hitCentrum) {
+			EventFunction e = { 0, i, SQR(hitCentrum), 1.0 };
+			_eventFunctions.push_back(e);
+		}
+		if (ejection > 0 && r0 < ejection && (r0 > r1 ? r0 : r1) + reach > ejection) {
+			EventFunction e = { 0, i, SQR(ejection), -1.0 };
+			_eventFunctions.push_back(e);
+		}
+	}
+	if (factor > 0.0) {
+		// A body without radius can touch only one with radius, whose swept radius covers the displacement of both
+		for (int i=0; i<nTotal; i++) {
+			_sweptRadius[i] = bodyData.radius[i] > 0.0 ? factor*bodyData.radius[i] + h*(_sweptRadius[i] + vMax) : 0.0;
+		}
+		if (_collisionDetector.FindOverlaps(bodyData.nBodies.centralBody, nTotal, yEnd, &_sweptRadius[0], 1.0, _candidates) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		for (std::vector<CollisionPair>::const_iterator it = _candidates.begin(); it != _candidates.end(); it++) {
+			double distance = factor*(bodyData.radius[it->i] + bodyData.radius[it->j]);
+			if (distance > 0.0) {
+				EventFunction e = { it->i, it->j, SQR(distance), 1.0 };
+				_eventFunctions.push_back(e);
+			}
+		}
+	}
+
+	bool	located = false;
+	double	tLocated = 0.0;
+	for (std::vector<EventFunction>::const_iterator it = _eventFunctions.begin(); it != _eventFunctions.end(); it++) {
+		bool	found = false;
+		double	tEvent = 0.0;
+		if (FindEventTime(_simulation->settings.integrator, &bodyData, _acceleration, timeLine, *it, _yDense, found, tEvent) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		if (found && (!located || fabs(timeLine->time - tEvent) > fabs(timeLine->time - tLocated))) {
+			located = true;
+			tLocated = tEvent;
+		}
+	}
+	if (!located) {
+		return 0;
+	}
+
+	// The step is shortened to the time of the earliest event
+	_yDense.resize(nVar);
+	if (_simulation->settings.integrator->DenseOutput(&bodyData, _acceleration, timeLine, tLocated, &_yDense[0]) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	memcpy(bodyData.y0, &_yDense[0], nVar*sizeof(double));
+	timeLine->hDid -= timeLine->time - tLocated;
+	timeLine->time = tLocated;
+	bodyData.time = tLocated;
+	counter.locatedEvent++;
+
+	return 0;
+}
+
+/**
+ * Finds the time within the last step of the integrator on data when the event function e becomes
+ * non-positive. If e is positive at both ends, the event can only occur around its minimum, where its rate
+ * changes sign: that is searched first. The time is refined by bisection, tEvent is on the non-positive side.
+ * The interpolated phases are computed into yDense, so the chunks of the test particles can call it in parallel.
+ */
+int Simulator::FindEventTime(Integrator *integrator, BodyData *data, Acceleration *acceleration, TimeLine *timeLine, const EventFunction &e, std::vector<double> &yDense, bool &found, double &tEvent) const
+{
+	double	t0 = timeLine->time - timeLine->hDid;
+	double	t1 = timeLine->time;
+	double	dir = timeLine->hDid >= 0.0 ? 1.0 : -1.0;
+	double	tol = EVENT_TOLERANCE*fabs(timeLine->hDid);
+
+	found = false;
+	double rate0 = 0.0;
+	double rate1 = 0.0;
+	double g0 = EventValue(e, data->y, rate0);
+	double g1 = EventValue(e, data->y0, rate1);
+	if (g0 <= 0.0) {
+		return 0;
+	}
+
+	yDense.resize(data->nBodies.NOfVar());
+	// tOut is on the positive, tIn on the non-positive side
+	double tOut = t0;
+	double tIn = t1;
+	if (g1 > 0.0) {
+		if (!(dir*rate0 < 0.0 && dir*rate1 > 0.0)) {
+			return 0;
+		}
+		double a = t0;
+		double b = t1;
+		while (fabs(b - a) > tol) {
+			double t = 0.5*(a + b);
+			if (integrator->DenseOutput(data, acceleration, timeLine, t, &yDense[0]) == 1) {
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+			double rate = 0.0;
+			if (EventValue(e, &yDense[0], rate) <= 0.0) {
+				tIn = t;
+				found = true;
+				break;
+			}
+			if (dir*rate < 0.0) {
+				a = t;
+			}
+			else {
+				b = t;
+			}
+		}
+		if (!found) {
+			return 0;
+		}
+		tOut = a;
+	}
+	found = true;
+	while (fabs(tIn - tOut) > tol) {
+		double t = 0.5*(tOut + tIn);
+		if (integrator->DenseOutput(data, acceleration, timeLine, t, &yDense[0]) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		double rate = 0.0;
+		if (EventValue(e, &yDense[0], rate) > 0.0) {
+			tOut = t;
+		}
+		else {
+			tIn = t;
+		}
+	}
+	tEvent = tIn;
+
+	return 0;
+}
+#undef EVENT_TOLERANCE
+
+/// The value of the event function e at the phases y and its rate of change
+double Simulator::EventValue(const EventFunction &e, const double *y, double &rate) const
+{
+	const double *yi = &y[6*e.i];
+	const double *yj = &y[6*e.j];
+	double r2 = 0.0;
+	double rv = 0.0;
+	for (int k=0; k<3; k++) {
+		r2 += SQR(yj[k] - yi[k]);
+		rv += (yj[k] - yi[k])*(yj[k + 3] - yi[k + 3]);
+	}
+	rate = e.sign*2.0*rv;
+
+	return e.sign*(r2 - e.distance2);
+}
+
 int Simulator::CheckEvent(double timeOfEvent)
 {
 #ifdef _DEBUG
@@ -614,42 +1851,55 @@ int Simulator::CheckEvent(double timeOfEvent)
 #endif
 	static double ejection = _simulation->settings.ejection;
 	static double hitCentrum = _simulation->settings.hitCentrum;
-	static double e3 = ejection > 0 ? 1.0/(ejection*ejection*ejection) : 0.0;
-	static double h3 = hitCentrum > 0 ? 1.0/(hitCentrum*hitCentrum*hitCentrum) : 0.0;
+	static double e2 = ejection*ejection;
+	static double h2 = hitCentrum*hitCentrum;
 
+	// The distances are computed from the phases since not every integrator evaluates the Acceleration::rm3
+	// at the end of the step, and in the barycentric frame the central body is not at the origin
 	for (int i=1; i<bodyData.nBodies.total; i++) {
+		int i0 = 6*i;
+		double dx = bodyData.y0[i0    ] - bodyData.y0[0];
+		double dy = bodyData.y0[i0 + 1] - bodyData.y0[1];
+		double dz = bodyData.y0[i0 + 2] - bodyData.y0[2];
+		double r2 = dx*dx + dy*dy + dz*dz;
 		// If Ejection was set check if distance of the body is larger than it
-		if (ejection > 0 && _acceleration->rm3[i] < e3) {
-			int i0 = 6*i;
+		if (ejection > 0 && r2 > e2) {
 			TwoBodyAffair affair(Ejection, timeOfEvent, 0, i, bodyData.id[0], bodyData.id[i], bodyData.y0, &(bodyData.y0[i0]));
 			_ejectionEvent.items.push_back(affair);
 			_ejectionEvent.N++;
 		}
 		// If HitCentrum was set check if distance of the body is smaller than it
-		if (hitCentrum > 0 && _acceleration->rm3[i] > h3) {
-			int i0 = 6*i;
+		if (hitCentrum > 0 && r2 < h2) {
 			TwoBodyAffair affair(HitCentrum, timeOfEvent, 0, i, bodyData.id[0], bodyData.id[i], bodyData.y0, &(bodyData.y0[i0]));
 			_hitCentrumEvent.items.push_back(affair);
 			_hitCentrumEvent.N++;
 		}
 	}
 
-	if (_ejectionEvent.items.size() > 0) {
-		_simulation->binary->SaveTwoBodyAffairs(_ejectionEvent.items, _simulation->settings.output.outputType);
-		// Remove the ejected bodies from the simulation
-		for (std::list<TwoBodyAffair>::iterator it = _ejectionEvent.items.begin(); it != _ejectionEvent.items.end(); it++) {
-			std::ostringstream stream;
-			stream << *it;
-			_simulation->binary->Log(stream.str(), true);
-			RemoveBody(it->body2Id);
+	if (HandleEjectionAndHitCentrum() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	// The pair which touched during a close encounter of the hybrid integrator is merged at the end of
+	// the step, which was shortened to the time of the contact
+	if (integratorType == INTEGRATOR_TYPE_HYBRID_SYMPLECTIC) {
+		HybridSymplectic *hybrid = (HybridSymplectic *)_simulation->settings.integrator;
+		for (std::vector<CollisionPair>::const_iterator it = hybrid->collisions.begin(); it != hybrid->collisions.end(); it++) {
+			TwoBodyAffair affair(Collision, timeOfEvent, it->i, it->j, bodyData.id[it->i], bodyData.id[it->j], &(bodyData.y0[6*it->i]), &(bodyData.y0[6*it->j]));
+			_collisionEvent.items.push_back(affair);
+			_collisionEvent.N++;
 		}
-		_ejectionEvent.items.clear();
+		hybrid->collisions.clear();
 	}
 
-	if (_hitCentrumEvent.items.size() > 0) {
-		_simulation->binary->SaveTwoBodyAffairs(_hitCentrumEvent.items, _simulation->settings.output.outputType);
-		// Remove the hit centrum bodies from the simulation
-		for (std::list<TwoBodyAffair>::iterator it = _hitCentrumEvent.items.begin(); it != _hitCentrumEvent.items.end(); it++) {
+	if (_collisionEvent.items.size() > 0) {
+		_simulation->binary->SaveTwoBodyAffairs(_collisionEvent.items, _simulation->settings.output.outputType);
+		for (std::list<TwoBodyAffair>::iterator it = _collisionEvent.items.begin(); it != _collisionEvent.items.end(); it++) {
+			// A body removed by an earlier event of the step does not collide any more
+			if (IsRemoved(it->idx1) || IsRemoved(it->idx2)) {
+				continue;
+			}
 
 			int survivIdx = -1;
 			int mergerIdx = -1;
@@ -661,106 +1911,148 @@ int Simulator::CheckEvent(double timeOfEvent)
 				return 1;
 			}
 
-			Body *body = _simulation->FindBy(survivId);
-			body->characteristics->mass    = bodyData.mass[   survivIdx];
-			body->characteristics->radius  = bodyData.radius[ survivIdx];
-			body->characteristics->density = bodyData.density[survivIdx];
-			body->characteristics->stokes  = bodyData.cD[     survivIdx];
-			_simulation->binary->SaveVariableProperty(body, it->time, _simulation->settings.output.outputType);
+			// A test particle is not merged, only removed
+			if (survivId >= 0) {
+				Body *body = _simulation->FindBy(survivId);
+				body->characteristics->mass    = bodyData.mass[   survivIdx];
+				body->characteristics->radius  = bodyData.radius[ survivIdx];
+				body->characteristics->density = bodyData.density[survivIdx];
+				body->characteristics->stokes  = bodyData.cD[     survivIdx];
+				_simulation->binary->SaveVariableProperty(body, it->time, _simulation->settings.output.outputType);
+			}
 
 			std::ostringstream stream;
 			stream << *it;
 			_simulation->binary->Log(stream.str(), true);
-			RemoveBody(it->body2Id);
+			RemoveBody(bodyData.id[mergerIdx]);
 		}
-		_hitCentrumEvent.items.clear();
+		_collisionEvent.items.clear();
+	}
+
+	if (RemoveQueuedBodies() == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
 	}
 
 	if (_simulation->settings.collision != 0) {
-		std::list<TwoBodyAffair> collisions;
 		double factor = _simulation->settings.collision->factor;
-		for (register int i=0; i < bodyData.nBodies.total; i++)
-		{
-			int j = bodyData.indexOfNN[i];
-			if (j >= 0 && factor*(bodyData.radius[i] + bodyData.radius[j]) > bodyData.distanceOfNN[i]) 
-			{
-				//Ha észleljük az ütközést, akkor kiírunk mindent és kilépünk!
-				detectcollision = true;
-				_simulation->binary->SaveCollisionProperty(&bodyData, _simulation->settings.output.outputType, i, j);
-				break;
+		// The overlapping pairs are searched once per accepted step, independently of the gravity computation
+		if (_collisionDetector.FindOverlaps(bodyData.nBodies.centralBody, bodyData.nBodies.total, bodyData.y0, bodyData.radius, factor, _overlaps) == 1) {
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		for (register int i=0; i < bodyData.nBodies.total; i++) {
+			bodyData.indexOfNN[i] = -1;
+			bodyData.distanceOfNN[i] = 0.0;
+		}
+		for (std::vector<CollisionPair>::const_iterator it = _overlaps.begin(); it != _overlaps.end(); it++) {
+			bodyData.indexOfNN[it->i] = it->j;
+			bodyData.indexOfNN[it->j] = it->i;
+			bodyData.distanceOfNN[it->i] = it->distance;
+			bodyData.distanceOfNN[it->j] = it->distance;
+
+			// Every overlapping pair is saved
+			detectcollision = true;
+			_simulation->binary->SaveCollisionProperty(&bodyData, _simulation->settings.output.outputType, it->i, it->j);
+		}
+	}
 
-				int survivIdx = -1;
-				int mergerIdx = -1;
-				int survivId = -1;
-				int mergerId = -1;
+	return 0;
+}
 
-				if (HandleCollision(i, j, survivIdx, mergerIdx, survivId, mergerId) == 1) {
-					Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
-					return 1;
-				}
+/**
+ * Saves and logs the queued ejections and hits of the central body, and queues the bodies concerned for
+ * removal, so the indices of the events of the step remain valid until RemoveQueuedBodies().
+ */
+int Simulator::HandleEjectionAndHitCentrum()
+{
+	if (_ejectionEvent.items.size() > 0) {
+		_simulation->binary->SaveTwoBodyAffairs(_ejectionEvent.items, _simulation->settings.output.outputType);
+		// Remove the ejected bodies from the simulation
+		for (std::list<TwoBodyAffair>::iterator it = _ejectionEvent.items.begin(); it != _ejectionEvent.items.end(); it++) {
+			std::ostringstream stream;
+			stream << *it;
+			_simulation->binary->Log(stream.str(), true);
+			RemoveBody(it->body2Id);
+		}
+		_ejectionEvent.items.clear();
+	}
 
-				double time = _simulation->settings.timeLine->time;
-				// TODO: Check whether the affair class meeds the survivIdx, mergerIdx!
-				TwoBodyAffair affair(Collision, time, survivIdx, mergerIdx, survivId, mergerId, &bodyData.y[6*survivIdx], &bodyData.y[6*mergerIdx]);
-				collisions.push_back(affair);
+	if (_hitCentrumEvent.items.size() > 0) {
+		_simulation->binary->SaveTwoBodyAffairs(_hitCentrumEvent.items, _simulation->settings.output.outputType);
+		// Remove the hit centrum bodies from the simulation
+		for (std::list<TwoBodyAffair>::iterator it = _hitCentrumEvent.items.begin(); it != _hitCentrumEvent.items.end(); it++) {
+
+			int idx2 = bodyData.IndexOf(it->body2Id);
+			if (idx2 < 0 || IsRemoved(idx2)) {
+				continue;
+			}
 
+			int survivIdx = -1;
+			int mergerIdx = -1;
+			int survivId = -1;
+			int mergerId = -1;
+
+			if (HandleCollision(it->idx1, idx2, survivIdx, mergerIdx, survivId, mergerId) == 1)	{
+				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+				return 1;
+			}
+
+			// A test particle is not merged, only removed
+			if (survivId >= 0) {
 				Body *body = _simulation->FindBy(survivId);
 				body->characteristics->mass    = bodyData.mass[   survivIdx];
 				body->characteristics->radius  = bodyData.radius[ survivIdx];
 				body->characteristics->density = bodyData.density[survivIdx];
-                body->characteristics->stokes  = bodyData.cD[     survivIdx];
-				_simulation->binary->SaveVariableProperty(body, time, _simulation->settings.output.outputType);
-
-				std::ostringstream stream;
-				stream << "Collision: At " << time*Constants::DayToYear << " [yr] between body with id: " << survivId << " and id: " << mergerId;
-				_simulation->binary->Log(stream.str(), true);
-				// Remove the merger body
-				RemoveBody(mergerId);
-
-				// Since the nearest neighbor is symmetrical, i.e. if i is the neighbor of j then vice versa.
-				// Therefore if the collision between i and j was handled, than the corresponding data in the
-				// indexOfNN array must be set to -1 in order to avoid the artificial collision between j and i.
-				bodyData.indexOfNN[mergerIdx] = -1;
+				body->characteristics->stokes  = bodyData.cD[     survivIdx];
+				_simulation->binary->SaveVariableProperty(body, it->time, _simulation->settings.output.outputType);
 			}
+
+			std::ostringstream stream;
+			stream << *it;
+			_simulation->binary->Log(stream.str(), true);
+			RemoveBody(it->body2Id);
 		}
-		//_simulation->binary->SaveTwoBodyAffairs(collisions, _simulation->settings.output.outputType);
+		_hitCentrumEvent.items.clear();
 	}
 
 	return 0;
 }
 
+/// Queues the body for removal, it is removed from bodyData by RemoveQueuedBodies()
 int Simulator::RemoveBody(int bodyId)
 {
 #ifdef _DEBUG
 //	fprintf(stderr, "File: %40s, Function: %40s, Line: %10d\n", __FILE__, __FUNCTION__, __LINE__);
 #endif
 
-	int index = 0;
-	for ( ; index < bodyData.nBodies.total; index++) {
-		if (bodyData.id[index] == bodyId) {
-			break;
-		}
-	}
-
-	if (bodyData.nBodies.UpdateAfterRemove((body_type_t)(bodyData.type[index])) == 1) {
+	int index = bodyData.IndexOf(bodyId);
+	if (index < 0) {
+		Error::_errMsg = "The body to be removed was not found!";
 		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 		return 1;
 	}
+	_removedIndex.push_back(index);
 
-	for (int i=index; i<bodyData.nBodies.total; i++) {
-		bodyData.id[i] = bodyData.id[i + 1];
-		bodyData.type[i] = bodyData.type[i + 1];
-		bodyData.migType[i] = bodyData.migType[i + 1];
+	return 0;
+}
 
-		bodyData.mass[i] = bodyData.mass[i + 1];
-		bodyData.radius[i] = bodyData.radius[i + 1];
-		bodyData.density[i] = bodyData.density[i + 1];
-		bodyData.gammaStokes[i] = bodyData.gammaStokes[i + 1];
-		bodyData.gammaEpstein[i] = bodyData.gammaEpstein[i + 1];
+bool Simulator::IsRemoved(int index) const
+{
+	return std::find(_removedIndex.begin(), _removedIndex.end(), index) != _removedIndex.end();
+}
 
-		int i0 = 6*i;
-		memcpy(&bodyData.y0[i0], &bodyData.y0[i0 + 6], 6*sizeof(double));
+/// Removes the queued bodies from bodyData in one pass, and from the bodyList, which is kept in the same order
+int Simulator::RemoveQueuedBodies()
+{
+	for (std::vector<int>::const_iterator it = _removedIndex.begin(); it != _removedIndex.end(); it++) {
+		_simulation->RemoveBody(bodyData.id[*it]);
+	}
+	if (bodyData.Remove(_removedIndex) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
 	}
+	_removedIndex.clear();
 
 	return 0;
 }
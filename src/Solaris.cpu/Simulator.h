@@ -2,21 +2,70 @@
 #define SIMULATOR_H_
 
 #include <list>
+#include <vector>
 
 #include "Counter.h"
 #include "BinaryFileAdapter.h"
 #include "BodyData.h"
 #include "BodyGroup.h"
+#include "CollisionDetector.h"
 #include "Event.h"
 #include "SolarisType.h"
+#include "TimeLine.h"
+#include "Trajectory.h"
 
 class Acceleration;
+class Integrator;
 class RungeKutta4;
 class RungeKuttaFehlberg78;
 class DormandPrince;
-class TimeLine;
 class Simulation;
 
+/**
+ * An event of the pair (i, j) of bodies within a step: the event function sign*(r_ij^2 - distance2)
+ * is positive before the event and non-positive after it.
+ */
+struct EventFunction
+{
+	int		i;
+	int		j;
+	double	distance2;
+	double	sign;
+};
+
+/**
+ * An ejection or a centrum hit of a test particle found by a chunk of the restricted problem mode. It is
+ * recorded by the simulator when the chunks have reached the end of the output interval.
+ */
+struct ChunkEvent
+{
+	EventType	type;
+	double		time;
+	int			id;
+	double		centralPhase[6];
+	double		phase[6];
+};
+
+/**
+ * A chunk of the test particles in the restricted problem mode integrated with its own step size. The
+ * other bodies are copied in front of the test particles, but their phases are taken from the
+ * trajectory computed before the chunks, and they are not integrated.
+ */
+struct RestrictedChunk
+{
+	BodyData				bodyData;
+	Acceleration			*acceleration;
+	Integrator				*integrator;
+	TimeLine				timeLine;
+	// The interval of the trajectory used by the last phases of the other bodies
+	int						segment;
+	// The number of steps taken by the chunk
+	int						nStep;
+	std::vector<ChunkEvent>	events;
+	// The interpolated phases used to locate the events
+	std::vector<double>		yDense;
+};
+
 class Simulator
 {
 public:
@@ -37,10 +86,16 @@ public:
 	bool detectcollision;
 
 private:
+	int		SetUp();
+	void	LogStatistics();
 	int 	Synchronization();
 	int		PreIntegration();
 	int		MainIntegration();
 	int		Integrate(TimeLine* timeLine);
+	int		IntegrateRestricted(TimeLine *timeLine);
+	int		IntegrateChunk(RestrictedChunk *chunk, double tEnd);
+	int		FindChunkEvent(RestrictedChunk *chunk, int i, bool &found, ChunkEvent &event) const;
+	static int StepTo(Integrator *integrator, BodyData *data, Acceleration *acceleration, TimeLine *timeLine, double tEnd);
 	int		DecisionMaking(TimeLine* timeLine, bool& stop);
 	int		DecisionMaking(const long int stepCounter, TimeLine* timeLine, double* hSum, bool& stop);
 
@@ -52,10 +107,30 @@ private:
 	double	ShortestPeriod();
 
 	int 	BodyListToBodyData();
+	int		InsertIntoBodyData(std::list<Body *> &bodies, body_type_t type);
+	void	CopyBody(Body *body, int i);
+	void	ShiftToBaryCenter();
 	void	UpdateBodyListAfterIntegration();
 
+	bool	CheckpointDue(TimeLine *timeLine) const;
+	int		SaveCheckpoint(TimeLine *timeLine);
+	int		LoadCheckpoint(TimeLine *timeLine);
+
+	int		CreateChunks(TimeLine *timeLine, const std::vector<int> *chunkSize = 0);
+	int		CollectChunks();
+	void	FreeChunks();
+	int		CopyBodies(int nOther, int first, int n, BodyData *part);
+	Acceleration* CreateAcceleration(BodyData *data);
+	Integrator*	CreateIntegrator();
+
 	int 	CheckEvent(double timeOfEvent);
+	int		HandleEjectionAndHitCentrum();
+	int		LocateEvents(TimeLine *timeLine);
+	int		FindEventTime(Integrator *integrator, BodyData *data, Acceleration *acceleration, TimeLine *timeLine, const EventFunction &e, std::vector<double> &yDense, bool &found, double &tEvent) const;
+	double	EventValue(const EventFunction &e, const double *y, double &rate) const;
 	int		RemoveBody(int bodyId);
+	bool	IsRemoved(int index) const;
+	int		RemoveQueuedBodies();
 	int		HandleCollision(int idx1, int idx2, int& survivIdx, int &mergerIdx, int& survivId, int& mergerId);
 	int		CalculatePhaseAfterCollision(int survivIdx, int mergerIdx);
 	int		CalculateCharacteristicsAfterCollision(int survivId, int mergerId, int survivIdx, int mergerIdx);
@@ -66,6 +141,37 @@ private:
 	Event			_closeEncounterEvent;
 	Event			_collisionEvent;
 	Event			_weakCaptureEvent;
+	// The indices of the bodies queued for removal by the events of the step
+	std::vector<int>	_removedIndex;
+
+	// The overlapping pairs found by the last CheckEvent()
+	CollisionDetector				_collisionDetector;
+	std::vector<CollisionPair>		_overlaps;
+	// The phases interpolated to an output time or to a trial time of an event
+	std::vector<double>				_yDense;
+	// The event functions which may change sign within the last step, the radii of the bodies enlarged
+	// by their possible displacement within the step and the pairs found with them
+	std::vector<EventFunction>		_eventFunctions;
+	std::vector<double>				_sweptRadius;
+	std::vector<CollisionPair>		_candidates;
+
+	// The restricted problem mode: the bodies other than the test particles, their acceleration, their
+	// trajectory within the output interval and their derivatives at its last knot, and the chunks of the
+	// test particles. The steps and the rejected trial steps of the chunks are summed when they are freed.
+	BodyData						_others;
+	Acceleration					*_othersAcceleration;
+	Trajectory						_trajectory;
+	std::vector<double>				_fKnot;
+	std::vector<RestrictedChunk *>	_chunks;
+	int								_nChunk;
+	double							_nChunkStep;
+	double							_nChunkRejectedStep;
+
+	// True if the main integration continues from a checkpoint, and if it was stopped by a termination signal
+	bool			_resumed;
+	bool			_terminated;
+	// The wall clock time of the start of the main integration or of the last checkpoint
+	time_t			_checkpointTime;
 
 	time_t			_startTime;
 	Simulation*		_simulation;
@@ -215,6 +215,8 @@ int main(int argc, char* argv[])
 	}
 
 	simulation.settings.output.directory = Output::directory + Output::directorySeparator + "Output_long_e10";
+	// A continued run extends the output files of the interrupted one
+	simulation.settings.output.append = simulation.runType == "Continue";
 
     simulation.binary = new BinaryFileAdapter(&simulation.settings.output);
 	simulation.binary->LogStartParameters(argc, argv);
@@ -239,8 +241,7 @@ int main(int argc, char* argv[])
 		    exit(1);
 	    }
     }
-
-	if (simulator.Run() == 1) {
+	else if (simulator.Run() == 1) {
 		Error::PrintStackTrace();
 		exit(1);
 	}
@@ -12,8 +12,12 @@
 // TODO: for compilation define the WIN32 symbol
 #ifdef WIN32
     #include <direct.h>
+    #include <fcntl.h>
+    #include <io.h>
+    #include <malloc.h>
     #define GetCurrentDir _getcwd
 #else
+    #include <stdlib.h>
     #include <unistd.h>
     #define GetCurrentDir getcwd
 #endif
@@ -46,6 +50,33 @@ void Tools::CheckAgainstSmallestNumber(const int n, double *y)
 	}
 }
 
+/// Allocates size bytes whose address is a multiple of alignment (must be a power of two).
+/// The returned memory must be released by FreeAligned(). Returns 0 on failure.
+void* Tools::AllocateAligned(size_t size, size_t alignment)
+{
+	if (size == 0) {
+		return 0;
+	}
+#ifdef WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	void *ptr = 0;
+	if (posix_memalign(&ptr, alignment, size) != 0) {
+		return 0;
+	}
+	return ptr;
+#endif
+}
+
+void Tools::FreeAligned(void *ptr)
+{
+#ifdef WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
 bool Tools::IsNumber(const std::string& str)
 {
    for (size_t i = 0; i < str.length(); i++) {
@@ -138,6 +169,27 @@ std::string Tools::GetFileName(const std::string path, const char directorySepar
 	return path.substr(found+1);
 }
 
+/// Cuts the file to its first size bytes.
+int Tools::TruncateFile(const std::string &path, long long size)
+{
+#ifdef WIN32
+	int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+	bool truncated = fd != -1 && _chsize_s(fd, size) == 0;
+	if (fd != -1) {
+		_close(fd);
+	}
+#else
+	bool truncated = truncate(path.c_str(), (off_t)size) == 0;
+#endif
+	if (!truncated) {
+		Error::_errMsg = "The file '" + path + "' could not be truncated!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	return 0;
+}
+
 int Tools::GetFileSize(const std::string path) {
 	std::fstream fs;
 	int size;
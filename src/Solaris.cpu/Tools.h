@@ -17,6 +17,8 @@ class Tools {
 public:
 	static void ToPhase(double *y, Phase *phase);
 	static void	CheckAgainstSmallestNumber(const int n, double *y);
+	static void* AllocateAligned(size_t size, size_t alignment);
+	static void	FreeAligned(void *ptr);
 
 	static bool IsNumber(const std::string& s);
 	static int StringToBool(std::string& s, bool *result);
@@ -28,6 +30,7 @@ public:
 	static std::string GetDirectory(const std::string path, const char directorySeparator);
 	static std::string GetFileName(const std::string path, const char directorySeparator);
 	static int GetFileSize(const std::string path);
+	static int	TruncateFile(const std::string &path, long long size);
 	static int	GetDirectorySeparator(char *c);
 	static int	GetWorkingDirectory(std::string &wd);
 	static enum OS GetOs();
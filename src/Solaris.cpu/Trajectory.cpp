@@ -0,0 +1,85 @@
+#include <cstring>
+
+#include "Error.h"
+#include "Integrator.h"
+#include "Trajectory.h"
+
+Trajectory::Trajectory()
+{
+	nBody = 0;
+}
+
+/// Removes the knots, the trajectory of n bodies is appended to it afterwards
+void Trajectory::Clear(int n)
+{
+	nBody = n;
+	_time.clear();
+	_y.clear();
+	_f.clear();
+}
+
+/// Removes the knots except the last one, the trajectory continues from it
+void Trajectory::KeepLast()
+{
+	int n = NOfKnot();
+	if (n <= 1) {
+		return;
+	}
+	int nVar = 6*nBody;
+	_time.erase(_time.begin(), _time.end() - 1);
+	_y.erase(_y.begin(), _y.end() - nVar);
+	_f.erase(_f.begin(), _f.end() - nVar);
+}
+
+/// Appends the phases y and their derivatives f at time t, the knots follow each other in the direction of the integration
+void Trajectory::Append(double t, const double *y, const double *f)
+{
+	int nVar = 6*nBody;
+	_time.push_back(t);
+	_y.insert(_y.end(), y, y + nVar);
+	_f.insert(_f.end(), f, f + nVar);
+}
+
+/**
+ * The phases of the bodies at time t are written into y[0], ..., y[6*nBody - 1]. segment is the index of
+ * the first knot of the interval used by the last call, it is searched only if t is outside of it. Each
+ * caller has its own segment, so the trajectory can be read by several threads. A time slightly beyond
+ * the last knot (the stages of a step ending there) is extrapolated from the last interval.
+ */
+int Trajectory::Phase(double t, double *y, int &segment) const
+{
+	int n = NOfKnot();
+	if (n == 0) {
+		Error::_errMsg = "The trajectory is empty!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+	int nVar = 6*nBody;
+	if (n == 1) {
+		memcpy(y, &_y[0], nVar*sizeof(double));
+		return 0;
+	}
+
+	double dir = _time[n - 1] >= _time[0] ? 1.0 : -1.0;
+	if (segment < 0 || segment > n - 2 || dir*(t - _time[segment]) < 0.0 || (segment < n - 2 && dir*(t - _time[segment + 1]) > 0.0)) {
+		int lower = 0;
+		int upper = n - 1;
+		while (upper - lower > 1) {
+			int middle = (lower + upper)/2;
+			if (dir*(t - _time[middle]) >= 0.0) {
+				lower = middle;
+			}
+			else {
+				upper = middle;
+			}
+		}
+		segment = lower;
+	}
+
+	int		k = segment;
+	double	h = _time[k + 1] - _time[k];
+	double	s = h != 0.0 ? (t - _time[k])/h : 1.0;
+	Integrator::Hermite(nBody, h, s, &_y[k*nVar], &_f[k*nVar], &_y[(k + 1)*nVar], &_f[(k + 1)*nVar], y);
+
+	return 0;
+}
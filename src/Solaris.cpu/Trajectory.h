@@ -0,0 +1,33 @@
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <vector>
+
+/**
+ * The trajectory of a set of bodies stored as their phases and derivatives at the knots, i.e. at the
+ * ends of the steps which computed it. Between two knots the phases are given by the quintic Hermite
+ * interpolant of Integrator::DenseOutput(), the error of the positions is O(h^6) of the step.
+ */
+class Trajectory
+{
+public:
+	Trajectory();
+
+	void	Clear(int n);
+	void	KeepLast();
+	void	Append(double t, const double *y, const double *f);
+	int		Phase(double t, double *y, int &segment) const;
+
+	int		NOfKnot() const		{ return (int)_time.size(); }
+
+	// The number of bodies
+	int		nBody;
+
+private:
+	std::vector<double>	_time;
+	// The phases and the derivatives of the bodies at the knots, 6*nBody each
+	std::vector<double>	_y;
+	std::vector<double>	_f;
+};
+
+#endif
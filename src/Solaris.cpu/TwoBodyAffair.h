@@ -29,7 +29,7 @@ public:
 
 	friend std::ostream& operator<<(std::ostream& output, const TwoBodyAffair& affair);
 
-private:
+	// The id of the next event, it is saved into the checkpoints
 	static int _eventId;
 };
 
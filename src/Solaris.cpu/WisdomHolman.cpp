@@ -0,0 +1,372 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "WisdomHolman.h"
+#include "Acceleration.h"
+#include "BodyData.h"
+#include "Checkpoint.h"
+#include "Constants.h"
+#include "Error.h"
+#include "TimeLine.h"
+#include "SolarisMacro.h"
+#include "SolarisType.h"
+
+WisdomHolman::WisdomHolman()
+{
+	name			= "Wisdom-Holman";
+	reference		= "Wisdom, J. & Holman, M., 1991, AJ 102, 1528; Duncan, M. J., Levison, H. F. & Lee, M. H., 1998, AJ 116, 2067";
+	// The interactions and the phases at the end of the last step
+	nWorkspaceArray	= 2;
+
+	stepsPerOrbit	= Constants::WisdomHolmanStepsPerOrbit;
+	hFixed			= 0.0;
+	nInteraction	= 0;
+
+	_interactionValid = false;
+	_nLast			= 0;
+}
+
+int WisdomHolman::Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine)
+{
+	if (hFixed == 0.0) {
+		double period = ShortestPeriod(bodyData);
+		if (period <= 0.0) {
+			Error::_errMsg = "The Wisdom-Holman integrator needs at least one body on a bound orbit!";
+			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+			return 1;
+		}
+		hFixed = period / stepsPerOrbit;
+	}
+	// The step is shortened only if the Simulator clipped it to reach an output or the end time
+	double	h = timeLine->hNext >= 0.0 ? hFixed : -hFixed;
+	if (fabs(timeLine->hNext) < hFixed) {
+		h = timeLine->hNext;
+	}
+
+	bodyData->time	= timeLine->time;
+	bodyData->h		= h;
+
+	if (Step(bodyData, h) == 1) {
+		Error::_errMsg = "An error occurred during Wisdom-Holman step!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	timeLine->hDid = h;
+	// Update time
+	timeLine->time += timeLine->hDid;
+	bodyData->time = timeLine->time;
+	// The next step is again the fixed one
+	timeLine->hNext = h >= 0.0 ? hFixed : -hFixed;
+	bodyData->h = timeLine->hNext;
+	// Update the phases of the system
+	std::swap(bodyData->y0, bodyData->y);
+
+	return 0;
+}
+
+/**
+ * Advances bodyData->y0 by h into bodyData->y. The heliocentric velocities are transformed into
+ * barycentric ones at the beginning and back at the end of the step, therefore the rest of the code
+ * (events, output) sees the usual astrocentric phases.
+ */
+int WisdomHolman::Step(BodyData *bodyData, double h)
+{
+	int		nTotal = bodyData->nBodies.total;
+	int		nVar = bodyData->nBodies.NOfVar();
+	int		nSource = bodyData->nBodies.NOfMassive() + bodyData->nBodies.superPlanetsimal;
+	double	m0 = bodyData->mass[0];
+
+	int nAllocation = this->nAllocation;
+	int result = AllocateWorkspace(nVar);
+	HANDLE_RESULT(result);
+	double	*a = Workspace(0);
+	double	*yLast = Workspace(1);
+	double	*y = bodyData->y;
+
+	// The interactions computed at the end of the last step are reused if the phases were not
+	// changed since then (e.g. by a collision or by the removal of a body)
+	bool reuse = _interactionValid && nTotal == _nLast && nAllocation == this->nAllocation && memcmp(bodyData->y0, yLast, nVar*sizeof(double)) == 0;
+	memcpy(y, bodyData->y0, nVar*sizeof(double));
+
+	// Heliocentric to barycentric velocities: u_i = v_i - sum m_j v_j / M
+	double	M = MassOfSources(bodyData);
+	double	V[3] = {0.0, 0.0, 0.0};
+	for (int j=1; j<nSource; j++) {
+		for (int k=0; k<3; k++) {
+			V[k] += bodyData->mass[j]*y[6*j + 3 + k];
+		}
+	}
+	for (int i=1; i<nTotal; i++) {
+		for (int k=0; k<3; k++) {
+			y[6*i + 3 + k] -= V[k]/M;
+		}
+	}
+
+	if (!reuse) {
+		Interaction(bodyData, y, a);
+	}
+	Kick(nTotal, 0.5*h, a, y);
+	Jump(bodyData, 0.5*h, y);
+
+	if (Drift(bodyData, h, y) == 1) {
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	Jump(bodyData, 0.5*h, y);
+	Interaction(bodyData, y, a);
+	Kick(nTotal, 0.5*h, a, y);
+
+	// Barycentric to heliocentric velocities: v_i = u_i + sum m_j u_j / m0
+	V[0] = V[1] = V[2] = 0.0;
+	for (int j=1; j<nSource; j++) {
+		for (int k=0; k<3; k++) {
+			V[k] += bodyData->mass[j]*y[6*j + 3 + k];
+		}
+	}
+	for (int i=1; i<nTotal; i++) {
+		for (int k=0; k<3; k++) {
+			y[6*i + 3 + k] += V[k]/m0;
+		}
+	}
+
+	memcpy(yLast, y, nVar*sizeof(double));
+	_interactionValid = true;
+	_nLast = nTotal;
+
+	return 0;
+}
+
+/**
+ * The accelerations from the mutual interactions of the bodies, the central body is excluded.
+ * The sources of the bodies are the same as in Acceleration::GravityAC(): the bodies up to the
+ * protoplanets feel the super-planetesimals too, the others only the massive bodies.
+ */
+void WisdomHolman::Interaction(BodyData *bodyData, const double *y, double *a)
+{
+	int nTotal = bodyData->nBodies.total;
+	int nMassive = bodyData->nBodies.NOfMassive();
+	int nSource = nMassive + bodyData->nBodies.superPlanetsimal;
+	bool parallel = nTotal >= Constants::ParallelThreshold;
+
+	a[0] = a[1] = a[2] = 0.0;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
+		double ax = 0.0, ay = 0.0, az = 0.0;
+		int i0 = 6*i;
+		int n = bodyData->type[i] <= BODY_TYPE_PROTOPLANET ? nSource : nMassive;
+		for (int j=1; j<n; j++) {
+			if (j == i)
+				continue;
+			int j0 = 6*j;
+			double xij = y[j0 + 0] - y[i0 + 0];
+			double yij = y[j0 + 1] - y[i0 + 1];
+			double zij = y[j0 + 2] - y[i0 + 2];
+			double rij2 = SQR(xij) + SQR(yij) + SQR(zij);
+			double rij = sqrt(rij2);
+			double Gmjrijm3 = Constants::Gauss2*bodyData->mass[j]/(rij2*rij);
+			ax += Gmjrijm3*xij;
+			ay += Gmjrijm3*yij;
+			az += Gmjrijm3*zij;
+		}
+		a[3*i + 0] = ax;
+		a[3*i + 1] = ay;
+		a[3*i + 2] = az;
+	}
+	nInteraction++;
+}
+
+/// Every body moves on its Keplerian orbit around the central body for h
+int WisdomHolman::Drift(BodyData *bodyData, double h, double *y)
+{
+	int		nTotal = bodyData->nBodies.total;
+	double	mu = Constants::Gauss2*bodyData->mass[0];
+	bool	parallel = nTotal >= Constants::ParallelThreshold;
+	int		nFailed = 0;
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) reduction(+:nFailed) if (parallel)
+#endif
+	for (int i=1; i<nTotal; i++) {
+		nFailed += KeplerDrift(mu, &y[6*i + 0], &y[6*i + 3], h);
+	}
+	if (nFailed > 0) {
+		Error::_errMsg = "The Kepler equation could not be solved!";
+		Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	return 0;
+}
+
+void WisdomHolman::Kick(int n, double h, const double *a, double *y)
+{
+	for (int i=1; i<n; i++) {
+		y[6*i + 3] += h*a[3*i + 0];
+		y[6*i + 4] += h*a[3*i + 1];
+		y[6*i + 5] += h*a[3*i + 2];
+	}
+}
+
+/**
+ * The drift generated by the kinetic energy of the central body: every heliocentric position
+ * is shifted by h times the barycentric momentum of the other bodies divided by the central mass.
+ */
+void WisdomHolman::Jump(BodyData *bodyData, double h, double *y)
+{
+	int nTotal = bodyData->nBodies.total;
+	int nSource = bodyData->nBodies.NOfMassive() + bodyData->nBodies.superPlanetsimal;
+
+	double P[3] = {0.0, 0.0, 0.0};
+	for (int j=1; j<nSource; j++) {
+		for (int k=0; k<3; k++) {
+			P[k] += bodyData->mass[j]*y[6*j + 3 + k];
+		}
+	}
+	for (int k=0; k<3; k++) {
+		P[k] *= h/bodyData->mass[0];
+	}
+	for (int i=1; i<nTotal; i++) {
+		y[6*i + 0] += P[0];
+		y[6*i + 1] += P[1];
+		y[6*i + 2] += P[2];
+	}
+}
+
+/// The mass of the central body and of the bodies which act on it
+double WisdomHolman::MassOfSources(BodyData *bodyData)
+{
+	int nSource = bodyData->nBodies.NOfMassive() + bodyData->nBodies.superPlanetsimal;
+
+	double M = 0.0;
+	for (int j=0; j<nSource; j++) {
+		M += bodyData->mass[j];
+	}
+	return M;
+}
+
+/// The shortest period of the bodies on bound orbits around the central body
+double WisdomHolman::ShortestPeriod(BodyData *bodyData)
+{
+	double period = 0.0;
+	for (int i=1; i<bodyData->nBodies.total; i++) {
+		int i0 = 6*i;
+		double mu = Constants::Gauss2*(bodyData->mass[0] + bodyData->mass[i]);
+		double r = sqrt(SQR(bodyData->y0[i0 + 0]) + SQR(bodyData->y0[i0 + 1]) + SQR(bodyData->y0[i0 + 2]));
+		double v2 = SQR(bodyData->y0[i0 + 3]) + SQR(bodyData->y0[i0 + 4]) + SQR(bodyData->y0[i0 + 5]);
+		double alpha = 2.0/r - v2/mu;
+		if (alpha <= 0.0) {
+			continue;
+		}
+		double p = 2.0*Constants::Pi*sqrt(1.0/(alpha*alpha*alpha*mu));
+		if (period == 0.0 || p < period) {
+			period = p;
+		}
+	}
+	return period;
+}
+
+// The Stumpff functions c2(x) and c3(x), for small |x| they are computed from their series
+static void Stumpff(double x, double &c2, double &c3)
+{
+	if (fabs(x) < 0.1) {
+		c2 = 1.0/2.0*(1.0 - x/12.0*(1.0 - x/30.0*(1.0 - x/56.0*(1.0 - x/90.0*(1.0 - x/132.0)))));
+		c3 = 1.0/6.0*(1.0 - x/20.0*(1.0 - x/42.0*(1.0 - x/72.0*(1.0 - x/110.0*(1.0 - x/156.0)))));
+	}
+	else if (x > 0.0) {
+		double s = sqrt(x);
+		c2 = (1.0 - cos(s))/x;
+		c3 = (s - sin(s))/(x*s);
+	}
+	else {
+		double s = sqrt(-x);
+		c2 = (cosh(s) - 1.0)/(-x);
+		c3 = (sinh(s) - s)/(-x*s);
+	}
+}
+
+/**
+ * Advances the Keplerian orbit (r, v) around a centre with gravitational parameter mu by dt.
+ * The Kepler equation is solved in the universal variable s by the Laguerre-Conway method,
+ * therefore elliptic and hyperbolic orbits are treated in the same way.
+ * Returns 1 if the iteration did not converge.
+ */
+int WisdomHolman::KeplerDrift(double mu, double *r, double *v, double dt)
+{
+	if (dt == 0.0) {
+		return 0;
+	}
+	double r0 = sqrt(SQR(r[0]) + SQR(r[1]) + SQR(r[2]));
+	double v2 = SQR(v[0]) + SQR(v[1]) + SQR(v[2]);
+	double eta0 = r[0]*v[0] + r[1]*v[1] + r[2]*v[2];
+	double beta = 2.0*mu/r0 - v2;
+
+	double s = dt/r0 - 0.5*eta0*dt*dt/(r0*r0*r0);
+	double G0 = 0, G1 = 0, G2 = 0, G3 = 0, fp = r0;
+	bool converged = false;
+	for (int iter = 0; iter < Constants::KeplerMaxIteration; iter++) {
+		double x = beta*s*s;
+		double c2, c3;
+		Stumpff(x, c2, c3);
+		G0 = 1.0 - x*c2;
+		G1 = s*(1.0 - x*c3);
+		G2 = s*s*c2;
+		G3 = s*s*s*c3;
+		double f   = r0*G1 + eta0*G2 + mu*G3 - dt;
+		fp		   = r0*G0 + eta0*G1 + mu*G2;
+		double fpp = eta0*G0 + (mu - beta*r0)*G1;
+		double d   = sqrt(fabs(16.0*fp*fp - 20.0*f*fpp));
+		double ds  = -5.0*f/(fp > 0.0 ? fp + d : fp - d);
+		s += ds;
+		if (fabs(ds) <= 1.0e-15*fabs(s)) {
+			converged = true;
+			break;
+		}
+	}
+	if (!converged) {
+		return 1;
+	}
+	// The G functions at the converged s
+	double x = beta*s*s;
+	double c2, c3;
+	Stumpff(x, c2, c3);
+	G0 = 1.0 - x*c2;
+	G1 = s*(1.0 - x*c3);
+	G2 = s*s*c2;
+	double rn = r0*G0 + eta0*G1 + mu*G2;
+
+	double f  = 1.0 - mu*G2/r0;
+	double g  = r0*G1 + eta0*G2;
+	double fd = -mu*G1/(r0*rn);
+	double gd = 1.0 - mu*G2/rn;
+	for (int k=0; k<3; k++) {
+		double rk = r[k];
+		double vk = v[k];
+		r[k] = f*rk + g*vk;
+		v[k] = fd*rk + gd*vk;
+	}
+
+	return 0;
+}
+
+/// The interactions at the end of the last step are not saved, the first step after the restart computes them again.
+void WisdomHolman::SaveState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	Integrator::SaveState(checkpoint, bodyData);
+	checkpoint.Write(hFixed);
+	checkpoint.Write(nInteraction);
+}
+
+int WisdomHolman::LoadState(Checkpoint &checkpoint, BodyData *bodyData)
+{
+	int result = Integrator::LoadState(checkpoint, bodyData);
+	HANDLE_RESULT(result);
+	checkpoint.Read(hFixed);
+	checkpoint.Read(nInteraction);
+	_interactionValid = false;
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef WISDOMHOLMAN_H_
+#define WISDOMHOLMAN_H_
+
+#include <string>
+#include "Integrator.h"
+
+class Acceleration;
+class BodyData;
+class Checkpoint;
+class TimeLine;
+
+/**
+ * Mixed-variable symplectic integrator of Wisdom and Holman in democratic heliocentric
+ * coordinates (heliocentric positions, barycentric velocities). A step is the sequence
+ * kick(h/2), jump(h/2), Kepler drift(h), jump(h/2), kick(h/2). The step size is fixed, it is
+ * the shortest orbital period divided by stepsPerOrbit. The dissipative forces of the nebula
+ * are not supported, the integrator can be used only in the astrocentric frame.
+ */
+class WisdomHolman : public Integrator
+{
+public:
+	WisdomHolman();
+
+	int			Driver(BodyData *bodyData, Acceleration *acceleration, TimeLine *timeLine);
+	int 		Step(  BodyData *bodyData, double h);
+	void		SaveState(Checkpoint &checkpoint, BodyData *bodyData);
+	int			LoadState(Checkpoint &checkpoint, BodyData *bodyData);
+
+	static int	KeplerDrift(double mu, double *r, double *v, double dt);
+
+	// The number of steps per the shortest orbital period
+	int			stepsPerOrbit;
+	// The fixed step size [day], it is computed at the first call of the Driver()
+	double		hFixed;
+	// The number of evaluations of the mutual interactions
+	int			nInteraction;
+
+protected:
+	double		ShortestPeriod(BodyData *bodyData);
+	virtual void Interaction(BodyData *bodyData, const double *y, double *a);
+	virtual int	Drift(BodyData *bodyData, double h, double *y);
+	void		Kick(int n, double h, const double *a, double *y);
+	void		Jump(BodyData *bodyData, double h, double *y);
+	double		MassOfSources(BodyData *bodyData);
+
+	// True if the interactions at the end of the last step are valid for the next one
+	bool		_interactionValid;
+
+private:
+	// The number of bodies at the end of the last step
+	int			_nLast;
+};
+
+#endif
@@ -833,7 +833,7 @@ int XmlFileAdapter::DeserializeBody(TiXmlElement *xmlElement, Body *body)
 	TiXmlNode *phaseChild	= xmlElement->FirstChild("Phase");
 	TiXmlNode *oeChild		= xmlElement->FirstChild("OrbitalElement");
 	if (body->type == CentralBody && phaseChild == 0 && oeChild == 0) {
-		body->phase = new Phase(body->GetId());
+		body->phase = Body::phasePool.New(body->GetId());
 	}
 	else {
 		if (phaseChild != 0 && oeChild != 0 ) {
@@ -861,7 +861,7 @@ int XmlFileAdapter::DeserializeBody(TiXmlElement *xmlElement, Body *body)
 				return 1;
 			}
 			phase.bodyId = body->GetId();
-			body->phase = new Phase(phase);
+			body->phase = Body::phasePool.New(phase);
 		}
 		else {
 			OrbitalElement orbElem;
@@ -875,7 +875,7 @@ int XmlFileAdapter::DeserializeBody(TiXmlElement *xmlElement, Body *body)
 				Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 				return 1;
 			}
-			body->orbitalElement = new OrbitalElement(orbElem);
+			body->orbitalElement = Body::orbitalElementPool.New(orbElem);
 		}
 	}
 
@@ -897,7 +897,7 @@ int XmlFileAdapter::DeserializeBody(TiXmlElement *xmlElement, Body *body)
 			Error::PushLocation(__FILE__, __FUNCTION__, __LINE__);
 			return 1;
 		}
-		body->characteristics = new Characteristics(characteristics);
+		body->characteristics = Body::characteristicsPool.New(characteristics);
 
 		//DragCoefficient dragCoefficient;
 		//child = xmlElement->FirstChild("DragCoefficient");
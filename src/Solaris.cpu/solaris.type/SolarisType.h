@@ -124,9 +124,30 @@ typedef enum integrator_type
 		INTEGRATOR_TYPE_DORMAND_PRINCE,
 		INTEGRATOR_TYPE_RUNGE_KUTTA4,
 		INTEGRATOR_TYPE_RUNGE_KUTTA56,
-		INTEGRATOR_TYPE_RUNGE_KUTTA_FEHLBERG78
+		INTEGRATOR_TYPE_RUNGE_KUTTA_FEHLBERG78,
+		INTEGRATOR_TYPE_WISDOM_HOLMAN,
+		INTEGRATOR_TYPE_GAUSS_RADAU15,
+		INTEGRATOR_TYPE_HYBRID_SYMPLECTIC,
+		INTEGRATOR_TYPE_BLOCK_HERMITE,
+		INTEGRATOR_TYPE_BULIRSCH_STOER
 	} integrator_type_t;
 
+typedef enum step_control
+	{
+		STEP_CONTROL_CLASSIC,
+		STEP_CONTROL_PI,
+		STEP_CONTROL_N
+	} step_control_t;
+
+typedef enum gravity_kernel
+	{
+		GRAVITY_KERNEL_AUTO,
+		GRAVITY_KERNEL_SCALAR,
+		GRAVITY_KERNEL_AVX2,
+		GRAVITY_KERNEL_AVX512,
+		GRAVITY_KERNEL_N
+	} gravity_kernel_t;
+
 typedef enum output_type
 	{
 		OUTPUT_TYPE_BINARY,